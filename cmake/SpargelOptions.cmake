@@ -84,5 +84,9 @@ spargel_add_option(SPARGEL_USE_FILE_MMAP "use file memory mapping (mmap)" ${SPAR
 
 spargel_add_option(SPARGEL_ENABLE_TRACING "enable tracing" OFF)
 
+# 0 = debug, ..., 4 = fatal. Fatal messages are always kept.
+set(SPARGEL_LOG_MIN_LEVEL 0 CACHE STRING "compile out log messages below this level")
+message(STATUS "SPARGEL_LOG_MIN_LEVEL: ${SPARGEL_LOG_MIN_LEVEL}")
+
 # unused: spargel_add_option(SPARGEL_ENABLE_COVERAGE "enable coverge" OFF)
 # unused: spargel_add_option(SPARGEL_TRACE_ALLOCATION "trace allocation" OFF)
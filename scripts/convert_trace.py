@@ -3,6 +3,32 @@ import json
 import pathlib
 import struct
 
+# Keep in sync with source/spargel/base/trace.h.
+MAGIC = b'SPTRACE\x00'
+VERSION = 3
+RECORD_NAMES = 1
+RECORD_EVENTS = 2
+EVENT = struct.Struct('QII')
+
+KIND_PHASES = {
+    0: 'B',  # enter_region
+    1: 'E',  # leave_region
+    2: 'i',  # instant
+    3: 'C',  # counter
+    4: 's',  # flow_begin
+    5: 't',  # flow_step
+    6: 'f',  # flow_end
+}
+KIND_ARGUMENT = 7
+KIND_THREAD = 8
+
+# A ring file, see `trace_ring_file_magic`.
+RING_MAGIC = b'SPTRING\x00'
+RING_HEADER_SIZE = 64
+
+# The arguments of a leave_region event, when hardware counters are on.
+REGION_COUNTERS = ('cycles', 'instructions', 'cache_misses', 'branch_misses')
+
 parser = argparse.ArgumentParser()
 parser.add_argument("bin", type=pathlib.Path)
 parser.add_argument("out")
@@ -10,30 +36,116 @@ args = parser.parse_args()
 
 data = args.bin.read_bytes()
 
-n = len(data) // 80
-
+names = {}
 events = []
+# The last event of each thread, which its argument events belong to.
+last_event = {}
 
-for i in range(n):
-    offset = i * 80
-    e = data[offset:offset+80]
-    name, kind, timestamp = struct.unpack('64sIQ', e)
-    x = name.split(b'\x00')[0]
-    name = x.decode('utf-8')
-    if kind == 0:
-        ph = 'B'
-    elif kind == 1:
-        ph = 'E'
-    else:
-        raise
-
-    events.append({
-        'name': name,
-        'ph': ph,
-        'ts': timestamp,
+
+def add_event(tid, timestamp, name, kind):
+    if kind == KIND_ARGUMENT:
+        # The payload of the previous event of this thread.
+        prev = last_event.get(tid)
+        if prev is None:
+            return
+        if prev['ph'] == 'C':
+            value = struct.unpack('q', struct.pack('Q', timestamp))[0]
+            prev['args'] = {prev['name']: value}
+        elif prev['ph'] == 'E':
+            counters = prev.setdefault('args', {})
+            counters[REGION_COUNTERS[len(counters)]] = timestamp
+            if len(counters) == len(REGION_COUNTERS) and counters['cycles'] != 0:
+                counters['ipc'] = round(counters['instructions'] / counters['cycles'], 3)
+        else:
+            prev['id'] = timestamp
+        return
+    if kind not in KIND_PHASES:
+        raise SystemExit(f'unknown event kind {kind}')
+
+    event = {
+        # A ring file may have run out of room for names.
+        'name': names.get(name, f'#{name}'),
+        'ph': KIND_PHASES[kind],
+        # Chrome expects microseconds; the engine records nanoseconds.
+        'ts': timestamp / 1000,
         # pid is required; just provide a dummy value
         'pid': 1000,
-    })
+        'tid': tid,
+    }
+    if event['ph'] == 'i':
+        event['s'] = 't'
+    elif event['ph'] in ('s', 't', 'f'):
+        # Flows connect the enclosing slices.
+        event['cat'] = 'flow'
+        event['bp'] = 'e'
+    events.append(event)
+    last_event[tid] = event
+
+
+def check_version(version, event_size):
+    if version != VERSION or event_size != EVENT.size:
+        raise SystemExit(f'{args.bin}: unsupported version {version} (event size {event_size})')
+
+
+def read_names(offset, end):
+    while offset < end:
+        id, length = struct.unpack_from('II', data, offset)
+        offset += 8
+        names[id] = data[offset:offset+length].decode('utf-8')
+        offset += length
+    return offset
+
+
+def read_stream():
+    check_version(*struct.unpack_from('II', data, 8))
+    offset = 16
+    while offset < len(data):
+        (record,) = struct.unpack_from('I', data, offset)
+        offset += 4
+        if record == RECORD_NAMES:
+            (count,) = struct.unpack_from('I', data, offset)
+            offset += 4
+            for _ in range(count):
+                id, length = struct.unpack_from('II', data, offset)
+                offset = read_names(offset, offset + 8 + length)
+        elif record == RECORD_EVENTS:
+            tid, count = struct.unpack_from('II', data, offset)
+            offset += 8
+            for _ in range(count):
+                add_event(tid, *EVENT.unpack_from(data, offset))
+                offset += EVENT.size
+        else:
+            raise SystemExit(f'unknown record {record} at offset {offset - 4}')
+
+
+def read_ring():
+    check_version(*struct.unpack_from('II', data, 8))
+    names_capacity, events_capacity, names_size, tail, head = \
+        struct.unpack_from('QQQQQ', data, 16)
+    names_offset = RING_HEADER_SIZE
+    read_names(names_offset, names_offset + names_size)
+    events_offset = names_offset + names_capacity
+    tid = None
+    for i in range(max(tail, head - events_capacity), head):
+        timestamp, name, kind = EVENT.unpack_from(
+            data, events_offset + (i % events_capacity) * EVENT.size)
+        if kind == KIND_THREAD:
+            tid = timestamp
+        elif tid is not None:
+            # Events before the first leader lost it to the wrap.
+            add_event(tid, timestamp, name, kind)
+
+
+magic = data[0:8]
+if magic == MAGIC:
+    read_stream()
+elif magic == RING_MAGIC:
+    read_ring()
+else:
+    raise SystemExit(f'{args.bin}: not a spargel trace')
+
+# The engine writes the events of different threads in batches, not in time order.
+events.sort(key=lambda e: e['ts'])
 
 with open(args.out, "w") as f:
    json.dump(events, f)
@@ -0,0 +1,129 @@
+import argparse
+import collections
+import os
+import struct
+import subprocess
+import sys
+
+# Reads a CPU profile written by source/spargel/base/sampling_profiler.cpp, and prints folded
+# stacks: one line per distinct stack, callers first, with the number of samples. Feed them to
+# flamegraph.pl or speedscope.
+#
+# Symbols are resolved with addr2line, through the memory map at the end of the profile. Run
+# this on the machine that made the profile, or where the same binaries sit at the same paths.
+
+parser = argparse.ArgumentParser()
+parser.add_argument("profile")
+parser.add_argument("--addr2line", default="addr2line")
+args = parser.parse_args()
+
+data = open(args.profile, "rb").read()
+
+# The profile is made of words of the native pointer size and byte order. The header begins
+# with {0, 3}.
+for word_size, word_format in ((8, "<Q"), (4, "<I")):
+    if len(data) >= 2 * word_size and \
+            struct.unpack_from(word_format, data, 0)[0] == 0 and \
+            struct.unpack_from(word_format, data, word_size)[0] == 3:
+        break
+else:
+    sys.exit("not a CPU profile")
+
+
+def word(i):
+    return struct.unpack_from(word_format, data, i * word_size)[0]
+
+
+header_words = word(1) + 2
+pos = header_words
+stacks = collections.Counter()
+while True:
+    count, depth = word(pos), word(pos + 1)
+    pcs = tuple(word(pos + 2 + i) for i in range(depth))
+    pos += 2 + depth
+    # The trailer.
+    if count == 0 and depth == 1 and pcs == (0,):
+        break
+    stacks[pcs] += count
+
+mappings = []
+for line in data[pos * word_size:].decode(errors="replace").splitlines():
+    fields = line.split(maxsplit=5)
+    if len(fields) < 6 or "x" not in fields[1]:
+        continue
+    start, end = (int(x, 16) for x in fields[0].split("-"))
+    mappings.append((start, end, int(fields[2], 16), fields[5]))
+
+
+def elf_loads(path):
+    """The PT_LOAD segments of an ELF file, as (offset, vaddr, size)."""
+    try:
+        with open(path, "rb") as f:
+            ident = f.read(64)
+            if ident[:4] != b"\x7fELF" or ident[4] != 2:
+                return []
+            phoff, = struct.unpack_from("<Q", ident, 32)
+            phentsize, phnum = struct.unpack_from("<HH", ident, 54)
+            f.seek(phoff)
+            table = f.read(phentsize * phnum)
+    except OSError:
+        return []
+    loads = []
+    for i in range(phnum):
+        p_type, _, p_offset, p_vaddr, _, p_filesz = \
+            struct.unpack_from("<IIQQQQ", table, i * phentsize)
+        if p_type == 1:
+            loads.append((p_offset, p_vaddr, p_filesz))
+    return loads
+
+
+# The address to look up in the file, for a runtime address.
+def file_address(addr):
+    for start, end, offset, path in mappings:
+        if start <= addr < end:
+            file_offset = addr - start + offset
+            for p_offset, p_vaddr, p_filesz in elf_loads(path):
+                if p_offset <= file_offset < p_offset + p_filesz:
+                    return path, file_offset - p_offset + p_vaddr
+            return path, file_offset
+    return None, addr
+
+
+# Frames other than the leaf are return addresses. Look up the call instead, which may belong to
+# another line or even another function.
+lookups = collections.defaultdict(set)
+for pcs in stacks:
+    for i, pc in enumerate(pcs):
+        path, addr = file_address(pc if i == 0 else pc - 1)
+        if path is not None:
+            lookups[path].add(addr)
+
+names = {}
+for path, addrs in lookups.items():
+    addrs = sorted(addrs)
+    if os.path.isfile(path):
+        out = subprocess.run(
+            [args.addr2line, "-f", "-C", "-e", path] + ["%x" % a for a in addrs],
+            capture_output=True, text=True).stdout.splitlines()
+        # Two lines per address: the function, then the file and line.
+        for a, function in zip(addrs, out[0::2]):
+            if function != "??":
+                names[path, a] = function
+    for a in addrs:
+        names.setdefault((path, a), "%s+0x%x" % (os.path.basename(path), a))
+
+
+def frame_name(i, pc):
+    path, addr = file_address(pc if i == 0 else pc - 1)
+    if path is None:
+        return "0x%x" % pc
+    # `;` separates frames.
+    return names[path, addr].replace(";", ":")
+
+
+folded = collections.Counter()
+for pcs, count in stacks.items():
+    frames = [frame_name(i, pc) for i, pc in enumerate(pcs)]
+    folded[";".join(reversed(frames))] += count
+for stack, count in sorted(folded.items()):
+    print(stack, count)
@@ -1,9 +1,12 @@
 #include "spargel/base/allocator.h"
 
 #include "spargel/base/check.h"
+#include "spargel/base/tracking_allocator.h"
 
 // libc
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 namespace spargel::base {
     namespace {
@@ -37,8 +40,37 @@ namespace spargel::base {
             spargel_check(size > 0);
             ::free(ptr);
         }
+
+        // The allocators chosen at the first allocation of the process.
+        struct Defaults {
+            Allocator* root;
+            TrackingAllocator* tracker;
+        };
+
+        Defaults const& defaults() {
+            static Defaults d = [] {
+                Allocator* libc = LibCAllocator::getInstance();
+                char const* mode = getenv("SPARGEL_TRACK_ALLOCATIONS");
+                if (mode == nullptr || mode[0] == 0) {
+                    return Defaults{libc, nullptr};
+                }
+                auto tracker = new TrackingAllocator(libc);
+                if (strcmp(mode, "dump") == 0) {
+                    atexit([] { tracking_allocator()->dump(stderr); });
+                }
+                return Defaults{tracker, tracker};
+            }();
+            return d;
+        }
     }  // namespace
 
-    Allocator* default_allocator() { return LibCAllocator::getInstance(); }
+    Allocator* default_allocator() { return defaults().root; }
+
+    Allocator* tagged_allocator(AllocationTag tag) {
+        auto& d = defaults();
+        return d.tracker != nullptr ? d.tracker->tagged(tag) : d.root;
+    }
+
+    TrackingAllocator* tracking_allocator() { return defaults().tracker; }
 
 }  // namespace spargel::base
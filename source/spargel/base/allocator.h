@@ -34,4 +34,23 @@ namespace spargel::base {
 
     Allocator* default_allocator();
 
+    // What a piece of memory is for, as reported by `TrackingAllocator`.
+    enum class AllocationTag : u8 {
+        untagged,
+        vector,
+        hash_map,
+        string,
+        ecs,
+        json,
+        _count,
+    };
+
+    // The allocator for memory of the given kind.
+    //
+    // This is `default_allocator()`, unless allocation tracking is on. Then it is a view of the
+    // tracking allocator that accounts the memory to `tag`. Memory must be freed through the
+    // allocator that allocated it, as always.
+    //
+    Allocator* tagged_allocator(AllocationTag tag);
+
 }  // namespace spargel::base
@@ -1,6 +1,9 @@
 #include "spargel/base/allocator.h"
+#include "spargel/base/arena_allocator.h"
 #include "spargel/base/check.h"
 #include "spargel/base/test.h"
+#include "spargel/base/tracking_allocator.h"
+#include "spargel/base/vector.h"
 
 //
 #include <stdlib.h>
@@ -46,5 +49,145 @@ namespace spargel::base {
             p = alloc->resize(p, 1024, 512);
             alloc->free(p, 512);
         }
+        TEST(ArenaAllocator_Basic) {
+            DummyAlloc parent;
+            {
+                ArenaAllocator arena(&parent, 1024);
+                auto a = static_cast<u8*>(arena.allocate(3));
+                auto b = static_cast<u8*>(arena.allocate(5));
+                spargel_check(reinterpret_cast<usize>(a) % ArenaAllocator::alignment == 0);
+                spargel_check(reinterpret_cast<usize>(b) % ArenaAllocator::alignment == 0);
+                spargel_check(b - a == ArenaAllocator::alignment);
+                spargel_check(arena.bytesUsed() == 2 * ArenaAllocator::alignment);
+                spargel_check(arena.bytesReserved() == 1024);
+
+                // Larger than a chunk.
+                auto c = arena.allocate(4096);
+                spargel_check(c != nullptr);
+                spargel_check(arena.bytesReserved() > 1024 + 4096);
+
+                auto p = arena.allocObject<int>(42);
+                spargel_check(*p == 42);
+                arena.freeObject(p);
+            }
+        }
+        TEST(ArenaAllocator_ResizeAndFree) {
+            ArenaAllocator arena;
+            auto a = static_cast<u8*>(arena.allocate(16));
+            a[0] = 7;
+            // The most recent allocation grows in place.
+            auto b = static_cast<u8*>(arena.resize(a, 16, 64));
+            spargel_check(a == b);
+            spargel_check(arena.bytesUsed() == 64);
+
+            auto c = static_cast<u8*>(arena.allocate(16));
+            // Not the most recent allocation, so it moves.
+            auto d = static_cast<u8*>(arena.resize(b, 64, 128));
+            spargel_check(d != b);
+            spargel_check(d[0] == 7);
+
+            // Freeing the most recent allocation gives the memory back.
+            usize used = arena.bytesUsed();
+            arena.free(d, 128);
+            spargel_check(arena.bytesUsed() == used - 128);
+            // Otherwise it is a no-op.
+            arena.free(c, 16);
+            spargel_check(arena.bytesUsed() == used - 128);
+        }
+        TEST(ArenaAllocator_Reset) {
+            DummyAlloc parent;
+            {
+                ArenaAllocator arena(&parent, 256);
+                for (int i = 0; i < 100; i++) {
+                    arena.allocate(100);
+                }
+                usize reserved = arena.bytesReserved();
+                arena.reset();
+                spargel_check(arena.bytesUsed() == 0);
+                // Chunks are recycled.
+                spargel_check(arena.bytesReserved() == reserved);
+                for (int i = 0; i < 100; i++) {
+                    arena.allocate(100);
+                }
+                spargel_check(arena.bytesReserved() == reserved);
+
+                arena.release();
+                spargel_check(arena.bytesReserved() == 0);
+            }
+            {
+                ArenaAllocator arena(&parent, 256, false);
+                for (int i = 0; i < 100; i++) {
+                    arena.allocate(100);
+                }
+                arena.reset();
+                spargel_check(arena.bytesReserved() == 0);
+            }
+        }
+        TEST(ArenaAllocator_Scope) {
+            ArenaAllocator arena(default_allocator(), 256);
+            arena.allocate(32);
+            usize used = arena.bytesUsed();
+            auto before = arena.allocate(16);
+            arena.free(before, 16);
+            {
+                ArenaScope scope(&arena);
+                for (int i = 0; i < 100; i++) {
+                    scope.get()->allocate(100);
+                }
+            }
+            spargel_check(arena.bytesUsed() == used);
+            // The next allocation reuses the rewound memory.
+            spargel_check(arena.allocate(16) == before);
+        }
+        TEST(ArenaAllocator_ThreadArena) {
+            auto arena = thread_arena();
+            spargel_check(arena == thread_arena());
+            ArenaScope scope(arena);
+            spargel_check(arena->allocate(8) != nullptr);
+        }
+        TEST(TrackingAllocator_Stats) {
+            DummyAlloc parent;
+            TrackingAllocator tracker(&parent);
+
+            auto a = tracker.allocate(100);
+            auto b = tracker.tagged(AllocationTag::json)->allocate(1000);
+            b = tracker.tagged(AllocationTag::json)->resize(b, 1000, 3000);
+            tracker.free(a, 100);
+
+            auto total = tracker.totals();
+            spargel_check(total.live_bytes == 3000);
+            spargel_check(total.peak_bytes == 3100);
+            spargel_check(total.allocations == 2);
+            spargel_check(total.resizes == 1);
+            spargel_check(total.frees == 1);
+            // 100 is in [64, 128), 1000 in [512, 1024).
+            spargel_check(total.histogram[7] == 1);
+            spargel_check(total.histogram[10] == 1);
+
+            auto empty = tracker.allocate(0);
+            spargel_check(tracker.totals().histogram[0] == 1);
+            tracker.free(empty, 0);
+
+            auto json = tracker.stats(AllocationTag::json);
+            spargel_check(json.live_bytes == 3000);
+            spargel_check(json.allocations == 1);
+            spargel_check(tracker.stats(AllocationTag::untagged).live_bytes == 0);
+            spargel_check(tracker.stats(AllocationTag::untagged).peak_bytes == 100);
+
+            tracker.tagged(AllocationTag::json)->free(b, 3000);
+            spargel_check(tracker.totals().live_bytes == 0);
+        }
+        TEST(TrackingAllocator_Containers) {
+            DummyAlloc parent;
+            TrackingAllocator tracker(&parent);
+            {
+                vector<int> v(tracker.tagged(AllocationTag::vector));
+                for (int i = 0; i < 100; i++) v.emplace(i);
+                spargel_check(tracker.stats(AllocationTag::vector).live_bytes ==
+                              static_cast<i64>(v.capacity() * sizeof(int)));
+            }
+            spargel_check(tracker.stats(AllocationTag::vector).live_bytes == 0);
+            spargel_check(tracker.stats(AllocationTag::vector).frees > 0);
+        }
     }  // namespace
 }  // namespace spargel::base
@@ -0,0 +1,147 @@
+#include "spargel/base/arena_allocator.h"
+
+#include "spargel/base/check.h"
+
+// libc
+#include <string.h>
+
+namespace spargel::base {
+
+    // The header at the start of every chunk. Usable memory follows it.
+    struct ArenaAllocator::Chunk {
+        Chunk* next;
+        // Total size, including the header.
+        usize size;
+
+        Byte* begin() { return reinterpret_cast<Byte*>(this) + header_size; }
+        Byte* end() { return reinterpret_cast<Byte*>(this) + size; }
+
+        static constexpr usize header_size = alignUp(sizeof(Chunk*) + sizeof(usize));
+    };
+
+    ArenaAllocator::ArenaAllocator(Allocator* parent, usize chunk_size, bool recycle_chunks)
+        : _parent{parent}, _chunk_size{chunk_size}, _recycle{recycle_chunks} {
+        spargel_check(_parent != nullptr);
+        spargel_check(_chunk_size > Chunk::header_size);
+    }
+
+    ArenaAllocator::~ArenaAllocator() { release(); }
+
+    void* ArenaAllocator::allocateSlow(usize n) {
+        Chunk* c = acquireChunk(n);
+        c->next = _chunks;
+        _chunks = c;
+        _cur = c->begin();
+        _end = c->end();
+
+        Byte* p = _cur;
+        _cur += n;
+        _used += n;
+        _last = p;
+        return p;
+    }
+
+    ArenaAllocator::Chunk* ArenaAllocator::acquireChunk(usize min_size) {
+        usize size = min_size + Chunk::header_size;
+        if (size <= _chunk_size) {
+            if (_free_chunks != nullptr) {
+                Chunk* c = _free_chunks;
+                _free_chunks = c->next;
+                return c;
+            }
+            size = _chunk_size;
+        }
+        auto c = static_cast<Chunk*>(_parent->allocate(size));
+        c->next = nullptr;
+        c->size = size;
+        _reserved += size;
+        return c;
+    }
+
+    void ArenaAllocator::freeChunks(Chunk* c) {
+        while (c != nullptr) {
+            Chunk* next = c->next;
+            if (_recycle && c->size == _chunk_size) {
+                c->next = _free_chunks;
+                _free_chunks = c;
+            } else {
+                _reserved -= c->size;
+                _parent->free(c, c->size);
+            }
+            c = next;
+        }
+    }
+
+    void* ArenaAllocator::resize(void* ptr, usize old_size, usize new_size) {
+        spargel_check(ptr != nullptr);
+        auto p = static_cast<Byte*>(ptr);
+        usize n = alignUp(new_size);
+        if (p == _last && static_cast<usize>(_end - p) >= n) {
+            _used = _used - static_cast<usize>(_cur - p) + n;
+            _cur = p + n;
+            return ptr;
+        }
+        if (new_size <= old_size) {
+            return ptr;
+        }
+        void* q = allocate(new_size);
+        memcpy(q, ptr, old_size);
+        return q;
+    }
+
+    void ArenaAllocator::free(void* ptr, [[maybe_unused]] usize size) {
+        spargel_check(ptr != nullptr);
+        auto p = static_cast<Byte*>(ptr);
+        if (p == _last) {
+            _used -= static_cast<usize>(_cur - p);
+            _cur = p;
+            _last = nullptr;
+        }
+    }
+
+    void ArenaAllocator::reset() {
+        freeChunks(_chunks);
+        _chunks = nullptr;
+        _cur = nullptr;
+        _end = nullptr;
+        _last = nullptr;
+        _used = 0;
+    }
+
+    void ArenaAllocator::release() {
+        reset();
+        Chunk* c = _free_chunks;
+        _free_chunks = nullptr;
+        while (c != nullptr) {
+            Chunk* next = c->next;
+            _reserved -= c->size;
+            _parent->free(c, c->size);
+            c = next;
+        }
+    }
+
+    void ArenaAllocator::rewind(Marker m) {
+        auto target = static_cast<Chunk*>(m.chunk);
+        if (target == nullptr) {
+            reset();
+            return;
+        }
+        while (_chunks != target) {
+            spargel_check(_chunks != nullptr);
+            Chunk* c = _chunks;
+            _chunks = c->next;
+            c->next = nullptr;
+            freeChunks(c);
+        }
+        _cur = m.cur;
+        _end = target->end();
+        _last = nullptr;
+        _used = m.used;
+    }
+
+    ArenaAllocator* thread_arena() {
+        thread_local ArenaAllocator arena;
+        return &arena;
+    }
+
+}  // namespace spargel::base
@@ -0,0 +1,125 @@
+#pragma once
+
+#include "spargel/base/allocator.h"
+#include "spargel/base/types.h"
+
+namespace spargel::base {
+
+    // ArenaAllocator
+    //
+    // A bump allocator. Memory is carved out of large chunks obtained from a parent allocator,
+    // and is released all at once by `reset()`. This is intended for short-lived data with a
+    // well-defined lifetime, e.g. per-frame UI scene building or per-document JSON parsing.
+    //
+    // Note:
+    //     - `free` only gives memory back when it is the most recent allocation.
+    //       Otherwise it is a no-op, and the memory is reclaimed on `reset()`.
+    //     - `resize` extends the most recent allocation in place if possible.
+    //     - All allocations are aligned to `alignment`, the same guarantee as `malloc`.
+    //     - Not thread-safe. Use `thread_arena()` for a per-thread instance.
+    //
+    class ArenaAllocator final : public Allocator {
+    public:
+        static constexpr usize alignment = 16;
+        static constexpr usize default_chunk_size = 64 * 1024;
+
+        // A position in the arena, see `mark()` and `rewind()`.
+        struct Marker {
+            void* chunk;
+            Byte* cur;
+            usize used;
+        };
+
+        // Parameters:
+        //     - `parent` provides the chunks.
+        //     - `chunk_size` is the size of a regular chunk (including the chunk header).
+        //     - `recycle_chunks` keeps the chunks on `reset()` for later reuse instead of
+        //       returning them to `parent`.
+        //
+        explicit ArenaAllocator(Allocator* parent = default_allocator(),
+                                usize chunk_size = default_chunk_size, bool recycle_chunks = true);
+        ~ArenaAllocator() override;
+
+        ArenaAllocator(ArenaAllocator const&) = delete;
+        ArenaAllocator& operator=(ArenaAllocator const&) = delete;
+
+        void* allocate(usize size) override {
+            usize n = alignUp(size);
+            if (static_cast<usize>(_end - _cur) < n) [[unlikely]] {
+                return allocateSlow(n);
+            }
+            Byte* p = _cur;
+            _cur += n;
+            _used += n;
+            _last = p;
+            return p;
+        }
+        void* resize(void* ptr, usize old_size, usize new_size) override;
+        void free(void* ptr, usize size) override;
+
+        // Release all allocations at once. O(number of chunks).
+        void reset();
+
+        // Return every chunk to the parent allocator.
+        void release();
+
+        Marker mark() const { return Marker{_chunks, _cur, _used}; }
+
+        // Release every allocation made after `m` was taken.
+        void rewind(Marker m);
+
+        // Bytes handed out since the last `reset()` (after alignment).
+        usize bytesUsed() const { return _used; }
+        // Bytes obtained from the parent allocator and not yet returned.
+        usize bytesReserved() const { return _reserved; }
+
+    private:
+        struct Chunk;
+
+        static constexpr usize alignUp(usize n) { return (n + alignment - 1) & ~(alignment - 1); }
+
+        void* allocateSlow(usize n);
+        Chunk* acquireChunk(usize min_size);
+        void freeChunks(Chunk* c);
+
+        Allocator* _parent;
+        usize _chunk_size;
+        bool _recycle;
+
+        // Chunks in use, the one being bumped at the front.
+        Chunk* _chunks = nullptr;
+        // Recycled chunks of size `_chunk_size`.
+        Chunk* _free_chunks = nullptr;
+
+        Byte* _cur = nullptr;
+        Byte* _end = nullptr;
+        // The start of the most recent allocation, for in-place `resize` and `free`.
+        Byte* _last = nullptr;
+
+        usize _used = 0;
+        usize _reserved = 0;
+    };
+
+    // ArenaScope
+    //
+    // Rewinds the arena to where it was on construction, e.g. at the end of a frame.
+    //
+    class ArenaScope {
+    public:
+        explicit ArenaScope(ArenaAllocator* arena) : _arena{arena}, _marker{arena->mark()} {}
+        ~ArenaScope() { _arena->rewind(_marker); }
+
+        ArenaScope(ArenaScope const&) = delete;
+        ArenaScope& operator=(ArenaScope const&) = delete;
+
+        ArenaAllocator* get() const { return _arena; }
+
+    private:
+        ArenaAllocator* _arena;
+        ArenaAllocator::Marker _marker;
+    };
+
+    // The arena owned by the calling thread. It lives until the thread exits.
+    ArenaAllocator* thread_arena();
+
+}  // namespace spargel::base
@@ -0,0 +1,72 @@
+#include "spargel/base/allocator.h"
+#include "spargel/base/arena_allocator.h"
+
+//
+#include <stdio.h>
+#include <time.h>
+
+namespace spargel::base {
+    namespace {
+        // A frame-like workload: many short-lived small allocations, all dropped at the end.
+        constexpr usize frame_count = 1000;
+        constexpr usize allocs_per_frame = 4096;
+
+        u64 nowNanos() {
+            timespec ts;
+            timespec_get(&ts, TIME_UTC);
+            return static_cast<u64>(ts.tv_sec) * 1000000000 + static_cast<u64>(ts.tv_nsec);
+        }
+
+        usize sizeOf(usize i) { return 8 + (i * 37) % 248; }
+
+        void* ptrs[allocs_per_frame];
+
+        // Keep the allocation from being optimized out.
+        volatile u8 sink;
+
+        void runDefault() {
+            Allocator* alloc = default_allocator();
+            for (usize f = 0; f < frame_count; f++) {
+                for (usize i = 0; i < allocs_per_frame; i++) {
+                    ptrs[i] = alloc->allocate(sizeOf(i));
+                    static_cast<u8*>(ptrs[i])[0] = static_cast<u8>(i);
+                }
+                for (usize i = 0; i < allocs_per_frame; i++) {
+                    sink = static_cast<u8*>(ptrs[i])[0];
+                    alloc->free(ptrs[i], sizeOf(i));
+                }
+            }
+        }
+
+        void runArena() {
+            ArenaAllocator arena;
+            // Through the base interface, so that the comparison is fair.
+            Allocator* alloc = &arena;
+            for (usize f = 0; f < frame_count; f++) {
+                for (usize i = 0; i < allocs_per_frame; i++) {
+                    ptrs[i] = alloc->allocate(sizeOf(i));
+                    static_cast<u8*>(ptrs[i])[0] = static_cast<u8>(i);
+                }
+                for (usize i = 0; i < allocs_per_frame; i++) {
+                    sink = static_cast<u8*>(ptrs[i])[0];
+                }
+                arena.reset();
+            }
+        }
+
+        void report(char const* name, void (*fn)()) {
+            u64 start = nowNanos();
+            fn();
+            u64 elapsed = nowNanos() - start;
+            printf("%-8s %10.3f ms %8.2f ns/alloc\n", name, (double)elapsed / 1e6,
+                   (double)elapsed / (double)(frame_count * allocs_per_frame));
+        }
+    }  // namespace
+}  // namespace spargel::base
+
+int main() {
+    using namespace spargel::base;
+    report("libc", runDefault);
+    report("arena", runArena);
+    return 0;
+}
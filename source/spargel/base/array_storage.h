@@ -17,7 +17,7 @@ namespace spargel::base {
         //     - It doesn't make sense to copy `ArrayStorage` unless `T` is trivially copyable.
         //       For simplicity, copy is banned unconditionally.
         //     - The status of the each slot is not tracked.
-        //       So there is no way to swap two `ArrayStorage` with different allocators.
+        //       So swapping two `ArrayStorage` exchanges their allocators as well.
         //
         // TODO:
         //     - Rewrite to `OptionalArray`.
@@ -31,10 +31,12 @@ namespace spargel::base {
             //
             // Parameters:
             //     - `count` is the required capacity
+            //     - `alloc` provides the storage
             //
-            ArrayStorage(usize count) : _count{count} {
-                if (count > 0)
-                    _data = static_cast<Byte*>(default_allocator()->allocate(count * sizeof(T)));
+            ArrayStorage(usize count, Allocator* alloc = default_allocator())
+                : _count{count}, _alloc{alloc} {
+                spargel_check(alloc != nullptr);
+                if (count > 0) _data = static_cast<Byte*>(_alloc->allocate(count * sizeof(T)));
             }
 
             // Copy constructor is removed.
@@ -42,7 +44,8 @@ namespace spargel::base {
             ArrayStorage& operator=(ArrayStorage const&) = delete;
 
             // Move is cheap.
-            ArrayStorage(ArrayStorage&& other) : _count{other._count}, _data{other._data} {
+            ArrayStorage(ArrayStorage&& other)
+                : _count{other._count}, _data{other._data}, _alloc{other._alloc} {
                 other._count = 0;
                 other._data = nullptr;
             }
@@ -54,10 +57,12 @@ namespace spargel::base {
 
             ~ArrayStorage() {
                 if (_data != nullptr) {
-                    default_allocator()->free(_data, _count * sizeof(T));
+                    _alloc->free(_data, _count * sizeof(T));
                 }
             }
 
+            Allocator* getAllocator() const { return _alloc; }
+
             // Get the number of slots provided.
             usize getCount() const { return _count; }
 
@@ -96,12 +101,14 @@ namespace spargel::base {
             friend void tag_invoke(tag<swap>, ArrayStorage& lhs, ArrayStorage& rhs) {
                 swap(lhs._count, rhs._count);
                 swap(lhs._data, rhs._data);
+                swap(lhs._alloc, rhs._alloc);
             }
 
         private:
             usize _count = 0;
             // Storage is explicitly provided via a `Byte` array.
             Byte* _data = nullptr;
+            Allocator* _alloc = default_allocator();
         };
 
     }  // namespace _array_storage
@@ -0,0 +1,310 @@
+#pragma once
+
+#include "spargel/base/compiler.h"
+#include "spargel/base/types.h"
+
+#if SPARGEL_HAS_SSE2
+#include <emmintrin.h>
+#endif
+
+#if SPARGEL_IS_MSVC
+#include <intrin.h>
+#endif
+
+namespace spargel::base {
+
+#if SPARGEL_IS_MSVC
+    // MSVC has no `__atomic` builtins. Every operation is a full barrier there, which is at
+    // least as strong as any order asked for.
+    enum class MemoryOrder : int {
+        relaxed,
+        acquire,
+        release,
+        acq_rel,
+        seq_cst,
+    };
+
+    namespace detail {
+        template <usize N>
+        struct Interlocked;
+
+        template <>
+        struct Interlocked<1> {
+            using Word = char;
+            static Word cas(Word volatile* p, Word expected, Word desired) {
+                return _InterlockedCompareExchange8(p, desired, expected);
+            }
+        };
+        template <>
+        struct Interlocked<2> {
+            using Word = short;
+            static Word cas(Word volatile* p, Word expected, Word desired) {
+                return _InterlockedCompareExchange16(p, desired, expected);
+            }
+        };
+        template <>
+        struct Interlocked<4> {
+            using Word = long;
+            static Word cas(Word volatile* p, Word expected, Word desired) {
+                return _InterlockedCompareExchange(p, desired, expected);
+            }
+        };
+        template <>
+        struct Interlocked<8> {
+            using Word = __int64;
+            static Word cas(Word volatile* p, Word expected, Word desired) {
+                return _InterlockedCompareExchange64(p, desired, expected);
+            }
+        };
+
+        inline long volatile fence_word = 0;
+    }  // namespace detail
+#else
+    enum class MemoryOrder : int {
+        relaxed = __ATOMIC_RELAXED,
+        acquire = __ATOMIC_ACQUIRE,
+        release = __ATOMIC_RELEASE,
+        acq_rel = __ATOMIC_ACQ_REL,
+        seq_cst = __ATOMIC_SEQ_CST,
+    };
+#endif
+
+    // Atomic
+    //
+    // A thin wrapper over the compiler atomic builtins.
+    //
+    // Note:
+    //     - `T` must be an integer, an enum, or a pointer.
+    //     - Every operation takes an explicit memory order, defaulting to `seq_cst`.
+    //
+    template <typename T>
+    class Atomic {
+    public:
+        constexpr Atomic() = default;
+        constexpr Atomic(T value) : _value{value} {}
+
+        Atomic(Atomic const&) = delete;
+        Atomic& operator=(Atomic const&) = delete;
+
+#if SPARGEL_IS_MSVC
+        T load(MemoryOrder = MemoryOrder::seq_cst) const {
+            auto p = const_cast<Word volatile*>(reinterpret_cast<Word const volatile*>(&_value));
+            return fromWord(Ops::cas(p, 0, 0));
+        }
+        void store(T value, MemoryOrder order = MemoryOrder::seq_cst) { exchange(value, order); }
+        T exchange(T value, MemoryOrder = MemoryOrder::seq_cst) {
+            return update([value](T) { return value; });
+        }
+
+        bool compareExchange(T& expected, T desired, MemoryOrder = MemoryOrder::seq_cst,
+                             MemoryOrder = MemoryOrder::seq_cst) {
+            Word old = Ops::cas(word(), toWord(expected), toWord(desired));
+            if (old == toWord(expected)) return true;
+            expected = fromWord(old);
+            return false;
+        }
+        bool compareExchangeWeak(T& expected, T desired,
+                                 MemoryOrder success = MemoryOrder::seq_cst,
+                                 MemoryOrder failure = MemoryOrder::seq_cst) {
+            return compareExchange(expected, desired, success, failure);
+        }
+
+        T fetchAdd(T delta, MemoryOrder = MemoryOrder::seq_cst) {
+            return update([delta](T x) { return static_cast<T>(x + delta); });
+        }
+        T fetchSub(T delta, MemoryOrder = MemoryOrder::seq_cst) {
+            return update([delta](T x) { return static_cast<T>(x - delta); });
+        }
+        T fetchOr(T bits, MemoryOrder = MemoryOrder::seq_cst) {
+            return update([bits](T x) { return static_cast<T>(x | bits); });
+        }
+        T fetchAnd(T bits, MemoryOrder = MemoryOrder::seq_cst) {
+            return update([bits](T x) { return static_cast<T>(x & bits); });
+        }
+#else
+        T load(MemoryOrder order = MemoryOrder::seq_cst) const {
+            return __atomic_load_n(&_value, static_cast<int>(order));
+        }
+        void store(T value, MemoryOrder order = MemoryOrder::seq_cst) {
+            __atomic_store_n(&_value, value, static_cast<int>(order));
+        }
+        T exchange(T value, MemoryOrder order = MemoryOrder::seq_cst) {
+            return __atomic_exchange_n(&_value, value, static_cast<int>(order));
+        }
+
+        // On failure, `expected` is updated to the current value.
+        bool compareExchange(T& expected, T desired, MemoryOrder success = MemoryOrder::seq_cst,
+                             MemoryOrder failure = MemoryOrder::seq_cst) {
+            return __atomic_compare_exchange_n(&_value, &expected, desired, false,
+                                               static_cast<int>(success),
+                                               static_cast<int>(failure));
+        }
+        // May fail spuriously. Use in loops.
+        bool compareExchangeWeak(T& expected, T desired,
+                                 MemoryOrder success = MemoryOrder::seq_cst,
+                                 MemoryOrder failure = MemoryOrder::seq_cst) {
+            return __atomic_compare_exchange_n(&_value, &expected, desired, true,
+                                               static_cast<int>(success),
+                                               static_cast<int>(failure));
+        }
+
+        // Return the previous value.
+        T fetchAdd(T delta, MemoryOrder order = MemoryOrder::seq_cst) {
+            return __atomic_fetch_add(&_value, delta, static_cast<int>(order));
+        }
+        T fetchSub(T delta, MemoryOrder order = MemoryOrder::seq_cst) {
+            return __atomic_fetch_sub(&_value, delta, static_cast<int>(order));
+        }
+        T fetchOr(T bits, MemoryOrder order = MemoryOrder::seq_cst) {
+            return __atomic_fetch_or(&_value, bits, static_cast<int>(order));
+        }
+        T fetchAnd(T bits, MemoryOrder order = MemoryOrder::seq_cst) {
+            return __atomic_fetch_and(&_value, bits, static_cast<int>(order));
+        }
+
+#endif
+
+        // The address of the value, e.g. for futex.
+        T* raw() { return &_value; }
+
+    private:
+#if SPARGEL_IS_MSVC
+        using Ops = detail::Interlocked<sizeof(T)>;
+        using Word = typename Ops::Word;
+
+        static Word toWord(T x) { return __builtin_bit_cast(Word, x); }
+        static T fromWord(Word x) { return __builtin_bit_cast(T, x); }
+        Word volatile* word() { return reinterpret_cast<Word volatile*>(&_value); }
+
+        // Replace the value with `f(value)` and return the previous value.
+        template <typename F>
+        T update(F f) {
+            Word old = Ops::cas(word(), 0, 0);
+            for (;;) {
+                Word seen = Ops::cas(word(), old, toWord(f(fromWord(old))));
+                if (seen == old) return fromWord(old);
+                old = seen;
+            }
+        }
+#endif
+
+        T _value{};
+    };
+
+    inline void atomic_fence(MemoryOrder order = MemoryOrder::seq_cst) {
+#if SPARGEL_IS_MSVC
+        (void)order;
+        _InterlockedOr(&detail::fence_word, 0);
+#else
+        __atomic_thread_fence(static_cast<int>(order));
+#endif
+    }
+
+    // Block while `*addr == expected`, like a futex. May return spuriously, so callers recheck
+    // in a loop. Implemented in platform_*.cpp.
+    void atomic_wait(u32* addr, u32 expected);
+    // Wake one or all threads blocked in `atomic_wait` on `addr`.
+    void atomic_notify_one(u32* addr);
+    void atomic_notify_all(u32* addr);
+
+    // A hint to the processor inside spin-wait loops.
+    inline void cpu_relax() {
+#if SPARGEL_HAS_SSE2
+        _mm_pause();
+#elif SPARGEL_IS_MSVC && defined(_M_ARM64)
+        __yield();
+#elif defined(__aarch64__)
+        __asm__ volatile("yield");
+#endif
+    }
+
+    // SpinLock
+    //
+    // A test-and-test-and-set lock for very short critical sections.
+    //
+    class SpinLock {
+    public:
+        SpinLock() = default;
+
+        SpinLock(SpinLock const&) = delete;
+        SpinLock& operator=(SpinLock const&) = delete;
+
+        void lock() {
+            for (;;) {
+                if (!_locked.exchange(true, MemoryOrder::acquire)) return;
+                while (_locked.load(MemoryOrder::relaxed)) cpu_relax();
+            }
+        }
+        bool tryLock() {
+            return !_locked.load(MemoryOrder::relaxed) &&
+                   !_locked.exchange(true, MemoryOrder::acquire);
+        }
+        void unlock() { _locked.store(false, MemoryOrder::release); }
+
+    private:
+        Atomic<bool> _locked{false};
+    };
+
+    // Mutex
+    //
+    // A lock whose waiters sleep in `atomic_wait`, for critical sections that may be long or
+    // contended.
+    //
+    class Mutex {
+    public:
+        Mutex() = default;
+
+        Mutex(Mutex const&) = delete;
+        Mutex& operator=(Mutex const&) = delete;
+
+        void lock() {
+            u32 state = unlocked;
+            if (_state.compareExchange(state, locked, MemoryOrder::acquire,
+                                       MemoryOrder::relaxed)) {
+                return;
+            }
+            // Once a thread has slept, the lock stays `contended` until it is released, so that
+            // the holder wakes the next sleeper.
+            if (state != contended) state = _state.exchange(contended, MemoryOrder::acquire);
+            while (state != unlocked) {
+                atomic_wait(_state.raw(), contended);
+                state = _state.exchange(contended, MemoryOrder::acquire);
+            }
+        }
+        bool tryLock() {
+            u32 state = unlocked;
+            return _state.compareExchange(state, locked, MemoryOrder::acquire,
+                                          MemoryOrder::relaxed);
+        }
+        void unlock() {
+            if (_state.exchange(unlocked, MemoryOrder::release) == contended) {
+                atomic_notify_one(_state.raw());
+            }
+        }
+
+    private:
+        static constexpr u32 unlocked = 0;
+        static constexpr u32 locked = 1;
+        static constexpr u32 contended = 2;
+
+        Atomic<u32> _state{unlocked};
+    };
+
+    // LockGuard
+    //
+    // Holds the lock for the lifetime of the guard.
+    //
+    template <typename L>
+    class LockGuard {
+    public:
+        explicit LockGuard(L& lock) : _lock{lock} { _lock.lock(); }
+        ~LockGuard() { _lock.unlock(); }
+
+        LockGuard(LockGuard const&) = delete;
+        LockGuard& operator=(LockGuard const&) = delete;
+
+    private:
+        L& _lock;
+    };
+
+}  // namespace spargel::base
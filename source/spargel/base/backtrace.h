@@ -1,5 +1,36 @@
 #pragma once
 
+#include "spargel/base/attribute.h"
+#include "spargel/base/types.h"
+
 namespace spargel::base {
     void PrintBacktrace();
+
+    // Store the return addresses of the calling thread's stack into `frames`, innermost first,
+    // and return how many were stored. The frame of `capture_backtrace` itself is not included.
+    //
+    // Note:
+    //     - Async-signal-safe, once it has been called outside of a signal handler: the first
+    //       call may load the unwinder.
+    //     - Returns zero where stacks cannot be walked.
+    //
+    usize capture_backtrace(void** frames, usize max_frames);
+
+    namespace detail {
+        // The body of `capture_backtrace` for a `backtrace`-like walker. It is inlined into
+        // `capture_backtrace`, so the first frame the walker stores is the one to skip.
+        template <int (*Walk)(void**, int)>
+        SPARGEL_ALWAYS_INLINE inline usize capture_backtrace_with(void** frames,
+                                                                  usize max_frames) {
+            constexpr usize buf_size = 128;
+            void* buf[buf_size];
+            usize want = max_frames + 1 < buf_size ? max_frames + 1 : buf_size;
+            int count = Walk(buf, static_cast<int>(want));
+            usize n = 0;
+            for (int i = 1; i < count; i++) {
+                frames[n++] = buf[i];
+            }
+            return n;
+        }
+    }  // namespace detail
 }
@@ -0,0 +1,228 @@
+#include "spargel/base/benchmark.h"
+
+#include "spargel/base/platform.h"
+
+// libc
+#include <stdio.h>
+#include <string.h>
+
+namespace spargel::base {
+
+    namespace {
+        // Keep calibration from running away on benchmarks that do nothing.
+        constexpr u64 max_iterations = 1000000000;
+
+        void sort_samples(vector<f64>& v) {
+            for (usize i = 1; i < v.count(); i++) {
+                f64 x = v[i];
+                usize j = i;
+                for (; j > 0 && v[j - 1] > x; j--) {
+                    v[j] = v[j - 1];
+                }
+                v[j] = x;
+            }
+        }
+
+        // Print a duration with three significant digits and a unit.
+        void print_time(f64 ns) {
+            if (ns < 1e3) {
+                printf("%9.2f ns", ns);
+            } else if (ns < 1e6) {
+                printf("%9.2f us", ns / 1e3);
+            } else if (ns < 1e9) {
+                printf("%9.2f ms", ns / 1e6);
+            } else {
+                printf("%9.2f s ", ns / 1e9);
+            }
+        }
+
+        // Items are printed without a unit, bytes with "B".
+        void print_rate(f64 per_second, char const* unit) {
+            char buf[32] = "";
+            if (per_second >= 1e9) {
+                snprintf(buf, sizeof(buf), "%.2f G%s/s", per_second / 1e9, unit);
+            } else if (per_second >= 1e6) {
+                snprintf(buf, sizeof(buf), "%.2f M%s/s", per_second / 1e6, unit);
+            } else if (per_second >= 1e3) {
+                snprintf(buf, sizeof(buf), "%.2f K%s/s", per_second / 1e3, unit);
+            } else if (per_second > 0) {
+                snprintf(buf, sizeof(buf), "%.2f %s/s", per_second, unit);
+            }
+            printf(" %14s", buf);
+        }
+
+        void print_header(BenchmarkFormat format, bool counters) {
+            switch (format) {
+            case BenchmarkFormat::table:
+                printf("%-40s %12s %12s %12s %12s %14s %14s", "benchmark", "iterations", "min",
+                       "median", "p99", "items", "bytes");
+                if (counters) {
+                    printf(" %6s %12s %12s", "IPC", "cache-miss/i", "branch-miss/i");
+                }
+                printf("\n");
+                break;
+            case BenchmarkFormat::csv:
+                printf("name,iterations,samples,min_ns,median_ns,p99_ns,items_per_second,"
+                       "bytes_per_second,ipc,cache_misses_per_item,branch_misses_per_item\n");
+                break;
+            case BenchmarkFormat::json:
+                printf("[\n");
+                break;
+            }
+        }
+
+        void print_result(BenchmarkFormat format, BenchmarkResult const& r, bool first,
+                          bool counters) {
+            switch (format) {
+            case BenchmarkFormat::table:
+                printf("%-40s %12llu ", r.name, static_cast<unsigned long long>(r.iterations));
+                print_time(r.min_ns);
+                printf(" ");
+                print_time(r.median_ns);
+                printf(" ");
+                print_time(r.p99_ns);
+                print_rate(r.items_per_second, "");
+                print_rate(r.bytes_per_second, "B");
+                if (counters) {
+                    printf(" %6.2f %12.4f %12.4f", r.ipc, r.cache_misses_per_item,
+                           r.branch_misses_per_item);
+                }
+                printf("\n");
+                break;
+            case BenchmarkFormat::csv:
+                printf("%s,%llu,%u,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.6f,%.6f\n", r.name,
+                       static_cast<unsigned long long>(r.iterations), r.samples, r.min_ns,
+                       r.median_ns, r.p99_ns, r.items_per_second, r.bytes_per_second, r.ipc,
+                       r.cache_misses_per_item, r.branch_misses_per_item);
+                break;
+            case BenchmarkFormat::json:
+                // Benchmark names are identifiers, so they need no escaping.
+                printf("%s  {\"name\": \"%s\", \"iterations\": %llu, \"samples\": %u, "
+                       "\"min_ns\": %.3f, \"median_ns\": %.3f, \"p99_ns\": %.3f, "
+                       "\"items_per_second\": %.3f, \"bytes_per_second\": %.3f, \"ipc\": %.3f, "
+                       "\"cache_misses_per_item\": %.6f, \"branch_misses_per_item\": %.6f}",
+                       first ? "" : ",\n", r.name, static_cast<unsigned long long>(r.iterations),
+                       r.samples, r.min_ns, r.median_ns, r.p99_ns, r.items_per_second,
+                       r.bytes_per_second, r.ipc, r.cache_misses_per_item,
+                       r.branch_misses_per_item);
+                break;
+            }
+            fflush(stdout);
+        }
+
+        void print_footer(BenchmarkFormat format) {
+            if (format == BenchmarkFormat::json) {
+                printf("\n]\n");
+            }
+        }
+    }  // namespace
+
+    bool BenchmarkState::startOrStop() {
+        if (!_started) {
+            _started = true;
+            _remaining = _iterations - 1;
+            if (_perf != nullptr) _perf_start = _perf->read();
+            _start = get_monotonic_time_ns();
+            return true;
+        }
+        _end = get_monotonic_time_ns();
+        if (_perf != nullptr) _perf_end = _perf->read();
+        return false;
+    }
+
+    BenchmarkManager* BenchmarkManager::getInstance() {
+        static BenchmarkManager manager;
+        return &manager;
+    }
+
+    BenchmarkResult BenchmarkManager::measure(BenchmarkEntry const& entry,
+                                              BenchmarkOptions const& options,
+                                              PerfCounterGroup const* perf) {
+        // Calibrate.
+        u64 iterations = 1;
+        u64 items = 0;
+        u64 bytes = 0;
+        for (;;) {
+            BenchmarkState state(iterations);
+            entry.benchmark->run(state);
+            items = state.itemsPerIteration();
+            bytes = state.bytesPerIteration();
+            u64 elapsed = state.elapsedNs();
+            if (elapsed >= options.min_sample_ns || iterations >= max_iterations) break;
+            // Aim a bit past the target, but grow at least 2x and at most 100x per round.
+            u64 next = elapsed == 0 ? iterations * 100
+                                    : static_cast<u64>(static_cast<f64>(iterations) * 1.2 *
+                                                       static_cast<f64>(options.min_sample_ns) /
+                                                       static_cast<f64>(elapsed));
+            if (next < iterations * 2) next = iterations * 2;
+            if (next > iterations * 100) next = iterations * 100;
+            iterations = next < max_iterations ? next : max_iterations;
+        }
+
+        // Warm up at the final count.
+        {
+            BenchmarkState state(iterations);
+            entry.benchmark->run(state);
+        }
+
+        u32 samples = options.samples > 0 ? options.samples : 1;
+        vector<f64> per_iteration;
+        per_iteration.reserve(samples);
+        PerfCounterValues counters;
+        for (u32 i = 0; i < samples; i++) {
+            BenchmarkState state(iterations, perf);
+            entry.benchmark->run(state);
+            per_iteration.emplace(static_cast<f64>(state.elapsedNs()) /
+                                  static_cast<f64>(iterations));
+            counters += state.counters();
+        }
+        sort_samples(per_iteration);
+
+        BenchmarkResult r;
+        r.name = entry.name;
+        r.iterations = iterations;
+        r.samples = samples;
+        r.min_ns = per_iteration[0];
+        r.median_ns = per_iteration[samples / 2];
+        // Nearest rank.
+        r.p99_ns = per_iteration[(samples * 99 + 99) / 100 - 1];
+        f64 per_second = r.median_ns > 0 ? 1e9 / r.median_ns : 0;
+        r.items_per_second = static_cast<f64>(items) * per_second;
+        r.bytes_per_second = static_cast<f64>(bytes) * per_second;
+        f64 total_items = static_cast<f64>(samples) * static_cast<f64>(iterations) *
+                          static_cast<f64>(items > 0 ? items : 1);
+        r.ipc = counters.ipc();
+        r.cache_misses_per_item = static_cast<f64>(counters.cache_misses) / total_items;
+        r.branch_misses_per_item = static_cast<f64>(counters.branch_misses) / total_items;
+        return r;
+    }
+
+    void BenchmarkManager::runAll(BenchmarkOptions const& options) {
+        if (options.perf_counters) {
+            PerfCounterGroup group;
+            if (group.isAvailable()) {
+                runSelected(options, &group);
+                return;
+            }
+            fprintf(stderr, "hardware counters are not available: no PMU, or forbidden by "
+                            "/proc/sys/kernel/perf_event_paranoid\n");
+        }
+        runSelected(options, nullptr);
+    }
+
+    void BenchmarkManager::runSelected(BenchmarkOptions const& options,
+                                       PerfCounterGroup const* perf) {
+        print_header(options.format, perf != nullptr);
+        bool first = true;
+        for (usize i = 0; i < _benchmarks.count(); i++) {
+            auto entry = _benchmarks[i];
+            if (options.filter != nullptr && strstr(entry.name, options.filter) == nullptr) {
+                continue;
+            }
+            print_result(options.format, measure(entry, options, perf), first, perf != nullptr);
+            first = false;
+        }
+        print_footer(options.format);
+    }
+
+}  // namespace spargel::base
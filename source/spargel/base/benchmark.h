@@ -0,0 +1,178 @@
+#pragma once
+
+#include "spargel/base/allocator.h"
+#include "spargel/base/compiler.h"
+#include "spargel/base/perf_counters.h"
+#include "spargel/base/types.h"
+#include "spargel/base/vector.h"
+
+#if SPARGEL_IS_MSVC
+#include <intrin.h>
+#endif
+
+namespace spargel::base {
+
+    // Make the compiler assume `value` is read, so that computing it is not optimized away.
+    template <typename T>
+    inline void do_not_optimize(T const& value) {
+#if SPARGEL_IS_MSVC
+        _ReadWriteBarrier();
+        (void)*static_cast<char const volatile*>(static_cast<void const*>(&value));
+#else
+        asm volatile("" : : "r,m"(value) : "memory");
+#endif
+    }
+
+    // Make the compiler assume all memory is read and written, so that stores are not optimized
+    // away.
+    inline void clobber_memory() {
+#if SPARGEL_IS_MSVC
+        _ReadWriteBarrier();
+#else
+        asm volatile("" : : : "memory");
+#endif
+    }
+
+    // The state of one sample of a benchmark.
+    //
+    // Example:
+    //   BENCHMARK(Vector_Push) {
+    //     // setup, not timed
+    //     while (state.keepRunning()) {
+    //       // timed
+    //     }
+    //   }
+    //
+    // The timer starts at the first `keepRunning()`, and stops at the one returning false. So do
+    // the hardware counters, if `perf` is not null.
+    class BenchmarkState {
+    public:
+        explicit BenchmarkState(u64 iterations, PerfCounterGroup const* perf = nullptr)
+            : _iterations{iterations}, _perf{perf} {}
+
+        bool keepRunning() {
+            if (_remaining != 0) [[likely]] {
+                _remaining--;
+                return true;
+            }
+            return startOrStop();
+        }
+
+        // The number of loop iterations of this sample.
+        u64 iterations() const { return _iterations; }
+
+        // Report throughput: how many items or bytes one iteration processes.
+        void setItemsPerIteration(u64 n) { _items = n; }
+        void setBytesPerIteration(u64 n) { _bytes = n; }
+
+        u64 elapsedNs() const { return _end - _start; }
+        PerfCounterValues counters() const { return _perf_end - _perf_start; }
+        u64 itemsPerIteration() const { return _items; }
+        u64 bytesPerIteration() const { return _bytes; }
+
+    private:
+        bool startOrStop();
+
+        u64 _iterations;
+        u64 _remaining = 0;
+        bool _started = false;
+        u64 _start = 0;
+        u64 _end = 0;
+        u64 _items = 0;
+        u64 _bytes = 0;
+        PerfCounterGroup const* _perf;
+        PerfCounterValues _perf_start;
+        PerfCounterValues _perf_end;
+    };
+
+    class Benchmark {
+    public:
+        virtual ~Benchmark() = default;
+        virtual void run(BenchmarkState& state) = 0;
+    };
+
+    enum class BenchmarkFormat {
+        table,
+        csv,
+        json,
+    };
+
+    struct BenchmarkOptions {
+        // Run the benchmarks whose name contains this, or all if null.
+        char const* filter = nullptr;
+        BenchmarkFormat format = BenchmarkFormat::table;
+        // The number of timed samples.
+        u32 samples = 20;
+        // The iteration count is raised until one sample takes at least this long.
+        u64 min_sample_ns = 5000000;
+        // Count cycles, instructions, cache misses and branch misses of the timed samples, if
+        // the platform allows. See `PerfCounterGroup`.
+        bool perf_counters = false;
+    };
+
+    struct BenchmarkResult {
+        char const* name;
+        u64 iterations;
+        u32 samples;
+        // Per iteration, over the samples.
+        f64 min_ns;
+        f64 median_ns;
+        f64 p99_ns;
+        // Per second, at the median. Zero if not reported.
+        f64 items_per_second;
+        f64 bytes_per_second;
+        // Over all timed samples. Misses are per item, or per iteration if the benchmark does
+        // not report items. Zero without hardware counters.
+        f64 ipc;
+        f64 cache_misses_per_item;
+        f64 branch_misses_per_item;
+    };
+
+    class BenchmarkManager {
+    public:
+        static BenchmarkManager* getInstance();
+
+        template <typename T>
+        T* registerBenchmark(char const* name) {
+            T* ptr = default_allocator()->allocObject<T>();
+            _benchmarks.emplace(name, ptr);
+            return ptr;
+        }
+
+        // Run the benchmarks and print the results to stdout.
+        //
+        // Each benchmark is first calibrated: the iteration count grows until one sample takes
+        // `min_sample_ns`, which also warms up caches and the allocator. Then one more sample
+        // is run untimed, and `samples` samples are timed.
+        //
+        void runAll(BenchmarkOptions const& options);
+
+    private:
+        struct BenchmarkEntry {
+            char const* name;
+            Benchmark* benchmark;
+        };
+
+        void runSelected(BenchmarkOptions const& options, PerfCounterGroup const* perf);
+        BenchmarkResult measure(BenchmarkEntry const& entry, BenchmarkOptions const& options,
+                                PerfCounterGroup const* perf);
+
+        vector<BenchmarkEntry> _benchmarks;
+    };
+
+}  // namespace spargel::base
+
+#define _BENCHMARK_CLASS_NAME(name) _SpargelBenchmarkClass_##name
+
+#define BENCHMARK(name)                                                                       \
+    class _BENCHMARK_CLASS_NAME(name) final : public ::spargel::base::Benchmark {             \
+    public:                                                                                   \
+        void run(::spargel::base::BenchmarkState& state) override;                            \
+                                                                                              \
+    private:                                                                                  \
+        static _BENCHMARK_CLASS_NAME(name) * _instance;                                       \
+    };                                                                                        \
+    _BENCHMARK_CLASS_NAME(name) * _BENCHMARK_CLASS_NAME(name)::_instance =                    \
+        ::spargel::base::BenchmarkManager::getInstance()                                      \
+            ->registerBenchmark<_BENCHMARK_CLASS_NAME(name)>(#name);                          \
+    void _BENCHMARK_CLASS_NAME(name)::run(::spargel::base::BenchmarkState& state)
@@ -0,0 +1,61 @@
+#include "spargel/base/benchmark.h"
+
+// libc
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace {
+    using namespace spargel::base;
+
+    // Return the value of `--name=value`, or null if `arg` is not that option.
+    char const* option_value(char const* arg, char const* name) {
+        usize length = strlen(name);
+        if (strncmp(arg, name, length) != 0 || arg[length] != '=') return nullptr;
+        return arg + length + 1;
+    }
+
+    void print_usage(char const* program) {
+        fprintf(stderr,
+                "usage: %s [--filter=<substring>] [--format=table|csv|json] [--samples=<n>]\n"
+                "       [--min-time-ms=<ms>] [--perf] [--quick]\n",
+                program);
+    }
+}  // namespace
+
+int main(int argc, char const* argv[]) {
+    BenchmarkOptions options;
+    for (int i = 1; i < argc; i++) {
+        char const* arg = argv[i];
+        char const* value;
+        if ((value = option_value(arg, "--filter")) != nullptr) {
+            options.filter = value;
+        } else if ((value = option_value(arg, "--format")) != nullptr) {
+            if (strcmp(value, "table") == 0) {
+                options.format = BenchmarkFormat::table;
+            } else if (strcmp(value, "csv") == 0) {
+                options.format = BenchmarkFormat::csv;
+            } else if (strcmp(value, "json") == 0) {
+                options.format = BenchmarkFormat::json;
+            } else {
+                print_usage(argv[0]);
+                return 1;
+            }
+        } else if ((value = option_value(arg, "--samples")) != nullptr) {
+            options.samples = static_cast<u32>(strtoul(value, nullptr, 10));
+        } else if ((value = option_value(arg, "--min-time-ms")) != nullptr) {
+            options.min_sample_ns = strtoull(value, nullptr, 10) * 1000000;
+        } else if (strcmp(arg, "--perf") == 0) {
+            options.perf_counters = true;
+        } else if (strcmp(arg, "--quick") == 0) {
+            // One short sample each, to check that the benchmarks run.
+            options.samples = 1;
+            options.min_sample_ns = 0;
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    BenchmarkManager::getInstance()->runAll(options);
+    return 0;
+}
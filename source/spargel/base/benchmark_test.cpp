@@ -0,0 +1,21 @@
+#include "spargel/base/benchmark.h"
+
+#include "spargel/base/check.h"
+#include "spargel/base/test.h"
+
+namespace spargel::base {
+    namespace {
+        TEST(Benchmark_StateIterations) {
+            for (u64 n : {1, 2, 1000}) {
+                BenchmarkState state(n);
+                u64 count = 0;
+                while (state.keepRunning()) {
+                    count++;
+                }
+                spargel_check(count == n);
+                // The loop has ended for good.
+                spargel_check(!state.keepRunning());
+            }
+        }
+    }  // namespace
+}  // namespace spargel::base
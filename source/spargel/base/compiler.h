@@ -22,3 +22,15 @@
 #else
 #define SPARGEL_ATTRIBUTE_PRINTF_FORMAT(format_arg, params_arg)
 #endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SPARGEL_HAS_SSE2 1
+#else
+#define SPARGEL_HAS_SSE2 0
+#endif
+
+#if defined(__ARM_NEON) || defined(_M_ARM64)
+#define SPARGEL_HAS_NEON 1
+#else
+#define SPARGEL_HAS_NEON 0
+#endif
@@ -0,0 +1,117 @@
+#include "spargel/base/benchmark.h"
+#include "spargel/base/hash_map.h"
+#include "spargel/base/string.h"
+#include "spargel/base/vector.h"
+
+// libc
+#include <stdio.h>
+
+namespace spargel::base {
+    namespace {
+        constexpr u32 item_count = 4096;
+
+        // Deterministic keys that do not arrive in order.
+        u32 scramble(u32 i) { return i * 2654435761u; }
+
+        BENCHMARK(Vector_Push) {
+            state.setItemsPerIteration(item_count);
+            while (state.keepRunning()) {
+                vector<u32> v;
+                for (u32 i = 0; i < item_count; i++) {
+                    v.push(i);
+                }
+                do_not_optimize(v.data());
+            }
+        }
+
+        BENCHMARK(Vector_PushReserved) {
+            state.setItemsPerIteration(item_count);
+            while (state.keepRunning()) {
+                vector<u32> v;
+                v.reserve(item_count);
+                for (u32 i = 0; i < item_count; i++) {
+                    v.push(i);
+                }
+                do_not_optimize(v.data());
+            }
+        }
+
+        BENCHMARK(Vector_Iterate) {
+            vector<u32> v;
+            for (u32 i = 0; i < item_count; i++) {
+                v.push(i);
+            }
+            state.setItemsPerIteration(item_count);
+            state.setBytesPerIteration(item_count * sizeof(u32));
+            while (state.keepRunning()) {
+                u32 sum = 0;
+                for (u32 x : v) {
+                    sum += x;
+                }
+                do_not_optimize(sum);
+            }
+        }
+
+        BENCHMARK(HashMap_Insert) {
+            state.setItemsPerIteration(item_count);
+            while (state.keepRunning()) {
+                HashMap<u32, u32> map;
+                for (u32 i = 0; i < item_count; i++) {
+                    map.set(scramble(i), i);
+                }
+                do_not_optimize(map.count());
+            }
+        }
+
+        BENCHMARK(HashMap_Find) {
+            HashMap<u32, u32> map;
+            for (u32 i = 0; i < item_count; i++) {
+                map.set(scramble(i), i);
+            }
+            state.setItemsPerIteration(item_count);
+            while (state.keepRunning()) {
+                u32 found = 0;
+                for (u32 i = 0; i < item_count; i++) {
+                    found += map.get(scramble(i)) != nullptr;
+                }
+                do_not_optimize(found);
+            }
+        }
+
+        BENCHMARK(HashMap_FindMissing) {
+            HashMap<u32, u32> map;
+            for (u32 i = 0; i < item_count; i++) {
+                map.set(scramble(i), i);
+            }
+            state.setItemsPerIteration(item_count);
+            while (state.keepRunning()) {
+                u32 found = 0;
+                for (u32 i = item_count; i < 2 * item_count; i++) {
+                    found += map.get(scramble(i)) != nullptr;
+                }
+                do_not_optimize(found);
+            }
+        }
+
+        BENCHMARK(HashMap_FindString) {
+            vector<String> keys;
+            for (u32 i = 0; i < item_count; i++) {
+                char buf[32];
+                snprintf(buf, sizeof(buf), "resource/key_%u", scramble(i));
+                keys.emplace(buf);
+            }
+            HashMap<String, u32> map;
+            for (u32 i = 0; i < item_count; i++) {
+                map.set(keys[i], i);
+            }
+            state.setItemsPerIteration(item_count);
+            while (state.keepRunning()) {
+                u32 found = 0;
+                for (u32 i = 0; i < item_count; i++) {
+                    found += map.get(keys[i]) != nullptr;
+                }
+                do_not_optimize(found);
+            }
+        }
+    }  // namespace
+}  // namespace spargel::base
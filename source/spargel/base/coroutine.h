@@ -1,5 +1,6 @@
 #pragma once
 
+#include "spargel/base/compiler.h"
 #include "spargel/base/types.h"
 
 namespace std {
@@ -22,6 +23,8 @@ namespace std {
 
         void operator()() const { __builtin_coro_resume(handle_); }
 
+        constexpr void* address() const noexcept { return handle_; }
+
         bool done() const noexcept { return __builtin_coro_done(handle_); }
         void resume() const { __builtin_coro_resume(handle_); }
         void destroy() const { __builtin_coro_destroy(handle_); }
@@ -54,6 +57,8 @@ namespace std {
 
         void operator()() const { resume(); }
 
+        constexpr void* address() const noexcept { return handle_; }
+
         bool done() const { return __builtin_coro_done(handle_); }
         void resume() const { __builtin_coro_resume(handle_); }
         void destroy() const { __builtin_coro_destroy(handle_); }
@@ -67,6 +72,25 @@ namespace std {
     private:
         void* handle_ = nullptr;
     };
+    namespace detail {
+        // The frame of a coroutine that does nothing when resumed. GCC and Clang both start a
+        // frame with the resume and destroy functions.
+        struct NoopFrame {
+            void (*resume)(void*);
+            void (*destroy)(void*);
+        };
+        inline void noop_resume(void*) {}
+        inline constinit NoopFrame noop_frame{noop_resume, noop_resume};
+    }  // namespace detail
+    // A coroutine handle that can always be resumed and never finishes, e.g. as the target of a
+    // symmetric transfer that should return to the resumer.
+    inline coroutine_handle<> noop_coroutine() noexcept {
+#if spargel_has_builtin(__builtin_coro_noop)
+        return coroutine_handle<>::from_address(__builtin_coro_noop());
+#else
+        return coroutine_handle<>::from_address(&detail::noop_frame);
+#endif
+    }
     struct suspend_never {
         constexpr bool await_ready() noexcept { return true; }
         constexpr void await_suspend(coroutine_handle<>) noexcept {}
@@ -84,4 +108,5 @@ namespace spargel::base {
     using CoroutineHandle = std::coroutine_handle<P>;
     using AlwaysSuspend = std::suspend_always;
     using NeverSuspend = std::suspend_never;
+    using std::noop_coroutine;
 }  // namespace spargel::base
@@ -1,11 +1,19 @@
 #pragma once
 
+#include "spargel/base/check.h"
+#include "spargel/base/concept.h"
+#include "spargel/base/meta.h"
+#include "spargel/base/string_view.h"
 #include "spargel/base/tag_invoke.h"
+#include "spargel/base/types.h"
 
 namespace spargel::base {
-    // TODO
+    // A format target accepts appended text, e.g. `StringBuilder`.
     template <typename T>
-    concept FormatTarget = true;
+    concept FormatTarget = requires(T& t, StringView s, char c) {
+        t.append(s);
+        t.append(c);
+    };
 
     namespace detail {
         // TODO: Type-safe `FormatString`.
@@ -29,23 +37,125 @@ namespace spargel::base {
                 return tag_invoke(ParseFormatCPO{}, base::forward<T>(t));
             }
         };
+
+        struct FormatValueCPO {
+            template <FormatTarget Target, typename T>
+            constexpr void operator()(Target& target, T const& value) const {
+                tag_invoke(FormatValueCPO{}, target, value);
+            }
+        };
+
+        template <typename T>
+        concept SignedInteger = SameAs<T, signed char> || SameAs<T, short> || SameAs<T, int> ||
+                                SameAs<T, long> || SameAs<T, long long>;
+
+        template <typename T>
+        concept UnsignedInteger = SameAs<T, unsigned char> || SameAs<T, unsigned short> ||
+                                  SameAs<T, unsigned int> || SameAs<T, unsigned long> ||
+                                  SameAs<T, unsigned long long>;
+
+        template <FormatTarget Target>
+        constexpr void formatUnsigned(Target& target, u64 n, bool minus) {
+            char buf[21];
+            char* p = buf + sizeof(buf);
+            do {
+                *--p = static_cast<char>('0' + n % 10);
+                n /= 10;
+            } while (n != 0);
+            if (minus) *--p = '-';
+            target.append(StringView(p, buf + sizeof(buf)));
+        }
+
+        template <FormatTarget Target>
+        constexpr void tag_invoke(FormatValueCPO, Target& target, StringView s) {
+            target.append(s);
+        }
+        template <FormatTarget Target>
+        constexpr void tag_invoke(FormatValueCPO, Target& target, char const* s) {
+            target.append(StringView(s));
+        }
+        template <FormatTarget Target>
+        constexpr void tag_invoke(FormatValueCPO, Target& target, char c) {
+            target.append(c);
+        }
+        template <FormatTarget Target>
+        constexpr void tag_invoke(FormatValueCPO, Target& target, bool b) {
+            target.append(b ? StringView("true", 4) : StringView("false", 5));
+        }
+        template <FormatTarget Target, SignedInteger T>
+        constexpr void tag_invoke(FormatValueCPO, Target& target, T n) {
+            // Negate in unsigned arithmetic so that the minimum value does not overflow.
+            u64 m = static_cast<u64>(n);
+            formatUnsigned(target, n < 0 ? ~m + 1 : m, n < 0);
+        }
+        template <FormatTarget Target, UnsignedInteger T>
+        constexpr void tag_invoke(FormatValueCPO, Target& target, T n) {
+            formatUnsigned(target, static_cast<u64>(n), false);
+        }
+        // Anything with a `view()`, e.g. `String`.
+        template <FormatTarget Target, typename T>
+            requires requires(T const& t) {
+                { t.view() } -> SameAs<StringView>;
+            }
+        constexpr void tag_invoke(FormatValueCPO, Target& target, T const& s) {
+            target.append(s.view());
+        }
     }  // namespace format_
 
     // `parseFormat` is a customization-point to handle the parsing of the format specification.
     // It should return a formatter object that will be invoked to perform the format.
     inline constexpr format_::ParseFormatCPO parseFormat;
 
+    // `formatValue` is a customization-point to append the text of a value to a format target.
+    inline constexpr format_::FormatValueCPO formatValue;
+
+    namespace detail {
+        // Append the literal text up to the next `{}`, unescaping `{{` and `}}`.
+        // Return the position after the placeholder, or `nullptr` if there is none.
+        template <FormatTarget Target>
+        constexpr char const* formatFragment(Target& target, char const* it, char const* end) {
+            auto fragment_begin = it;
+            while (it < end) {
+                auto c = *it;
+                if (c != '{' && c != '}') {
+                    it++;
+                    continue;
+                }
+                target.append(StringView(fragment_begin, it));
+                spargel_check(it + 1 < end);
+                if (it[1] == c) {
+                    target.append(c);
+                    it += 2;
+                    fragment_begin = it;
+                    continue;
+                }
+                // Format specifications are not supported yet.
+                spargel_check(c == '{' && it[1] == '}');
+                return it + 2;
+            }
+            target.append(StringView(fragment_begin, it));
+            return nullptr;
+        }
+    }  // namespace detail
+
+    // Append `fmt` to `target`, with each `{}` replaced by the next argument.
+    //
+    // Note:
+    //     - Use `{{` and `}}` for literal braces.
+    //     - The number of placeholders must match the number of arguments.
+    //
     template <FormatTarget Target, typename... Args>
     constexpr void formatTo(Target& target, detail::FormatString fmt, Args&&... args) {
         auto it = fmt.begin();
-        auto fragment_begin = it;
-        while (it < fmt.end()) {
-            auto c = *it;
-            if (c != '{') {
-                it++;
-                continue;
-            }
-        }
+        auto end = fmt.end();
+        (
+            [&](auto const& arg) {
+                it = detail::formatFragment(target, it, end);
+                spargel_check(it != nullptr);
+                formatValue(target, arg);
+            }(args),
+            ...);
+        spargel_check(detail::formatFragment(target, it, end) == nullptr);
     }
 
     namespace detail {
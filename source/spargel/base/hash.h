@@ -3,6 +3,7 @@
 #include "spargel/base/bit_cast.h"
 #include "spargel/base/compiler.h"
 #include "spargel/base/meta.h"
+#include "spargel/base/span.h"
 #include "spargel/base/tag_invoke.h"
 #include "spargel/base/types.h"
 
@@ -133,79 +134,126 @@ namespace spargel::base {
 
     }  // namespace __wyhash
 
+    // HashRun
+    //
+    // An incremental hasher.
+    //
+    // Fixed-width fields are packed into a 16-byte block, which is mixed into the state only
+    // when it is full, and the wyhash finalization runs once in `result()`. So hashing a small
+    // composite key costs about as much as hashing a single integer.
+    //
+    // Variable-length data is hashed with `wyhash` directly, which also mixes in the length, so
+    // adjacent ranges cannot alias.
+    //
+    // Note:
+    //     - Fields are packed by bytes, e.g. `combine(u8)` followed by `combine(u16)` may equal a
+    //       single `combine(u16)` and `combine(u8)`. This is fine since the fields of a given key
+    //       type always come in the same order.
+    //
     class HashRun {
     public:
-#if SPARGEL_IS_MSVC
-        constexpr void combine(u8 v) {
-            u8 b[1];
-            b[0] = v;
-            _hash = __wyhash::wyhash(b, 1, _hash);
-        }
-        constexpr void combine(u16 v) {
-            u8 b[2];
-            b[0] = v & 0xff;
-            b[1] = (v >> 8) & 0xff;
-            _hash = __wyhash::wyhash(b, 2, _hash);
-        }
-        constexpr void combine(u32 v) {
-            u8 b[4];
-            b[0] = v & 0xff;
-            b[1] = (v >> 8) & 0xff;
-            b[2] = (v >> 16) & 0xff;
-            b[3] = (v >> 24) & 0xff;
-            _hash = __wyhash::wyhash(b, 4, _hash);
-        }
-        constexpr void combine(u64 v) {
-            u8 b[8];
-            b[0] = v & 0xff;
-            b[1] = (v >> 8) & 0xff;
-            b[2] = (v >> 16) & 0xff;
-            b[3] = (v >> 24) & 0xff;
-            b[4] = (v >> 32) & 0xff;
-            b[5] = (v >> 40) & 0xff;
-            b[6] = (v >> 48) & 0xff;
-            b[7] = (v >> 56) & 0xff;
-            _hash = __wyhash::wyhash(b, 8, _hash);
-        }
-#else
-        void combine(u8 v) {
-            u8 b[1];
-            memcpy(b, &v, 1);
-            _hash = __wyhash::wyhash(b, 1, _hash);
-        }
-        void combine(u16 v) {
-            u8 b[2];
-            memcpy(b, &v, 2);
-            _hash = __wyhash::wyhash(b, 2, _hash);
-        }
-        void combine(u32 v) {
-            u8 b[4];
-            memcpy(b, &v, 4);
-            _hash = __wyhash::wyhash(b, 4, _hash);
-        }
-        void combine(u64 v) {
-            u8 b[8];
-            memcpy(b, &v, 8);
-            _hash = __wyhash::wyhash(b, 8, _hash);
+        constexpr HashRun() = default;
+        explicit constexpr HashRun(u64 seed) : _seed{seed} {}
+
+        constexpr void combine(u8 v) { absorb(v, 1); }
+        constexpr void combine(u16 v) { absorb(v, 2); }
+        constexpr void combine(u32 v) { absorb(v, 4); }
+        constexpr void combine(u64 v) { absorb(v, 8); }
+
+        void combine(u8 const* data, u64 len) {
+            if (_fill > 0) flush();
+            _seed = __wyhash::wyhash(data, len, _seed);
+            _len += len;
         }
-#endif
 
-        void combine(u8 const* data, u64 len) { _hash = __wyhash::wyhash(data, len, _hash); }
+        // Absorb the object representation of `v`. See `TriviallyHashable`.
+        template <typename T>
+        void combineBytes(T const& v) {
+            auto p = reinterpret_cast<u8 const*>(&v);
+            usize n = sizeof(T);
+            for (; n >= 8; p += 8, n -= 8) {
+                absorb(__wyhash::wyread8(p), 8);
+            }
+            if (n >= 4) {
+                absorb(__wyhash::wyread4(p), 4);
+                p += 4;
+                n -= 4;
+            }
+            for (; n > 0; p++, n--) {
+                absorb(*p, 1);
+            }
+        }
 
         template <typename T>
         void combine(T const& v);
 
-        u64 result() const { return _hash; }
+        constexpr u64 result() const {
+            u64 a = _lo ^ __wyhash::secret1;
+            u64 b = _hi ^ _seed;
+            __wyhash::wymul(a, b);
+            return __wyhash::wymix(a ^ __wyhash::secret0 ^ _len, b ^ __wyhash::secret1);
+        }
 
     private:
-        u64 _hash = __wyhash::default_seed;
+        // `v` holds `size` bytes, in little-endian order.
+        constexpr void absorb(u64 v, u32 size) {
+            if (_fill + size > 16) flush();
+            u32 bit = _fill * 8;
+            if (bit < 64) {
+                _lo |= v << bit;
+                if (bit + size * 8 > 64) _hi |= v >> (64 - bit);
+            } else {
+                _hi |= v << (bit - 64);
+            }
+            _fill += size;
+            _len += size;
+        }
+
+        constexpr void flush() {
+            _seed = __wyhash::wymix(_lo ^ __wyhash::secret1, _hi ^ _seed);
+            _lo = 0;
+            _hi = 0;
+            _fill = 0;
+        }
+
+        u64 _seed = __wyhash::default_seed;
+        // The pending block.
+        u64 _lo = 0;
+        u64 _hi = 0;
+        // Number of bytes in the pending block.
+        u32 _fill = 0;
+        // Total number of bytes absorbed.
+        u64 _len = 0;
     };
 
+    namespace __hash {
+        template <typename T>
+        concept OptInTrivialHash = requires {
+            requires T::trivially_hashable;
+        };
+    }  // namespace __hash
+
+    // A type is trivially hashable if equal values always have equal bytes, so that hashing
+    // the object representation is correct. This is the case for integers, enums and pointers.
+    // Classes without padding opt in with
+    //
+    //     static constexpr bool trivially_hashable = true;
+    //
+    // Trivially hashable types skip `tag_invoke` and are absorbed as raw bytes.
+    //
+    template <typename T>
+    concept TriviallyHashable = __has_unique_object_representations(T) && !__is_union(T) &&
+                                (!__is_class(T) || __hash::OptInTrivialHash<T>);
+
     namespace __hash {
         struct hash {
             template <typename T>
             void operator()(HashRun& run, T&& v) const {
-                tag_invoke(hash{}, run, forward<T>(v));
+                if constexpr (TriviallyHashable<RemoveCVRef<T>>) {
+                    run.combineBytes(v);
+                } else {
+                    tag_invoke(hash{}, run, forward<T>(v));
+                }
             }
             template <typename T>
             u64 operator()(T&& v) const {
@@ -214,14 +262,6 @@ namespace spargel::base {
                 return r.result();
             }
         };
-        inline void tag_invoke(hash, HashRun& r, u8 v) { r.combine(v); }
-        inline void tag_invoke(hash, HashRun& r, u16 v) { r.combine(v); }
-        inline void tag_invoke(hash, HashRun& r, u32 v) { r.combine(v); }
-        inline void tag_invoke(hash, HashRun& r, u64 v) { r.combine(v); }
-        inline void tag_invoke(hash, HashRun& r, i8 v) { r.combine(bitCast<i8, u8>(v)); }
-        inline void tag_invoke(hash, HashRun& r, i16 v) { r.combine(bitCast<i16, u16>(v)); }
-        inline void tag_invoke(hash, HashRun& r, i32 v) { r.combine(bitCast<i32, u32>(v)); }
-        inline void tag_invoke(hash, HashRun& r, i64 v) { r.combine(bitCast<i64, u64>(v)); }
     }  // namespace __hash
 
     inline constexpr __hash::hash hash{};
@@ -231,4 +271,32 @@ namespace spargel::base {
         hash(*this, v);
     }
 
+    // Hash `keys[i]` into `out[i]`, for table rebuilds and bulk inserts.
+    //
+    // Keys are hashed in independent lanes, so that the multiplications of several keys are in
+    // flight at the same time instead of forming one long dependency chain.
+    //
+    // Parameters:
+    //     - `out` must have room for `keys.count()` hashes.
+    //
+    template <typename T>
+    void hashMany(Span<T> keys, u64* out) {
+        constexpr usize lanes = 4;
+        usize n = keys.count();
+        T const* k = keys.data();
+        usize i = 0;
+        for (; i + lanes <= n; i += lanes) {
+            HashRun r[lanes];
+            for (usize j = 0; j < lanes; j++) {
+                hash(r[j], k[i + j]);
+            }
+            for (usize j = 0; j < lanes; j++) {
+                out[i + j] = r[j].result();
+            }
+        }
+        for (; i < n; i++) {
+            out[i] = hash(k[i]);
+        }
+    }
+
 }  // namespace spargel::base
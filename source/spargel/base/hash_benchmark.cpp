@@ -0,0 +1,53 @@
+#include "spargel/base/benchmark.h"
+#include "spargel/base/hash.h"
+#include "spargel/base/span.h"
+#include "spargel/base/vector.h"
+
+namespace spargel::base {
+    namespace {
+        constexpr u32 key_count = 4096;
+
+        BENCHMARK(Hash_U64) {
+            state.setItemsPerIteration(key_count);
+            while (state.keepRunning()) {
+                u64 acc = 0;
+                for (u64 i = 0; i < key_count; i++) {
+                    acc ^= hash(i);
+                }
+                do_not_optimize(acc);
+            }
+        }
+
+        BENCHMARK(Hash_ManyU64) {
+            vector<u64> keys;
+            for (u64 i = 0; i < key_count; i++) {
+                keys.push(i);
+            }
+            vector<u64> out;
+            out.resize(key_count);
+            state.setItemsPerIteration(key_count);
+            while (state.keepRunning()) {
+                hashMany(Span<u64>(keys.begin(), keys.end()), out.data());
+                clobber_memory();
+            }
+        }
+
+        template <usize size>
+        void hash_bytes(BenchmarkState& state) {
+            vector<u8> data;
+            for (usize i = 0; i < size; i++) {
+                data.push(static_cast<u8>(i * 31));
+            }
+            state.setBytesPerIteration(size);
+            while (state.keepRunning()) {
+                HashRun run;
+                run.combine(data.data(), size);
+                do_not_optimize(run.result());
+            }
+        }
+
+        BENCHMARK(Hash_Bytes16) { hash_bytes<16>(state); }
+        BENCHMARK(Hash_Bytes256) { hash_bytes<256>(state); }
+        BENCHMARK(Hash_Bytes64K) { hash_bytes<65536>(state); }
+    }  // namespace
+}  // namespace spargel::base
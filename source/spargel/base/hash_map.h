@@ -3,48 +3,211 @@
 #include "spargel/base/algorithm.h"
 #include "spargel/base/array_storage.h"
 #include "spargel/base/assert.h"
+#include "spargel/base/compiler.h"
 #include "spargel/base/hash.h"
+#include "spargel/base/intrinsic.h"
 #include "spargel/base/meta.h"
+#include "spargel/base/object.h"
 #include "spargel/base/tag_invoke.h"
-#include "spargel/base/vector.h"
+#include "spargel/base/types.h"
+
+// libc
+#include <string.h>
+
+#if SPARGEL_HAS_SSE2
+#include <emmintrin.h>
+#elif SPARGEL_HAS_NEON
+#include <arm_neon.h>
+#endif
 
 namespace spargel::base {
 
     namespace _hash_map {
 
+        // Control bytes
+        //
+        // Each slot has one byte of metadata:
+        //
+        //     empty:   1000 0000
+        //     deleted: 1111 1110
+        //     full:    0hhh hhhh   (the low 7 bits of the hash, i.e. `h2`)
+        //
+        // The first `Group::width - 1` control bytes are mirrored after the last one, so that a
+        // group can be loaded from any slot without wrapping around.
+        //
+        using ctrl_t = i8;
+
+        inline constexpr ctrl_t ctrl_empty = -128;
+        inline constexpr ctrl_t ctrl_deleted = -2;
+        // Not stored. Everything below it is either empty or deleted.
+        inline constexpr ctrl_t ctrl_sentinel = -1;
+
+        inline constexpr bool isFull(ctrl_t c) { return c >= 0; }
+
+        // The position of the probe sequence.
+        inline constexpr usize h1(u64 h) { return static_cast<usize>(h >> 7); }
+        // The value stored in the control byte.
+        inline constexpr ctrl_t h2(u64 h) { return static_cast<ctrl_t>(h & 0x7f); }
+
+        // A set of slots in a group.
+        //
+        // Each slot occupies `1 << shift` bits of `W`, and only the highest of them is used.
+        //
+        template <typename W, usize width, usize shift>
+        class BitMask {
+        public:
+            explicit BitMask(W value) : _value{value} {}
+
+            explicit operator bool() const { return _value != 0; }
+
+            // Index of the first slot in the set. The set must be non-empty.
+            u32 lowest() const { return CountTrailingZeros(_value) >> shift; }
+            void removeLowest() { _value &= _value - 1; }
+
+            // Number of slots before the first one in the set.
+            u32 countBeforeFirst() const {
+                return _value == 0 ? width : CountTrailingZeros(_value) >> shift;
+            }
+            // Number of slots after the last one in the set.
+            u32 countAfterLast() const {
+                constexpr u32 unused_bits = 64 - (width << shift);
+                return _value == 0 ? width : (CountLeadingZeros(_value) - unused_bits) >> shift;
+            }
+
+        private:
+            W _value;
+        };
+
+#if SPARGEL_HAS_SSE2
+
+        struct Group {
+            static constexpr usize width = 16;
+            using Mask = BitMask<u32, width, 0>;
+
+            explicit Group(ctrl_t const* p)
+                : ctrl{_mm_loadu_si128(reinterpret_cast<__m128i const*>(p))} {}
+
+            Mask match(ctrl_t h) const {
+                return Mask(toMask(_mm_cmpeq_epi8(_mm_set1_epi8(h), ctrl)));
+            }
+            Mask matchEmpty() const {
+                return Mask(toMask(_mm_cmpeq_epi8(_mm_set1_epi8(ctrl_empty), ctrl)));
+            }
+            Mask matchEmptyOrDeleted() const {
+                return Mask(toMask(_mm_cmpgt_epi8(_mm_set1_epi8(ctrl_sentinel), ctrl)));
+            }
+
+            static u32 toMask(__m128i v) { return static_cast<u32>(_mm_movemask_epi8(v)); }
+
+            __m128i ctrl;
+        };
+
+#elif SPARGEL_HAS_NEON
+
+        struct Group {
+            static constexpr usize width = 8;
+            using Mask = BitMask<u64, width, 3>;
+
+            static constexpr u64 msbs = 0x8080808080808080;
+
+            explicit Group(ctrl_t const* p) : ctrl{vld1_s8(p)} {}
+
+            Mask match(ctrl_t h) const { return Mask(toMask(vceq_s8(vdup_n_s8(h), ctrl))); }
+            Mask matchEmpty() const {
+                return Mask(toMask(vceq_s8(vdup_n_s8(ctrl_empty), ctrl)));
+            }
+            Mask matchEmptyOrDeleted() const {
+                return Mask(toMask(vcgt_s8(vdup_n_s8(ctrl_sentinel), ctrl)));
+            }
+
+            static u64 toMask(uint8x8_t v) {
+                return vget_lane_u64(vreinterpret_u64_u8(v), 0) & msbs;
+            }
+
+            int8x8_t ctrl;
+        };
+
+#else
+
+        // Portable fallback: eight control bytes in a word.
+        //
+        // `match` may report false positives for bytes following a real match, which is fine
+        // since keys are always compared afterwards.
+        //
+        struct Group {
+            static constexpr usize width = 8;
+            using Mask = BitMask<u64, width, 3>;
+
+            static constexpr u64 lsbs = 0x0101010101010101;
+            static constexpr u64 msbs = 0x8080808080808080;
+
+            explicit Group(ctrl_t const* p) {
+                // todo: assumes little-endian
+                memcpy(&ctrl, p, sizeof(ctrl));
+            }
+
+            Mask match(ctrl_t h) const {
+                u64 x = ctrl ^ (lsbs * static_cast<u8>(h));
+                return Mask((x - lsbs) & ~x & msbs);
+            }
+            // Only `empty` has the highest bit set and the second lowest bit cleared.
+            Mask matchEmpty() const { return Mask((ctrl & ~(ctrl << 6)) & msbs); }
+            // Only `empty` and `deleted` have the highest bit set and the lowest bit cleared.
+            Mask matchEmptyOrDeleted() const { return Mask((ctrl & ~(ctrl << 7)) & msbs); }
+
+            u64 ctrl;
+        };
+
+#endif
+
         // HashMap
         //
-        // `K` is the type of keys, which should be trivially copyable.
+        // An open-addressing hash table in the style of Swiss tables.
+        //
+        // The slots are divided into groups of `Group::width` consecutive slots, which are
+        // probed all at once with SIMD instructions on the control bytes. The capacity is a
+        // power of two, and the groups are visited in triangular order, which covers the whole
+        // table. Erased slots become tombstones unless no probe sequence can pass through them.
+        // The maximal load factor is 7/8.
+        //
+        // Heterogeneous lookup: any `U` can be used to look up a key of type `K` as long as
+        // `hash(u) == hash(k)` whenever `k == u`, e.g. `StringView` for `String`.
+        //
+        // All storage comes from a single allocator, which follows the same rules as `vector`.
+        //
+        // Note:
+        //     - Pointers to values are invalidated by insertion, but not by erasure.
         //
         template <typename K, typename T>
         class HashMap {
         public:
-            HashMap() = default;
+            HashMap() : HashMap(tagged_allocator(AllocationTag::hash_map)) {}
+
+            explicit HashMap(Allocator* alloc) : _ctrl(0, alloc), _slots(0, alloc) {}
 
-            HashMap(HashMap const& other)
+            HashMap(HashMap const& other) : HashMap(other, other.getAllocator()) {}
+            HashMap(HashMap const& other, Allocator* alloc)
                 : _capacity{other._capacity},
                   _count{other._count},
-                  _status(other._status),
-                  _keys(other._capacity),
-                  _values(other._capacity) {
-                spargel_assert(_capacity == _status.count());
-
+                  _growth_left{other._growth_left},
+                  _ctrl(other._ctrl.getCount(), alloc),
+                  _slots(other._capacity, alloc) {
+                if (_capacity == 0) return;
+                memcpy(_ctrl.begin(), other._ctrl.begin(), _ctrl.getCount());
                 for (usize i = 0; i < _capacity; i++) {
-                    if (_status[i] == SlotStatus::used) {
-                        construct_at(_keys.getPtr(i), other._keys[i]);
-                        construct_at(_values.getPtr(i), other._values[i]);
+                    if (isFull(_ctrl[i])) {
+                        construct_at(&_slots.getPtr(i)->key, other._slots[i].key);
+                        construct_at(&_slots.getPtr(i)->value, other._slots[i].value);
                     }
                 }
             }
             HashMap& operator=(HashMap const& other) {
-                HashMap tmp(other);
+                HashMap tmp(other, getAllocator());
                 swap(*this, tmp);
                 return *this;
             }
 
-            // FIXME:
-            // ArrayStorage does not hava a default constructor
-            HashMap(HashMap&& other) { swap(*this, other); }
+            HashMap(HashMap&& other) : HashMap(other.getAllocator()) { swap(*this, other); }
             HashMap& operator=(HashMap&& other) {
                 HashMap tmp(base::move(other));
                 swap(*this, tmp);
@@ -53,159 +216,246 @@ namespace spargel::base {
 
             ~HashMap() { destructItems(); }
 
-            T* get(K const& key) {
-                auto result = findSlot(key);
-                if (result.has_key) {
-                    return &_values[result.index];
-                }
-                return nullptr;
+            template <typename U>
+            T* get(U const& key) {
+                usize i = find(key, hash(key));
+                return i == npos ? nullptr : &_slots[i].value;
             }
-
             template <typename U>
             T const* get(U const& key) const {
-                auto result = findSlot(key);
-                if (result.has_key) {
-                    return &_values[result.index];
-                }
-                return nullptr;
+                usize i = find(key, hash(key));
+                return i == npos ? nullptr : &_slots[i].value;
             }
 
-            template <typename U, typename... Args>
-            void set(U const& key, Args&&... args) {
-                ensureSpace();
+            template <typename U>
+            bool contains(U const& key) const {
+                return find(key, hash(key)) != npos;
+            }
 
-                FindResult r = findSlot(key);
-                if (r.has_key) {
-                    destruct_at(_values.getPtr(r.index));
-                    construct_at(_values.getPtr(r.index), forward<Args>(args)...);
+            // Insert or overwrite.
+            template <typename U, typename... Args>
+            void set(U&& key, Args&&... args) {
+                bool inserted;
+                usize i = findOrPrepareInsert(key, inserted);
+                if (inserted) {
+                    construct_at(&_slots.getPtr(i)->key, forward<U>(key));
                 } else {
-                    _status[r.index] = SlotStatus::used;
-                    construct_at(_keys.getPtr(r.index), key);
-                    construct_at(_values.getPtr(r.index), forward<Args>(args)...);
+                    destruct_at(&_slots.getPtr(i)->value);
                 }
+                construct_at(&_slots.getPtr(i)->value, forward<Args>(args)...);
+            }
 
-                _count++;
+            // Construct the value from `args` only if the key is absent.
+            template <typename U, typename... Args>
+            T& getOrConstruct(U&& key, Args&&... args) {
+                bool inserted;
+                usize i = findOrPrepareInsert(key, inserted);
+                if (inserted) {
+                    construct_at(&_slots.getPtr(i)->key, forward<U>(key));
+                    construct_at(&_slots.getPtr(i)->value, forward<Args>(args)...);
+                }
+                return _slots.getPtr(i)->value;
             }
 
-            template <typename... Args>
-            T& getOrConstruct(K const& key, Args&&... args) {
-                FindResult result = findSlot(key);
-                if (!result.has_key) {
-                    _status[result.index] = SlotStatus::used;
-                    construct_at(_keys.getPtr(result.index), key);
-                    construct_at(_values.getPtr(result.index), forward<Args>(args)...);
+            // Returns whether the key was present.
+            template <typename U>
+            bool erase(U const& key) {
+                usize i = find(key, hash(key));
+                if (i == npos) return false;
+                eraseAt(i);
+                return true;
+            }
+
+            // Remove all entries, keeping the capacity.
+            void clear() {
+                destructItems();
+                resetCtrl();
+                _count = 0;
+                _growth_left = growthFor(_capacity);
+            }
+
+            // Ensure that `n` entries fit without rehashing.
+            void reserve(usize n) {
+                if (n <= _count + _growth_left) return;
+                usize cap = min_capacity;
+                while (growthFor(cap) < n) {
+                    cap *= 2;
                 }
-                return *_values.getPtr(result.index);
+                resize(cap);
             }
 
             usize count() const { return _count; }
+            usize capacity() const { return _capacity; }
+
+            Allocator* getAllocator() const { return _slots.getAllocator(); }
 
             friend void tag_invoke(tag<swap>, HashMap& lhs, HashMap& rhs) {
                 base::swap(lhs._capacity, rhs._capacity);
                 base::swap(lhs._count, rhs._count);
-                base::swap(lhs._status, rhs._status);
-                base::swap(lhs._keys, rhs._keys);
-                base::swap(lhs._values, rhs._values);
+                base::swap(lhs._growth_left, rhs._growth_left);
+                base::swap(lhs._ctrl, rhs._ctrl);
+                base::swap(lhs._slots, rhs._slots);
             }
 
         private:
-            enum class SlotStatus {
-                free,
-                used,
+            struct Slot {
+                K key;
+                T value;
             };
 
-            struct FindResult {
-                bool has_key;
-                usize index;
-            };
+            static constexpr usize npos = ~usize{0};
+            static constexpr usize min_capacity = Group::width;
 
-            void grow() {
-                usize new_cap = nextCapacity();
+            static constexpr usize growthFor(usize cap) { return cap - cap / 8; }
 
-                base::vector<SlotStatus> new_status;
-                base::ArrayStorage<K> new_keys{new_cap};
-                base::ArrayStorage<T> new_values{new_cap};
-                new_status.reserve(new_cap);
-                new_status.set_count(new_cap);
-                for (usize i = 0; i < new_cap; i++) {
-                    new_status[i] = SlotStatus::free;
+            template <typename U>
+            usize find(U const& key, u64 h) const {
+                if (_capacity == 0) return npos;
+                usize mask = _capacity - 1;
+                usize offset = h1(h) & mask;
+                usize step = 0;
+                while (true) {
+                    Group g(_ctrl.begin() + offset);
+                    auto m = g.match(h2(h));
+                    while (m) {
+                        usize i = (offset + m.lowest()) & mask;
+                        if (_slots[i].key == key) [[likely]] {
+                            return i;
+                        }
+                        m.removeLowest();
+                    }
+                    if (g.matchEmpty()) return npos;
+                    step += Group::width;
+                    offset = (offset + step) & mask;
+                    spargel_assert(step <= _capacity);
                 }
+            }
 
-                for (usize i = 0; i < _capacity; i++) {
-                    if (_status[i] == SlotStatus::used) {
-                        usize new_i = findFreeSlot(_keys[i], new_cap, new_status);
-
-                        new_status[new_i] = SlotStatus::used;
-                        construct_at<K>(new_keys.getPtr(new_i), base::move(_keys[i]));
-                        construct_at<T>(new_values.getPtr(new_i), base::move(_values[i]));
-                    }
+            // The first empty or deleted slot in the probe sequence.
+            usize findFirstNonFull(u64 h) const {
+                usize mask = _capacity - 1;
+                usize offset = h1(h) & mask;
+                usize step = 0;
+                while (true) {
+                    auto m = Group(_ctrl.begin() + offset).matchEmptyOrDeleted();
+                    if (m) return (offset + m.lowest()) & mask;
+                    step += Group::width;
+                    offset = (offset + step) & mask;
+                    spargel_assert(step <= _capacity);
                 }
+            }
 
-                destructItems();
+            // Find the key, or claim a slot for it. The caller constructs the slot.
+            template <typename U>
+            usize findOrPrepareInsert(U const& key, bool& inserted) {
+                u64 h = hash(key);
+                usize i = find(key, h);
+                if (i != npos) {
+                    inserted = false;
+                    return i;
+                }
+                if (_capacity == 0) {
+                    resize(min_capacity);
+                }
+                i = findFirstNonFull(h);
+                // Reusing a tombstone does not consume growth.
+                if (_growth_left == 0 && _ctrl[i] == ctrl_empty) {
+                    rehashForInsert();
+                    i = findFirstNonFull(h);
+                }
+                if (_ctrl[i] == ctrl_empty) {
+                    _growth_left--;
+                }
+                setCtrl(i, h2(h));
+                _count++;
+                inserted = true;
+                return i;
+            }
 
-                _capacity = new_cap;
-                swap(_status, new_status);
-                swap(_keys, new_keys);
-                swap(_values, new_values);
+            // Out of growth: purge tombstones if they take up much of the table, otherwise grow.
+            void rehashForInsert() {
+                if (_count <= growthFor(_capacity) / 2) {
+                    resize(_capacity);
+                } else {
+                    resize(_capacity * 2);
+                }
             }
 
-            usize findFreeSlot(K const& key, usize cap, vector<SlotStatus> const& status) {
-                spargel_assert(cap > 0);
+            void eraseAt(usize i) {
+                destruct_at(&_slots.getPtr(i)->key);
+                destruct_at(&_slots.getPtr(i)->value);
+                _count--;
+
+                // If there are fewer than `width` consecutive full/deleted slots around `i`, no
+                // group was ever full there, so no probe sequence continued past this slot.
+                usize before = (i - Group::width) & (_capacity - 1);
+                auto empty_after = Group(_ctrl.begin() + i).matchEmpty();
+                auto empty_before = Group(_ctrl.begin() + before).matchEmpty();
+                bool was_never_full = empty_before && empty_after &&
+                                      (empty_after.countBeforeFirst() + empty_before.countAfterLast()) <
+                                          Group::width;
+                if (was_never_full) {
+                    setCtrl(i, ctrl_empty);
+                    _growth_left++;
+                } else {
+                    setCtrl(i, ctrl_deleted);
+                }
+            }
 
-                u64 h = hash(key);
-                usize i = h % cap;
-                while (true) {
-                    if (status[i] == SlotStatus::free) {
-                        return i;
-                    }
-                    i = (i + 1) % cap;
+            void setCtrl(usize i, ctrl_t c) {
+                _ctrl[i] = c;
+                if (i < Group::width - 1) {
+                    _ctrl[_capacity + i] = c;
                 }
             }
 
-            template <typename U>
-            FindResult findSlot(U const& key) const {
-                if (_capacity == 0) {
-                    return FindResult(false, 0);
+            void resetCtrl() {
+                if (_capacity > 0) {
+                    memset(_ctrl.begin(), static_cast<u8>(ctrl_empty), _ctrl.getCount());
                 }
+            }
 
-                u64 h = hash(key);
-                usize i = h % _capacity;
-                while (true) {
-                    if ((_status[i] == SlotStatus::used) && (_keys[i] == key)) {
-                        return FindResult(true, i);
-                    } else if (_status[i] == SlotStatus::free) {
-                        return FindResult(false, i);
-                    }
-                    i = (i + 1) % _capacity;
+            void resize(usize new_cap) {
+                spargel_assert(new_cap >= min_capacity && (new_cap & (new_cap - 1)) == 0);
+
+                Allocator* alloc = getAllocator();
+                HashMap tmp(alloc);
+                tmp._capacity = new_cap;
+                tmp._ctrl = ArrayStorage<ctrl_t>(new_cap + Group::width - 1, alloc);
+                tmp._slots = ArrayStorage<Slot>(new_cap, alloc);
+                tmp.resetCtrl();
+
+                for (usize i = 0; i < _capacity; i++) {
+                    if (!isFull(_ctrl[i])) continue;
+                    Slot* slot = _slots.getPtr(i);
+                    u64 h = hash(slot->key);
+                    usize j = tmp.findFirstNonFull(h);
+                    tmp.setCtrl(j, h2(h));
+                    construct_at(&tmp._slots.getPtr(j)->key, base::move(slot->key));
+                    construct_at(&tmp._slots.getPtr(j)->value, base::move(slot->value));
                 }
+                tmp._count = _count;
+                tmp._growth_left = growthFor(new_cap) - _count;
+
+                swap(*this, tmp);
             }
 
             void destructItems() {
-                auto p1 = _status.begin();
-                auto p2 = _keys.begin();
-                auto p3 = _values.begin();
-                while (p1 < _status.end()) {
-                    if (*p1 == SlotStatus::used) {
-                        destruct_at(p2);
-                        destruct_at(p3);
+                for (usize i = 0; i < _capacity; i++) {
+                    if (isFull(_ctrl[i])) {
+                        destruct_at(&_slots.getPtr(i)->key);
+                        destruct_at(&_slots.getPtr(i)->value);
                     }
-                    p1++;
-                    p2++;
-                    p3++;
                 }
             }
 
-            bool needToGrow() const { return (_capacity * 3 / 4) <= _count; }
-            usize nextCapacity() const { return _capacity == 0 ? 8 : _capacity * 2; }
-            void ensureSpace() {
-                if (needToGrow()) grow();
-            }
-
             usize _capacity = 0;
             usize _count = 0;
-            base::vector<SlotStatus> _status;
-            base::ArrayStorage<K> _keys;
-            base::ArrayStorage<T> _values;
+            // Number of empty slots that can be filled before rehashing.
+            usize _growth_left = 0;
+            // `_capacity + Group::width - 1` bytes.
+            base::ArrayStorage<ctrl_t> _ctrl;
+            base::ArrayStorage<Slot> _slots;
         };
 
     }  // namespace _hash_map
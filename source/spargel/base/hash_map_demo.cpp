@@ -0,0 +1,101 @@
+#include "spargel/base/hash.h"
+#include "spargel/base/hash_map.h"
+#include "spargel/base/types.h"
+
+//
+#include <stdio.h>
+#include <time.h>
+
+namespace spargel::base {
+    namespace {
+        // Shaped like the glyph cache key in `render::UIRenderer`.
+        struct GlyphKey {
+            u32 id;
+            u64 font;
+            u8 subpixel;
+
+            friend bool operator==(GlyphKey const& lhs, GlyphKey const& rhs) {
+                return lhs.id == rhs.id && lhs.font == rhs.font && lhs.subpixel == rhs.subpixel;
+            }
+            friend void tag_invoke(tag<hash>, HashRun& run, GlyphKey const& self) {
+                run.combine(self.id);
+                run.combine(self.font);
+                run.combine(self.subpixel);
+            }
+        };
+
+        constexpr u32 key_count = 1 << 16;
+        constexpr u32 rounds = 20;
+
+        GlyphKey makeKey(u32 i) { return GlyphKey{i * 7919, 0x1000 + (i % 3) * 64, (u8)(i % 4)}; }
+
+        u64 nowNanos() {
+            timespec ts;
+            timespec_get(&ts, TIME_UTC);
+            return static_cast<u64>(ts.tv_sec) * 1000000000 + static_cast<u64>(ts.tv_nsec);
+        }
+
+        void report(char const* name, u64 elapsed, u64 ops) {
+            printf("%-8s %10.3f ms %8.2f ns/op\n", name, (double)elapsed / 1e6,
+                   (double)elapsed / (double)ops);
+        }
+
+        // Keep the results from being optimized out.
+        volatile u64 sink;
+
+        void runInsert() {
+            u64 start = nowNanos();
+            for (u32 r = 0; r < rounds; r++) {
+                HashMap<GlyphKey, u32> map;
+                for (u32 i = 0; i < key_count; i++) {
+                    map.set(makeKey(i), i);
+                }
+                sink = map.count();
+            }
+            report("insert", nowNanos() - start, (u64)rounds * key_count);
+        }
+
+        void runLookup(bool hit) {
+            HashMap<GlyphKey, u32> map;
+            for (u32 i = 0; i < key_count; i++) {
+                map.set(makeKey(i), i);
+            }
+            u64 sum = 0;
+            u32 base = hit ? 0 : key_count;
+            u64 start = nowNanos();
+            for (u32 r = 0; r < rounds; r++) {
+                for (u32 i = 0; i < key_count; i++) {
+                    auto p = map.get(makeKey(base + i));
+                    sum += p == nullptr ? 1 : *p;
+                }
+            }
+            report(hit ? "hit" : "miss", nowNanos() - start, (u64)rounds * key_count);
+            sink = sum;
+        }
+
+        void runChurn() {
+            HashMap<GlyphKey, u32> map;
+            u64 start = nowNanos();
+            for (u32 r = 0; r < rounds; r++) {
+                for (u32 i = 0; i < key_count; i++) {
+                    map.set(makeKey(r * key_count + i), i);
+                    if (i >= 1024) map.erase(makeKey(r * key_count + i - 1024));
+                }
+                for (u32 i = key_count - 1024; i < key_count; i++) {
+                    map.erase(makeKey(r * key_count + i));
+                }
+            }
+            report("churn", nowNanos() - start, (u64)rounds * key_count * 2);
+            sink = map.count();
+        }
+    }  // namespace
+}  // namespace spargel::base
+
+int main() {
+    using namespace spargel::base;
+    runInsert();
+    runLookup(true);
+    runLookup(false);
+    runChurn();
+    return 0;
+}
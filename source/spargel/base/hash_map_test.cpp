@@ -1,6 +1,7 @@
 #include "spargel/base/hash_map.h"
 
 #include "spargel/base/allocator.h"
+#include "spargel/base/arena_allocator.h"
 #include "spargel/base/check.h"
 #include "spargel/base/string.h"
 #include "spargel/base/test.h"
@@ -88,3 +89,128 @@ TEST(HashMap_General) {
     spargel_check(y.count() == 1);
     spargel_check(*y.get(string("name")) == string("Alice"));
 }
+
+TEST(HashMap_Allocator) {
+    ArenaAllocator arena;
+    {
+        HashMap<int, int> x(&arena);
+        for (int i = 0; i < 100; i++) {
+            x.set(i, i);
+        }
+        spargel_check(x.getAllocator() == &arena);
+        spargel_check(arena.bytesUsed() > 0);
+
+        auto y(x);
+        spargel_check(y.getAllocator() == &arena);
+        spargel_check(*y.get(42) == 42);
+
+        HashMap<int, int> z;
+        z = x;
+        spargel_check(z.getAllocator() == tagged_allocator(AllocationTag::hash_map));
+        spargel_check(*z.get(42) == 42);
+
+        auto w(move(x));
+        spargel_check(w.getAllocator() == &arena);
+        spargel_check(*w.get(42) == 42);
+    }
+}
+
+TEST(HashMap_Overwrite) {
+    HashMap<int, int> x;
+    x.set(1, 2);
+    x.set(1, 3);
+    spargel_check(x.count() == 1);
+    spargel_check(*x.get(1) == 3);
+
+    spargel_check(x.getOrConstruct(1, 4) == 3);
+    spargel_check(x.getOrConstruct(2, 4) == 4);
+    spargel_check(x.count() == 2);
+}
+
+TEST(HashMap_Erase) {
+    HashMap<int, string> x;
+    for (int i = 0; i < 1000; i++) {
+        x.set(i, string("v"));
+    }
+    spargel_check(x.count() == 1000);
+    for (int i = 0; i < 1000; i += 2) {
+        spargel_check(x.erase(i));
+    }
+    spargel_check(!x.erase(0));
+    spargel_check(x.count() == 500);
+    for (int i = 0; i < 1000; i++) {
+        spargel_check(x.contains(i) == (i % 2 == 1));
+    }
+
+    // Churn must not grow the table forever.
+    usize cap = x.capacity();
+    for (int round = 0; round < 100; round++) {
+        for (int i = 0; i < 100; i++) {
+            x.set(10000 + i, string("w"));
+        }
+        for (int i = 0; i < 100; i++) {
+            x.erase(10000 + i);
+        }
+    }
+    spargel_check(x.count() == 500);
+    spargel_check(x.capacity() == cap);
+
+    x.clear();
+    spargel_check(x.count() == 0);
+    spargel_check(x.get(1) == nullptr);
+}
+
+TEST(HashMap_Reserve) {
+    HashMap<int, int> x;
+    x.reserve(1000);
+    usize cap = x.capacity();
+    spargel_check(cap >= 1000);
+    for (int i = 0; i < 1000; i++) {
+        x.set(i, i);
+    }
+    spargel_check(x.capacity() == cap);
+}
+
+TEST(HashMap_Heterogeneous) {
+    using namespace literals;
+
+    HashMap<string, int> x;
+    x.set("apple"_sv, 1);
+    x.set(string("banana"), 2);
+    spargel_check(*x.get("apple"_sv) == 1);
+    spargel_check(*x.get("banana"_sv) == 2);
+    spargel_check(x.get("cherry"_sv) == nullptr);
+    spargel_check(x.erase("apple"_sv));
+    spargel_check(!x.contains(string("apple")));
+}
+
+TEST(HashMap_Random) {
+    // Compare against a brute-force reference.
+    constexpr int range = 512;
+    int reference[range];
+    bool present[range] = {};
+    HashMap<u32, int> x;
+    u32 state = 12345;
+    for (int step = 0; step < 20000; step++) {
+        state = state * 1664525 + 1013904223;
+        u32 key = (state >> 8) % range;
+        int op = (state >> 4) % 3;
+        if (op == 0) {
+            x.set(key, step);
+            reference[key] = step;
+            present[key] = true;
+        } else if (op == 1) {
+            spargel_check(x.erase(key) == present[key]);
+            present[key] = false;
+        } else {
+            auto p = x.get(key);
+            spargel_check((p != nullptr) == present[key]);
+            if (p != nullptr) spargel_check(*p == reference[key]);
+        }
+    }
+    usize n = 0;
+    for (int i = 0; i < range; i++) {
+        if (present[i]) n++;
+    }
+    spargel_check(x.count() == n);
+}
@@ -18,6 +18,25 @@ namespace spargel::base {
             run.combine(f.y);
             run.combine(f.s);
         }
+        struct Point {
+            i32 x;
+            i32 y;
+            static constexpr bool trivially_hashable = true;
+        };
+        struct Padded {
+            u8 a;
+            u32 b;
+        };
+        void tag_invoke(tag<hash>, HashRun& run, Padded const& p) {
+            run.combine(p.a);
+            run.combine(p.b);
+        }
+
+        static_assert(TriviallyHashable<u32>);
+        static_assert(TriviallyHashable<Point>);
+        static_assert(!TriviallyHashable<Padded>);
+        static_assert(!TriviallyHashable<f32>);
+
         TEST(HashIsPure) {
             spargel_check(hash(1) == hash(1));
             // TODO: hash float/double.
@@ -33,5 +52,42 @@ namespace spargel::base {
             spargel_check(hash(string("hello")) != hash(string("bonjour")));
             spargel_check(hash(Foo(1, 2, string("xyz"))) != hash(Foo(3, 5, string("def"))));
         }
+        TEST(Hash_Incremental) {
+            // Fields are packed, so the same bytes give the same hash.
+            HashRun r1;
+            r1.combine(u32{1});
+            r1.combine(u32{2});
+            HashRun r2;
+            r2.combine(u64{1} | (u64{2} << 32));
+            spargel_check(r1.result() == r2.result());
+
+            // Blocks longer than 16 bytes.
+            HashRun r3;
+            HashRun r4;
+            for (u64 i = 0; i < 10; i++) {
+                r3.combine(i);
+                r4.combine(i + (i == 9 ? 1 : 0));
+            }
+            spargel_check(r3.result() != r4.result());
+
+            // Trivially hashable types are hashed by their bytes.
+            spargel_check(hash(Point(1, 2)) == hash(u64{1} | (u64{2} << 32)));
+            spargel_check(hash(Point(1, 2)) != hash(Point(2, 1)));
+
+            spargel_check(hash(Padded(1, 2)) == hash(Padded(1, 2)));
+            spargel_check(hash(Padded(1, 2)) != hash(Padded(2, 1)));
+        }
+
+        TEST(Hash_Many) {
+            u32 keys[11];
+            for (u32 i = 0; i < 11; i++) {
+                keys[i] = i * 17;
+            }
+            u64 out[11];
+            hashMany(make_span(keys), out);
+            for (u32 i = 0; i < 11; i++) {
+                spargel_check(out[i] == hash(keys[i]));
+            }
+        }
     }  // namespace
 }  // namespace spargel::base
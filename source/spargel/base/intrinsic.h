@@ -5,6 +5,10 @@
 #include "spargel/base/panic.h"
 #include "spargel/base/types.h"
 
+#if SPARGEL_IS_MSVC
+#include <intrin.h>
+#endif
+
 namespace spargel::base {
 
     inline u8 GetMostSignificantBit(u64 x) {
@@ -15,6 +19,40 @@ namespace spargel::base {
         //   Returns the number of leading 0-bits in x, starting at the most
         //   significant bit position. If x is 0, the result is undefined.
         return static_cast<u8>(63 - __builtin_clzll(x));
+#elif SPARGEL_IS_MSVC
+        unsigned long index;
+        _BitScanReverse64(&index, x);
+        return static_cast<u8>(index);
+#else
+        spargel_panic_here();
+#endif
+    }
+
+    // Number of trailing 0-bits. `x` must be non-zero.
+    inline u32 CountTrailingZeros(u64 x) {
+        spargel_dcheck(x > 0);
+
+#if spargel_has_builtin(__builtin_ctzll)
+        return static_cast<u32>(__builtin_ctzll(x));
+#elif SPARGEL_IS_MSVC
+        unsigned long index;
+        _BitScanForward64(&index, x);
+        return static_cast<u32>(index);
+#else
+        spargel_panic_here();
+#endif
+    }
+
+    // Number of leading 0-bits. `x` must be non-zero.
+    inline u32 CountLeadingZeros(u64 x) {
+        spargel_dcheck(x > 0);
+
+#if spargel_has_builtin(__builtin_clzll)
+        return static_cast<u32>(__builtin_clzll(x));
+#elif SPARGEL_IS_MSVC
+        unsigned long index;
+        _BitScanReverse64(&index, x);
+        return static_cast<u32>(63 - index);
 #else
         spargel_panic_here();
 #endif
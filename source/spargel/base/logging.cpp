@@ -1,6 +1,9 @@
 #include "spargel/base/logging.h"
 
+#include "spargel/base/allocator.h"
 #include "spargel/base/assert.h"
+#include "spargel/base/atomic.h"
+#include "spargel/base/object.h"
 #include "spargel/config.h"
 
 // libc
@@ -11,8 +14,8 @@
 #include <time.h>
 
 // platform
-#if SPARGEL_IS_POSIX || SPARGEL_IS_EMSCRIPTEN
-#include <sys/time.h>
+#if SPARGEL_IS_POSIX
+#include <pthread.h>
 #endif
 
 #if SPARGEL_IS_ANDROID
@@ -34,154 +37,509 @@ namespace spargel::base {
         "DEBUG", "INFO", "WARN", "ERROR", "FATAL",
     };
 
-    struct log_timestamp {
-        int mon;
-        int day;
-        int hour;
-        int min;
-        int sec;
-        int usec;
-    };
+    namespace {
 
-    static void log_get_time(struct log_timestamp* time) {
+        // Microseconds since the epoch of the platform clock.
+        u64 log_now_us() {
 #if SPARGEL_IS_POSIX || SPARGEL_IS_EMSCRIPTEN
-        struct timeval tv;
-        gettimeofday(&tv, NULL);
-        time_t t = tv.tv_sec;
-        struct tm local_time;
-        localtime_r(&t, &local_time);
-        struct tm* tm_time = &local_time;
-        time->mon = tm_time->tm_mon + 1;
-        time->day = tm_time->tm_mday;
-        time->hour = tm_time->tm_hour;
-        time->min = tm_time->tm_min;
-        time->sec = tm_time->tm_sec;
-        time->usec = tv.tv_usec;
+            timespec ts;
+            clock_gettime(CLOCK_REALTIME, &ts);
+            return static_cast<u64>(ts.tv_sec) * 1000000 + static_cast<u64>(ts.tv_nsec) / 1000;
 #elif SPARGEL_IS_WINDOWS
-        SYSTEMTIME system_time;
-        GetSystemTime(&system_time);
-        time->mon = system_time.wMonth;
-        time->day = system_time.wDay;
-        time->hour = system_time.wHour;
-        time->min = system_time.wMinute;
-        time->sec = system_time.wSecond;
-        time->usec = system_time.wMilliseconds * 1000;
+            FILETIME file_time;
+            GetSystemTimeAsFileTime(&file_time);
+            u64 t = (static_cast<u64>(file_time.dwHighDateTime) << 32) | file_time.dwLowDateTime;
+            // 100ns ticks since 1601.
+            return t / 10;
 #else
 #error unimplemented
 #endif
-    }
+        }
 
-    void log(int level, char const* file, char const* func, u32 line, char const* format, ...) {
-        spargel_assert(level >= 0 && level < _LOG_COUNT);
+        // `MMDD/hhmmss` of the last second formatted on this thread. Breaking down the time is
+        // slow, so it happens once per second per thread.
+        struct SecondCache {
+            u64 second = ~0ull;
+            char text[24] = {};
+        };
 
-        va_list ap;
+        thread_local SecondCache second_cache;
 
+        char const* format_second(u64 second) {
+            SecondCache& cache = second_cache;
+            if (cache.second == second) return cache.text;
+            int mon, day, hour, min, sec;
+#if SPARGEL_IS_POSIX || SPARGEL_IS_EMSCRIPTEN
+            time_t t = static_cast<time_t>(second);
+            struct tm local_time;
+            localtime_r(&t, &local_time);
+            mon = local_time.tm_mon + 1;
+            day = local_time.tm_mday;
+            hour = local_time.tm_hour;
+            min = local_time.tm_min;
+            sec = local_time.tm_sec;
+#elif SPARGEL_IS_WINDOWS
+            u64 ticks = second * 10000000;
+            FILETIME file_time;
+            file_time.dwLowDateTime = static_cast<DWORD>(ticks);
+            file_time.dwHighDateTime = static_cast<DWORD>(ticks >> 32);
+            SYSTEMTIME system_time;
+            FileTimeToSystemTime(&file_time, &system_time);
+            mon = system_time.wMonth;
+            day = system_time.wDay;
+            hour = system_time.wHour;
+            min = system_time.wMinute;
+            sec = system_time.wSecond;
+#endif
+            snprintf(cache.text, sizeof(cache.text), "%02d%02d/%02d%02d%02d", mon, day, hour, min,
+                     sec);
+            cache.second = second;
+            return cache.text;
+        }
+
+        // Write one formatted message to the sinks of the platform.
+        void write_line(int level, u64 time_us, char const* file, char const* func, u32 line,
+                        char const* text, bool truncated) {
 #if !SPARGEL_IS_EMSCRIPTEN
 
+#if SPARGEL_IS_WINDOWS
+            _lock_file(stderr);
+#else
+            flockfile(stderr);
+#endif
+
 #if SPARGEL_ENABLE_LOG_ANSI_COLOR
-        char const* log_prefix;
-        switch (level) {
-        case 0:
-            log_prefix = "\033[36m";
-            break;
-        case 1:
-            log_prefix = "\033[32m";
-            break;
-        case 2:
-            log_prefix = "\033[1;93m";
-            break;
-        case 3:
-        case 4:
-            log_prefix = "\033[1;31m";
-            break;
-        default:
-            log_prefix = "\033[0m";
-            break;
-        }
-        fputs(log_prefix, stderr);
+            char const* log_prefix;
+            switch (level) {
+            case 0:
+                log_prefix = "\033[36m";
+                break;
+            case 1:
+                log_prefix = "\033[32m";
+                break;
+            case 2:
+                log_prefix = "\033[1;93m";
+                break;
+            case 3:
+            case 4:
+                log_prefix = "\033[1;31m";
+                break;
+            default:
+                log_prefix = "\033[0m";
+                break;
+            }
+            fputs(log_prefix, stderr);
 #endif  // SPARGEL_ENABLE_LOG_ANSI_COLOR
 
-        char const* name = log_names[level];
-        struct log_timestamp time;
-        log_get_time(&time);
-
-        // Old log format.
-        //
-        // fprintf(stderr, "[%02d%02d/%02d%02d%02d.%06d:%s:%s:%s:%u] ", time.mon, time.day,
-        // time.hour,
-        //         time.min, time.sec, time.usec, name, file, func, line);
-
-        fprintf(stderr, "[%02d%02d/%02d%02d%02d.%06d:%s:%s:%s:%u] ", time.mon, time.day, time.hour,
-                time.min, time.sec, time.usec, name, file, func, line);
-
-        va_start(ap, format);
-        vfprintf(stderr, format, ap);
-        va_end(ap);
+            fprintf(stderr, "[%s.%06u:%s:%s:%s:%u] %s%s", format_second(time_us / 1000000),
+                    static_cast<u32>(time_us % 1000000), log_names[level], file, func, line, text,
+                    truncated ? "..." : "");
 
 #if SPARGEL_ENABLE_LOG_ANSI_COLOR
-        fputs("\033[0m", stderr);
+            fputs("\033[0m", stderr);
 #endif
 
-        fprintf(stderr, "\n");
+            fputc('\n', stderr);
+
+#if SPARGEL_IS_WINDOWS
+            _unlock_file(stderr);
+#else
+            funlockfile(stderr);
+#endif
 
 #endif  // !SPARGEL_IS_EMSCRIPTEN
 
 #if SPARGEL_IS_ANDROID
 
-        int android_log_prio;
-        switch (level) {
-        case 0:
-            android_log_prio = ANDROID_LOG_DEBUG;
-            break;
-        case 1:
-            android_log_prio = ANDROID_LOG_INFO;
-            break;
-        case 2:
-            android_log_prio = ANDROID_LOG_WARN;
-            break;
-        case 3:
-            android_log_prio = ANDROID_LOG_ERROR;
-            break;
-        case 4:
-            android_log_prio = ANDROID_LOG_FATAL;
-            break;
-        default:
-            android_log_prio = ANDROID_LOG_UNKNOWN;
-            break;
-        }
-        va_start(ap, format);
-        __android_log_vprint(android_log_prio, "spargel", format, ap);
-        va_end(ap);
+            int android_log_prio;
+            switch (level) {
+            case 0:
+                android_log_prio = ANDROID_LOG_DEBUG;
+                break;
+            case 1:
+                android_log_prio = ANDROID_LOG_INFO;
+                break;
+            case 2:
+                android_log_prio = ANDROID_LOG_WARN;
+                break;
+            case 3:
+                android_log_prio = ANDROID_LOG_ERROR;
+                break;
+            case 4:
+                android_log_prio = ANDROID_LOG_FATAL;
+                break;
+            default:
+                android_log_prio = ANDROID_LOG_UNKNOWN;
+                break;
+            }
+            __android_log_print(android_log_prio, "spargel", "%s", text);
 
 #elif SPARGEL_IS_EMSCRIPTEN
 
-        // FIXME
-        char log_buf[4096];
+            (void)time_us;
+            (void)file;
+            (void)func;
+            (void)line;
+            (void)truncated;
+
+            switch (level) {
+            case 0:
+                emscriptenConsoleDebug(text);
+                break;
+            case 1:
+                emscriptenConsoleInfo(text);
+                break;
+            case 2:
+                emscriptenConsoleWarn(text);
+                break;
+            case 3:
+            case 4:
+                emscriptenConsoleError(text);
+                break;
+            default:
+                emscriptenConsoleLog(text);
+                break;
+            }
+
+#endif  // SPARGEL_IS_EMSCRIPTEN
+        }
+
+        struct LogRecord {
+            u64 time_us;
+            char const* file;
+            char const* func;
+            u32 line;
+            u16 level;
+            bool truncated;
+            char text[async_log_message_capacity];
+        };
+
+        // A single-producer single-consumer ring of messages. The producer is the owning thread,
+        // the consumer whoever holds the drain lock.
+        struct LogBuffer {
+            // In records. A power of two.
+            static constexpr usize capacity = 128;
+
+            // Written by the owning thread only.
+            Atomic<u64> head{0};
+            Atomic<u64> dropped{0};
+            // Set by the owning thread when it exits.
+            Atomic<bool> retired{false};
+            // Keep `tail` off the cache line of `head`.
+            u8 _padding[64];
+            // Written by the consumer only.
+            Atomic<u64> tail{0};
+            u64 reported_dropped = 0;
+            LogBuffer* next = nullptr;
+            LogRecord records[capacity];
+        };
+
+        // How often the writer drains the rings.
+        constexpr u32 write_interval_ms = 10;
+
+        void sleep_ms(u32 ms) {
+#if SPARGEL_IS_POSIX
+            timespec ts{0, static_cast<long>(ms) * 1000000};
+            nanosleep(&ts, nullptr);
+#elif SPARGEL_IS_WINDOWS
+            Sleep(ms);
+#else
+            (void)ms;
+#endif
+        }
+
+        // The state is constant-initialized and never destroyed, so that logging works in
+        // static constructors and destructors.
+        class AsyncLogger {
+        public:
+            bool running() const { return _running.load(MemoryOrder::acquire); }
+
+            bool start();
+            void stop();
+            void flush();
+            u64 droppedCount();
+
+            // Format a message into the ring of the calling thread, or drop it if the ring is
+            // full. Return false if the thread is exiting and has no ring anymore.
+            bool push(int level, u64 time_us, char const* file, char const* func, u32 line,
+                      char const* format, va_list ap);
+
+            // Write a message synchronously, after the pending ones.
+            void writeInOrder(int level, u64 time_us, char const* file, char const* func, u32 line,
+                              char const* text, bool truncated);
+
+        private:
+            LogBuffer* registerThread();
+            // Requires `_drain_lock`.
+            void drain();
+            static void* writerMain(void* arg);
+#if SPARGEL_IS_WINDOWS
+            static DWORD WINAPI windowsWriterMain(LPVOID arg) {
+                writerMain(arg);
+                return 0;
+            }
+#endif
+
+            Atomic<bool> _running{false};
+            Atomic<bool> _stop{false};
+            // Buffers registered since the last drain, pushed lock-free by new threads.
+            Atomic<LogBuffer*> _new_buffers{nullptr};
+            // Only touched while holding `_drain_lock`.
+            LogBuffer* _buffers = nullptr;
+            u64 _retired_dropped = 0;
+            // Held while writing to stderr, so waiters sleep rather than spin.
+            Mutex _drain_lock;
+            // The writer thread.
+            void* _writer = nullptr;
+        };
+
+        AsyncLogger async_logger;
+
+        thread_local LogBuffer* thread_buffer = nullptr;
+        // Set once the ring of this thread is retired. Later messages, e.g. from destructors of
+        // other thread-locals, are written synchronously.
+        thread_local bool thread_exiting = false;
 
+        // Marks the buffer of an exiting thread as retired, and writes out what it left.
+        struct ThreadSlot {
+            LogBuffer* buffer = nullptr;
+            ~ThreadSlot() {
+                if (buffer != nullptr) {
+                    thread_buffer = nullptr;
+                    thread_exiting = true;
+                    buffer->retired.store(true, MemoryOrder::release);
+                    async_logger.flush();
+                }
+            }
+        };
+
+        bool AsyncLogger::start() {
+#if SPARGEL_IS_POSIX || SPARGEL_IS_WINDOWS
+            if (running()) return true;
+            _stop.store(false, MemoryOrder::relaxed);
+#if SPARGEL_IS_POSIX
+            auto thread = new pthread_t;
+            if (pthread_create(thread, nullptr, writerMain, this) != 0) {
+                delete thread;
+                return false;
+            }
+            _writer = thread;
+#else
+            _writer = CreateThread(nullptr, 0, windowsWriterMain, this, 0, nullptr);
+            if (_writer == nullptr) return false;
+#endif
+            _running.store(true, MemoryOrder::release);
+            return true;
+#else
+            return false;
+#endif
+        }
+
+        void AsyncLogger::stop() {
+            if (!_running.exchange(false)) return;
+            _stop.store(true, MemoryOrder::release);
+#if SPARGEL_IS_POSIX
+            auto thread = static_cast<pthread_t*>(_writer);
+            pthread_join(*thread, nullptr);
+            delete thread;
+#elif SPARGEL_IS_WINDOWS
+            WaitForSingleObject(_writer, INFINITE);
+            CloseHandle(_writer);
+#endif
+            _writer = nullptr;
+            flush();
+        }
+
+        void AsyncLogger::flush() {
+            LockGuard guard(_drain_lock);
+            drain();
+            fflush(stderr);
+        }
+
+        u64 AsyncLogger::droppedCount() {
+            LockGuard guard(_drain_lock);
+            u64 n = _retired_dropped;
+            for (LogBuffer* b = _buffers; b != nullptr; b = b->next) {
+                n += b->dropped.load(MemoryOrder::relaxed);
+            }
+            for (LogBuffer* b = _new_buffers.load(MemoryOrder::acquire); b != nullptr;
+                 b = b->next) {
+                n += b->dropped.load(MemoryOrder::relaxed);
+            }
+            return n;
+        }
+
+        LogBuffer* AsyncLogger::registerThread() {
+            thread_local ThreadSlot slot;
+
+            auto b = static_cast<LogBuffer*>(default_allocator()->allocate(sizeof(LogBuffer)));
+            construct_at(b);
+
+            LogBuffer* head = _new_buffers.load(MemoryOrder::relaxed);
+            do {
+                b->next = head;
+            } while (!_new_buffers.compareExchangeWeak(head, b, MemoryOrder::release,
+                                                        MemoryOrder::relaxed));
+
+            slot.buffer = b;
+            thread_buffer = b;
+            return b;
+        }
+
+        bool AsyncLogger::push(int level, u64 time_us, char const* file, char const* func,
+                               u32 line, char const* format, va_list ap) {
+            LogBuffer* b = thread_buffer;
+            if (b == nullptr) [[unlikely]] {
+                if (thread_exiting) return false;
+                b = registerThread();
+            }
+            u64 head = b->head.load(MemoryOrder::relaxed);
+            if (head - b->tail.load(MemoryOrder::acquire) == LogBuffer::capacity) {
+                b->dropped.store(b->dropped.load(MemoryOrder::relaxed) + 1, MemoryOrder::relaxed);
+                return true;
+            }
+            LogRecord& r = b->records[head & (LogBuffer::capacity - 1)];
+            r.time_us = time_us;
+            r.file = file;
+            r.func = func;
+            r.line = line;
+            r.level = static_cast<u16>(level);
+            int n = vsnprintf(r.text, sizeof(r.text), format, ap);
+            r.truncated = n >= static_cast<int>(sizeof(r.text));
+            // Sequentially consistent, pairing with `stop()`: either the final drain sees this
+            // record, or this thread sees that the logger stopped and drains it itself.
+            b->head.store(head + 1);
+            if (!_running.load()) [[unlikely]] {
+                flush();
+            }
+            return true;
+        }
+
+        void AsyncLogger::writeInOrder(int level, u64 time_us, char const* file, char const* func,
+                                       u32 line, char const* text, bool truncated) {
+            LockGuard guard(_drain_lock);
+            drain();
+            write_line(level, time_us, file, func, line, text, truncated);
+        }
+
+        void AsyncLogger::drain() {
+            // Adopt the buffers of new threads.
+            LogBuffer* fresh = _new_buffers.exchange(nullptr, MemoryOrder::acquire);
+            while (fresh != nullptr) {
+                LogBuffer* next = fresh->next;
+                fresh->next = _buffers;
+                _buffers = fresh;
+                fresh = next;
+            }
+
+            LogBuffer** link = &_buffers;
+            while (LogBuffer* b = *link) {
+                // Read before the head: a retired buffer gets no more records.
+                bool retired = b->retired.load(MemoryOrder::acquire);
+                u64 head = b->head.load();
+                u64 tail = b->tail.load(MemoryOrder::relaxed);
+                for (; tail != head; tail++) {
+                    LogRecord& r = b->records[tail & (LogBuffer::capacity - 1)];
+                    write_line(r.level, r.time_us, r.file, r.func, r.line, r.text, r.truncated);
+                }
+                b->tail.store(tail, MemoryOrder::release);
+
+                u64 dropped = b->dropped.load(MemoryOrder::relaxed);
+                if (dropped != b->reported_dropped) {
+                    char text[64];
+                    snprintf(text, sizeof(text), "%llu log messages dropped",
+                             static_cast<unsigned long long>(dropped - b->reported_dropped));
+                    write_line(LOG_WARN, log_now_us(), FILE_NAME_, __func__, __LINE__, text,
+                               false);
+                    b->reported_dropped = dropped;
+                }
+
+                if (retired) {
+                    *link = b->next;
+                    _retired_dropped += dropped;
+                    destruct_at(b);
+                    default_allocator()->free(b, sizeof(LogBuffer));
+                } else {
+                    link = &b->next;
+                }
+            }
+        }
+
+        void* AsyncLogger::writerMain(void* arg) {
+            auto self = static_cast<AsyncLogger*>(arg);
+            while (!self->_stop.load(MemoryOrder::acquire)) {
+                sleep_ms(write_interval_ms);
+                LockGuard guard(self->_drain_lock);
+                self->drain();
+            }
+            return nullptr;
+        }
+
+    }  // namespace
+
+    bool start_async_logging() {
+        static bool registered = false;
+        if (!async_logger.start()) return false;
+        if (!registered) {
+            atexit(stop_async_logging);
+            registered = true;
+        }
+        return true;
+    }
+
+    void stop_async_logging() { async_logger.stop(); }
+
+    void flush_log() {
+        if (async_logger.running()) {
+            async_logger.flush();
+        } else {
+            fflush(stderr);
+        }
+    }
+
+    u64 dropped_log_count() { return async_logger.droppedCount(); }
+
+    void log(int level, char const* file, char const* func, u32 line, char const* format, ...) {
+        spargel_assert(level >= 0 && level < _LOG_COUNT);
+
+        u64 time_us = log_now_us();
+        va_list ap;
+
+        bool async = async_logger.running();
+        if (async && level < LOG_ERROR) {
+            va_start(ap, format);
+            bool pushed = async_logger.push(level, time_us, file, func, line, format, ap);
+            va_end(ap);
+            if (pushed) return;
+        }
+
+        // Long messages are rare, so try a buffer on the stack first.
+        char stack_buf[1024];
+        char* text = stack_buf;
         va_start(ap, format);
-        vsnprintf(log_buf, 4096, format, ap);
+        int n = vsnprintf(stack_buf, sizeof(stack_buf), format, ap);
         va_end(ap);
+        if (n < 0) {
+            n = 0;
+            stack_buf[0] = '\0';
+        }
+        usize size = static_cast<usize>(n) + 1;
+        if (size > sizeof(stack_buf)) {
+            text = static_cast<char*>(default_allocator()->allocate(size));
+            va_start(ap, format);
+            vsnprintf(text, size, format, ap);
+            va_end(ap);
+        }
 
-        switch (level) {
-        case 0:
-            emscriptenConsoleDebug(log_buf);
-            break;
-        case 1:
-            emscriptenConsoleInfo(log_buf);
-            break;
-        case 2:
-            emscriptenConsoleWarn(log_buf);
-            break;
-        case 3:
-        case 4:
-            emscriptenConsoleError(log_buf);
-            break;
-        default:
-            emscriptenConsoleLog(log_buf);
-            break;
+        if (async) {
+            async_logger.writeInOrder(level, time_us, file, func, line, text, false);
+        } else {
+            write_line(level, time_us, file, func, line, text, false);
         }
 
-#endif  // SPARGEL_IS_EMSCRIPTEN
+        if (text != stack_buf) {
+            default_allocator()->free(text, size);
+        }
     }
 
 }  // namespace spargel::base
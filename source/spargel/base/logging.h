@@ -3,6 +3,7 @@
 #include "spargel/base/compiler.h"
 #include "spargel/base/source_location.h"
 #include "spargel/base/types.h"
+#include "spargel/config.h"
 
 #if SPARGEL_IS_CLANG || SPARGEL_IS_GCC
 #define FILE_NAME_ __FILE_NAME__
@@ -10,13 +11,18 @@
 #define FILE_NAME_ __FILE__
 #endif
 
-#define LOG_IMPL(level, ...) \
+// Messages below `SPARGEL_LOG_MIN_LEVEL` compile to nothing, and their arguments are not
+// evaluated. Fatal messages are never filtered.
+
+#define LOG_CALL(level, ...) \
     ::spargel::base::log(level, FILE_NAME_, __func__, __LINE__, __VA_ARGS__)
+#define LOG_IMPL(level, ...) \
+    ((level) >= SPARGEL_LOG_MIN_LEVEL ? LOG_CALL(level, __VA_ARGS__) : (void)0)
 #define spargel_log_debug(...) LOG_IMPL(::spargel::base::LOG_DEBUG, __VA_ARGS__)
 #define spargel_log_info(...) LOG_IMPL(::spargel::base::LOG_INFO, __VA_ARGS__)
 #define spargel_log_warn(...) LOG_IMPL(::spargel::base::LOG_WARN, __VA_ARGS__)
 #define spargel_log_error(...) LOG_IMPL(::spargel::base::LOG_ERROR, __VA_ARGS__)
-#define spargel_log_fatal(...) LOG_IMPL(::spargel::base::LOG_FATAL, __VA_ARGS__);
+#define spargel_log_fatal(...) LOG_CALL(::spargel::base::LOG_FATAL, __VA_ARGS__);
 
 namespace spargel::base {
 
@@ -38,6 +44,32 @@ namespace spargel::base {
     SPARGEL_ATTRIBUTE_PRINTF_FORMAT(5, 6)
     void log(int level, char const* file, char const* func, u32 line, char const* format, ...);
 
+    // Asynchronous logging
+    //
+    // After `start_async_logging()`, `log()` formats the message into a ring buffer of the
+    // calling thread and returns. A background thread writes the messages out every few
+    // milliseconds.
+    //
+    // Note:
+    //     - Recording takes no lock. When the ring of a thread is full, debug, info and warning
+    //       messages are dropped, and the writer reports how many. Errors and fatal messages
+    //       are never dropped: they flush the pending messages and are written synchronously.
+    //     - A message longer than `async_log_message_capacity` bytes is truncated.
+    //     - Messages of one thread keep their order. Messages of different threads are ordered
+    //       by the time of the drain, not by their timestamps.
+    //     - Only available on POSIX and Windows. Elsewhere, logging stays synchronous.
+    //
+    constexpr usize async_log_message_capacity = 448;
+
+    // Return false if asynchronous logging is not available. Stopped at exit.
+    bool start_async_logging();
+    // Write out the pending messages, and go back to synchronous logging.
+    void stop_async_logging();
+    // Write out the messages logged so far. Thread-safe.
+    void flush_log();
+    // The number of messages dropped because a ring was full.
+    u64 dropped_log_count();
+
     struct logger {};
 
 }  // namespace spargel::base
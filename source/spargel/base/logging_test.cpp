@@ -0,0 +1,119 @@
+#include "spargel/base/logging.h"
+
+#include "spargel/base/check.h"
+#include "spargel/base/test.h"
+#include "spargel/base/vector.h"
+
+// libc
+#include <stdio.h>
+#include <string.h>
+
+#if SPARGEL_IS_POSIX
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+namespace spargel::base {
+    namespace {
+        TEST(Logging_Expression) {
+            int evaluated = 0;
+            // The macros are expressions, usable without braces.
+            if (evaluated == 0)
+                spargel_log_info("evaluated %d", ++evaluated);
+            else
+                spargel_log_info("not reached");
+            spargel_check(evaluated == (LOG_INFO >= SPARGEL_LOG_MIN_LEVEL ? 1 : 0));
+        }
+
+#if SPARGEL_IS_POSIX
+        void* log_from_thread(void* arg) {
+            int id = *static_cast<int*>(arg);
+            for (int i = 0; i < 16; i++) {
+                spargel_log_info("thread %d message %d", id, i);
+            }
+            return nullptr;
+        }
+
+        // Send stderr to a temporary file until `finish`, which returns what was written.
+        struct CaptureStderr {
+            FILE* file = tmpfile();
+            int saved = dup(2);
+
+            CaptureStderr() {
+                fflush(stderr);
+                dup2(fileno(file), 2);
+            }
+
+            vector<char> finish() {
+                fflush(stderr);
+                dup2(saved, 2);
+                close(saved);
+                vector<char> text;
+                long size = ftell(file);
+                text.resize(static_cast<usize>(size) + 1);
+                rewind(file);
+                usize n = fread(text.data(), 1, static_cast<usize>(size), file);
+                text[n] = '\0';
+                fclose(file);
+                return text;
+            }
+        };
+
+        TEST(Logging_Async) {
+            spargel_check(start_async_logging());
+            u64 dropped = dropped_log_count();
+            CaptureStderr capture;
+
+            // `log` directly, so that `SPARGEL_LOG_MIN_LEVEL` does not filter them.
+            for (int i = 0; i < 16; i++) {
+                log(LOG_DEBUG, FILE_NAME_, __func__, __LINE__, "async message %d", i);
+            }
+            // Written synchronously, after the messages above.
+            log(LOG_ERROR, FILE_NAME_, __func__, __LINE__, "async error");
+
+            char long_text[600];
+            memset(long_text, 'x', sizeof(long_text) - 1);
+            long_text[sizeof(long_text) - 1] = '\0';
+            log(LOG_INFO, FILE_NAME_, __func__, __LINE__, "%s", long_text);
+
+            pthread_t threads[4];
+            int ids[4];
+            for (int i = 0; i < 4; i++) {
+                ids[i] = i;
+                pthread_create(&threads[i], nullptr, log_from_thread, &ids[i]);
+            }
+            for (int i = 0; i < 4; i++) {
+                pthread_join(threads[i], nullptr);
+            }
+            flush_log();
+            // Far below the capacity of a ring.
+            spargel_check(dropped_log_count() == dropped);
+
+            // Much faster than the writer drains a ring.
+            for (int i = 0; i < 20000; i++) {
+                log(LOG_DEBUG, FILE_NAME_, __func__, __LINE__, "flood %d", i);
+            }
+            flush_log();
+            spargel_check(dropped_log_count() > dropped);
+
+            stop_async_logging();
+            vector<char> out = capture.finish();
+            char const* text = out.data();
+            char const* last = strstr(text, "async message 15");
+            char const* error = strstr(text, "async error");
+            spargel_check(strstr(text, "async message 0") != nullptr);
+            spargel_check(last != nullptr && error != nullptr && last < error);
+            spargel_check(strstr(text, "log messages dropped") != nullptr);
+
+            // The message is cut at the capacity, terminator included, and marked.
+            char expected[async_log_message_capacity + 4];
+            memset(expected, 'x', async_log_message_capacity - 1);
+            memcpy(expected + async_log_message_capacity - 1, "...", 4);
+            spargel_check(strstr(text, expected) != nullptr);
+            spargel_check(strstr(text, long_text) == nullptr);
+
+            spargel_log_info("synchronous again");
+        }
+#endif
+    }  // namespace
+}  // namespace spargel::base
@@ -4,6 +4,11 @@
 #include "spargel/base/backtrace.h"
 #include "spargel/base/compiler.h"
 #include "spargel/base/logging.h"
+#include "spargel/config.h"
+
+#if SPARGEL_ENABLE_TRACING
+#include "spargel/base/trace.h"
+#endif
 
 /* libc */
 #include <stdio.h>
@@ -16,6 +21,10 @@ namespace spargel::base {
         fprintf(stderr, "======== PANIC [%s:%s:%u] ========\n", file, func, line);
         fprintf(stderr, "%s\n", msg);
         PrintBacktrace();
+#if SPARGEL_ENABLE_TRACING
+        // Keep the events leading up to the panic.
+        TraceEngine::flushForCrash();
+#endif
 #if defined(SPARGEL_IS_CLANG) || defined(SPARGEL_IS_GCC)
         __builtin_trap();
 #elif defined(SPARGEL_IS_MSVC)
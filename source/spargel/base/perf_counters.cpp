@@ -0,0 +1,102 @@
+#include "spargel/base/perf_counters.h"
+
+#include "spargel/config.h"
+
+#if SPARGEL_IS_LINUX || SPARGEL_IS_ANDROID
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace spargel::base {
+
+#if SPARGEL_IS_LINUX || SPARGEL_IS_ANDROID
+
+    namespace {
+        int open_counter(u64 config, int group) {
+            perf_event_attr attr{};
+            attr.size = sizeof(attr);
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = config;
+            // The leader starts disabled, and enables the whole group at once.
+            if (group < 0) attr.disabled = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format =
+                PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, group, 0));
+        }
+    }  // namespace
+
+    PerfCounterGroup::PerfCounterGroup() {
+        constexpr u64 configs[counter_count] = {
+            PERF_COUNT_HW_CPU_CYCLES,
+            PERF_COUNT_HW_INSTRUCTIONS,
+            PERF_COUNT_HW_CACHE_MISSES,
+            PERF_COUNT_HW_BRANCH_MISSES,
+        };
+        for (usize i = 0; i < counter_count; i++) {
+            _fds[i] = open_counter(configs[i], _fds[0]);
+            if (_fds[i] < 0) {
+                _fds[i] = -1;
+                // Without the leader there is no group.
+                if (i == 0) return;
+                continue;
+            }
+            _positions[i] = _open_count++;
+        }
+        ioctl(_fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(_fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+
+    PerfCounterGroup::~PerfCounterGroup() {
+        // Members first, then the leader.
+        for (usize i = counter_count; i-- > 0;) {
+            if (_fds[i] >= 0) close(_fds[i]);
+        }
+    }
+
+    PerfCounterValues PerfCounterGroup::read() const {
+        PerfCounterValues result;
+        if (!isAvailable()) return result;
+
+        // See `PERF_FORMAT_GROUP` in perf_event_open(2).
+        struct {
+            u64 count;
+            u64 time_enabled;
+            u64 time_running;
+            u64 values[counter_count];
+        } data;
+        if (::read(_fds[0], &data, sizeof(data)) <= 0) return result;
+
+        u64 values[counter_count] = {};
+        for (usize i = 0; i < counter_count; i++) {
+            if (_fds[i] < 0) continue;
+            u64 v = data.values[_positions[i]];
+            // The kernel multiplexes the counters when there are too few of them. Scale up to
+            // the whole time the group was enabled.
+            if (data.time_running != 0 && data.time_running < data.time_enabled) {
+                v = static_cast<u64>(static_cast<f64>(v) * static_cast<f64>(data.time_enabled) /
+                                     static_cast<f64>(data.time_running));
+            }
+            values[i] = v;
+        }
+        result.cycles = values[0];
+        result.instructions = values[1];
+        result.cache_misses = values[2];
+        result.branch_misses = values[3];
+        return result;
+    }
+
+#else
+
+    PerfCounterGroup::PerfCounterGroup() {}
+
+    PerfCounterGroup::~PerfCounterGroup() {}
+
+    PerfCounterValues PerfCounterGroup::read() const { return {}; }
+
+#endif
+
+}  // namespace spargel::base
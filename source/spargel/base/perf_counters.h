@@ -0,0 +1,68 @@
+#pragma once
+
+#include "spargel/base/types.h"
+
+namespace spargel::base {
+
+    struct PerfCounterValues {
+        u64 cycles = 0;
+        u64 instructions = 0;
+        u64 cache_misses = 0;
+        u64 branch_misses = 0;
+
+        PerfCounterValues operator-(PerfCounterValues const& other) const {
+            return {cycles - other.cycles, instructions - other.instructions,
+                    cache_misses - other.cache_misses, branch_misses - other.branch_misses};
+        }
+
+        PerfCounterValues& operator+=(PerfCounterValues const& other) {
+            cycles += other.cycles;
+            instructions += other.instructions;
+            cache_misses += other.cache_misses;
+            branch_misses += other.branch_misses;
+            return *this;
+        }
+
+        // Instructions per cycle.
+        f64 ipc() const {
+            return cycles == 0 ? 0 : static_cast<f64>(instructions) / static_cast<f64>(cycles);
+        }
+    };
+
+    // PerfCounterGroup
+    //
+    // Hardware performance counters of the calling thread: cycles, instructions, cache misses
+    // and branch misses, read together.
+    //
+    // Note:
+    //     - Linux only, through `perf_event_open(2)`. Elsewhere, or when the kernel forbids
+    //       access (see `/proc/sys/kernel/perf_event_paranoid`), `isAvailable()` is false and
+    //       `read()` returns zeros.
+    //     - Only user space is counted, and only on the thread that created the group.
+    //     - A counter the CPU does not have reads as zero.
+    //     - A read is a system call, about a microsecond. Keep it out of the innermost loops.
+    //
+    class PerfCounterGroup {
+    public:
+        PerfCounterGroup();
+        ~PerfCounterGroup();
+
+        PerfCounterGroup(PerfCounterGroup const&) = delete;
+        PerfCounterGroup& operator=(PerfCounterGroup const&) = delete;
+
+        bool isAvailable() const { return _fds[0] >= 0; }
+
+        // The counts since the group was created.
+        PerfCounterValues read() const;
+
+    private:
+        static constexpr usize counter_count = 4;
+
+        // In the order of `PerfCounterValues`. The first one leads the group. -1 if not open.
+        int _fds[counter_count] = {-1, -1, -1, -1};
+        // The position of each counter in a group read.
+        u8 _positions[counter_count] = {};
+        u8 _open_count = 0;
+    };
+
+}  // namespace spargel::base
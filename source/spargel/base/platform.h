@@ -35,4 +35,14 @@ namespace spargel::base {
 
     string get_executable_path();
 
+    /*
+     * time and threads
+     */
+
+    // Nanoseconds since an unspecified point. Monotonic, and cheap enough for trace events.
+    u64 get_monotonic_time_ns();
+
+    // The id of the calling thread, as shown by the system's tools.
+    u64 get_current_thread_id();
+
 }  // namespace spargel::base
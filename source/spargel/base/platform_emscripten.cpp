@@ -1,5 +1,7 @@
 #include "spargel/base/platform_emscripten.h"
 
+#include "spargel/base/atomic.h"
+
 // libc
 #include <string.h>
 
@@ -31,6 +33,17 @@ namespace spargel::base {
         return strlen(todo);
     }
 
+    u64 get_monotonic_time_ns() { return static_cast<u64>(emscripten_get_now() * 1e6); }
+
+    u64 get_current_thread_id() { return 0; }
+
+    // Without threads nobody else can change `*addr`, so waiting would never end.
+    void atomic_wait(u32*, u32) {}
+    void atomic_notify_one(u32*) {}
+    void atomic_notify_all(u32*) {}
+
+    usize capture_backtrace(void**, usize) { return 0; }
+
     // FIXME
     void PrintBacktrace() {
         EM_ASM({ console.trace(); });
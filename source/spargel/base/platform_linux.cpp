@@ -2,11 +2,17 @@
  * Android-target build also uses this file.
  */
 
+#include "spargel/base/atomic.h"
+#include "spargel/base/backtrace.h"
 #include "spargel/base/platform.h"
 
 /* libc */
+#include <limits.h>
+#include <linux/futex.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <sys/syscall.h>
+#include <time.h>
 #include <unistd.h>
 
 #if SPARGEL_ENABLE_LIBUNWIND
@@ -14,6 +20,8 @@
 #define UNW_LOCAL_ONLY
 #include <libunwind-x86_64.h>
 #include <libunwind.h>
+#elif __has_include(<execinfo.h>)
+#include <execinfo.h>
 #endif
 
 namespace spargel::base {
@@ -22,6 +30,26 @@ namespace spargel::base {
         return readlink("/proc/self/exe", buf, buf_size);
     }
 
+    u64 get_monotonic_time_ns() {
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return static_cast<u64>(ts.tv_sec) * 1000000000 + static_cast<u64>(ts.tv_nsec);
+    }
+
+    u64 get_current_thread_id() { return static_cast<u64>(syscall(SYS_gettid)); }
+
+    void atomic_wait(u32* addr, u32 expected) {
+        syscall(SYS_futex, addr, FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+    }
+
+    void atomic_notify_one(u32* addr) {
+        syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+    }
+
+    void atomic_notify_all(u32* addr) {
+        syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
+    }
+
 #if SPARGEL_ENABLE_LIBUNWIND
 
     void PrintBacktrace() {
@@ -44,10 +72,22 @@ namespace spargel::base {
         }
     }
 
+    [[gnu::noinline]] usize capture_backtrace(void** frames, usize max_frames) {
+        return detail::capture_backtrace_with<unw_backtrace>(frames, max_frames);
+    }
+
 #else  // SPARGEL_IS_LINUX
 
     void PrintBacktrace() { puts("<unknown backtrace>"); }
 
+#if __has_include(<execinfo.h>)
+    [[gnu::noinline]] usize capture_backtrace(void** frames, usize max_frames) {
+        return detail::capture_backtrace_with<backtrace>(frames, max_frames);
+    }
+#else
+    usize capture_backtrace(void**, usize) { return 0; }
+#endif
+
 #endif  // SPARGEL_IS_LINUX
 
 }  // namespace spargel::base
@@ -1,3 +1,5 @@
+#include "spargel/base/atomic.h"
+#include "spargel/base/backtrace.h"
 #include "spargel/base/platform.h"
 #include "spargel/base/types.h"
 
@@ -6,7 +8,9 @@
 #include <errno.h>
 #include <execinfo.h>
 #include <mach-o/dyld.h>
+#include <pthread.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 
 namespace spargel::base {
@@ -20,6 +24,36 @@ namespace spargel::base {
         return strlen(buf);
     }
 
+    u64 get_monotonic_time_ns() { return clock_gettime_nsec_np(CLOCK_UPTIME_RAW); }
+
+    u64 get_current_thread_id() {
+        u64 id = 0;
+        pthread_threadid_np(nullptr, &id);
+        return id;
+    }
+
+    // The primitives behind libc++'s `std::atomic::wait`. See <sys/ulock.h> in xnu.
+    extern "C" int __ulock_wait(uint32_t operation, void* addr, uint64_t value, uint32_t timeout);
+    extern "C" int __ulock_wake(uint32_t operation, void* addr, uint64_t wake_value);
+
+    namespace {
+        constexpr uint32_t UL_COMPARE_AND_WAIT = 1;
+        constexpr uint32_t ULF_WAKE_ALL = 0x00000100;
+        constexpr uint32_t ULF_NO_ERRNO = 0x01000000;
+    }  // namespace
+
+    void atomic_wait(u32* addr, u32 expected) {
+        __ulock_wait(UL_COMPARE_AND_WAIT | ULF_NO_ERRNO, addr, expected, 0);
+    }
+
+    void atomic_notify_one(u32* addr) {
+        __ulock_wake(UL_COMPARE_AND_WAIT | ULF_NO_ERRNO, addr, 0);
+    }
+
+    void atomic_notify_all(u32* addr) {
+        __ulock_wake(UL_COMPARE_AND_WAIT | ULF_WAKE_ALL | ULF_NO_ERRNO, addr, 0);
+    }
+
     namespace {
 
         void write_stderr(char const* buf, usize len) {
@@ -57,6 +91,10 @@ namespace spargel::base {
 #define MAX_STACK_TRACES 128
 #define MAX_SYMBOL_SIZE 255
 
+    [[gnu::noinline]] usize capture_backtrace(void** frames, usize max_frames) {
+        return detail::capture_backtrace_with<backtrace>(frames, max_frames);
+    }
+
     void PrintBacktrace() {
         void* entries[MAX_STACK_TRACES] = {};
         int count = backtrace(entries, MAX_STACK_TRACES);
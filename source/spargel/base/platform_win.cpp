@@ -1,3 +1,4 @@
+#include "spargel/base/atomic.h"
 #include "spargel/base/platform.h"
 
 //
@@ -6,6 +7,8 @@
 //
 #include <Windows.h>
 
+#pragma comment(lib, "Synchronization.lib")
+
 namespace spargel::base {
 
     struct dynamic_library_handle {};
@@ -24,6 +27,34 @@ namespace spargel::base {
         return GetModuleFileNameA(NULL, buf, buf_size);
     }
 
+    u64 get_monotonic_time_ns() {
+        static LARGE_INTEGER frequency = [] {
+            LARGE_INTEGER f;
+            QueryPerformanceFrequency(&f);
+            return f;
+        }();
+        LARGE_INTEGER counter;
+        QueryPerformanceCounter(&counter);
+        u64 ticks = static_cast<u64>(counter.QuadPart);
+        u64 freq = static_cast<u64>(frequency.QuadPart);
+        // Split to avoid overflowing 64 bits.
+        return ticks / freq * 1000000000 + ticks % freq * 1000000000 / freq;
+    }
+
+    u64 get_current_thread_id() { return GetCurrentThreadId(); }
+
+    void atomic_wait(u32* addr, u32 expected) { WaitOnAddress(addr, &expected, 4, INFINITE); }
+
+    void atomic_notify_one(u32* addr) { WakeByAddressSingle(addr); }
+
+    void atomic_notify_all(u32* addr) { WakeByAddressAll(addr); }
+
+    usize capture_backtrace(void** frames, usize max_frames) {
+        DWORD want = max_frames < 0xFFFF ? static_cast<DWORD>(max_frames) : 0xFFFF;
+        // Skip this frame.
+        return CaptureStackBackTrace(1, want, frames, nullptr);
+    }
+
     // TODO: Symbolize the traces.
     void PrintBacktrace() { 
         void* entries[64];
@@ -0,0 +1,358 @@
+#include "spargel/base/sampling_profiler.h"
+
+#include "spargel/base/allocator.h"
+#include "spargel/base/atomic.h"
+#include "spargel/base/backtrace.h"
+#include "spargel/config.h"
+
+// libc
+#include <stdio.h>
+#include <stdlib.h>
+
+#if SPARGEL_IS_POSIX
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/time.h>
+#include <time.h>
+#include <ucontext.h>
+#include <unistd.h>
+#endif
+
+#if SPARGEL_IS_MACOS
+#include <mach-o/dyld.h>
+#include <mach-o/loader.h>
+#include <string.h>
+#endif
+
+namespace spargel::base {
+
+#if SPARGEL_IS_POSIX
+
+    namespace {
+        // The deepest stack recorded. A slot is then 64 words.
+        constexpr usize max_depth = 62;
+        // Must be a power of two.
+        constexpr u64 slot_count = 4096;
+        // How often the drainer empties the ring.
+        constexpr u32 drain_interval_ms = 50;
+
+        struct Sample {
+            Atomic<u64> sequence;
+            u64 depth;
+            void* pcs[max_depth];
+        };
+
+        // A bounded multi-producer single-consumer ring (Vyukov). Producers are signal
+        // handlers on any thread; the consumer is the drainer, or `stop_sampling_profiler`
+        // after the drainer is gone.
+        //
+        // A slot is free for the producer at position `p` when its sequence is `p`, and ready
+        // for the consumer when it is `p + 1`.
+        struct SampleRing {
+            Sample slots[slot_count];
+            Atomic<u64> enqueue_position{0};
+            u64 dequeue_position = 0;
+        };
+
+        // Allocated by the first start and never freed, since a late signal may still write.
+        SampleRing* ring = nullptr;
+
+        Atomic<bool> sampling{false};
+        Atomic<bool> stop_drainer{false};
+        Atomic<u64> sample_count{0};
+        Atomic<u64> dropped_count{0};
+
+        // Owned by the thread that starts and stops the profiler.
+        bool running = false;
+        bool exit_hook_registered = false;
+        FILE* output = nullptr;
+        u32 period_us = 0;
+        pthread_t drainer;
+        struct sigaction previous_action;
+
+        // The address the signal interrupted, or null on unknown targets.
+        void* interrupted_pc(void* context) {
+            auto uc = static_cast<ucontext_t*>(context);
+#if SPARGEL_IS_MACOS && defined(__x86_64__)
+            return reinterpret_cast<void*>(uc->uc_mcontext->__ss.__rip);
+#elif SPARGEL_IS_MACOS && defined(__aarch64__)
+            return reinterpret_cast<void*>(
+                __darwin_arm_thread_state64_get_pc(uc->uc_mcontext->__ss));
+#elif defined(__x86_64__)
+            return reinterpret_cast<void*>(uc->uc_mcontext.gregs[REG_RIP]);
+#elif defined(__aarch64__)
+            return reinterpret_cast<void*>(uc->uc_mcontext.pc);
+#else
+            (void)uc;
+            return nullptr;
+#endif
+        }
+
+        void on_sigprof(int, siginfo_t*, void* context) {
+            int saved_errno = errno;
+            if (!sampling.load(MemoryOrder::relaxed)) {
+                errno = saved_errno;
+                return;
+            }
+
+            // Above the interrupted frame there are this handler and the signal trampoline.
+            void* frames[max_depth + 4];
+            usize count = capture_backtrace(frames, max_depth + 4);
+            void* pc = interrupted_pc(context);
+            usize first = count;
+            for (usize i = 0; i < count; i++) {
+                if (frames[i] == pc) {
+                    first = i;
+                    break;
+                }
+            }
+            // Without the interrupted frame in the stack, the callers cannot be told apart from
+            // the signal frames. Keep the leaf only.
+            if (first == count) {
+                frames[0] = pc;
+                first = 0;
+                count = pc != nullptr ? 1 : 0;
+            }
+            usize depth = count - first;
+            if (depth > max_depth) depth = max_depth;
+            if (depth == 0) {
+                errno = saved_errno;
+                return;
+            }
+
+            u64 position = ring->enqueue_position.load(MemoryOrder::relaxed);
+            Sample* s;
+            for (;;) {
+                s = &ring->slots[position & (slot_count - 1)];
+                u64 sequence = s->sequence.load(MemoryOrder::acquire);
+                auto diff = static_cast<i64>(sequence - position);
+                if (diff == 0) {
+                    if (ring->enqueue_position.compareExchangeWeak(
+                            position, position + 1, MemoryOrder::relaxed, MemoryOrder::relaxed)) {
+                        break;
+                    }
+                } else if (diff < 0) {
+                    dropped_count.fetchAdd(1, MemoryOrder::relaxed);
+                    errno = saved_errno;
+                    return;
+                } else {
+                    position = ring->enqueue_position.load(MemoryOrder::relaxed);
+                }
+            }
+            s->depth = depth;
+            for (usize i = 0; i < depth; i++) {
+                s->pcs[i] = frames[first + i];
+            }
+            s->sequence.store(position + 1, MemoryOrder::release);
+            sample_count.fetchAdd(1, MemoryOrder::relaxed);
+            errno = saved_errno;
+        }
+
+        // Write the samples in the ring to the file.
+        void drain() {
+            for (;;) {
+                u64 position = ring->dequeue_position;
+                Sample* s = &ring->slots[position & (slot_count - 1)];
+                if (s->sequence.load(MemoryOrder::acquire) != position + 1) return;
+                // A record is {count, depth, pc...}.
+                uintptr_t header[2] = {1, static_cast<uintptr_t>(s->depth)};
+                fwrite(header, sizeof(header), 1, output);
+                fwrite(s->pcs, sizeof(void*), s->depth, output);
+                s->sequence.store(position + slot_count, MemoryOrder::release);
+                ring->dequeue_position = position + 1;
+            }
+        }
+
+        // Free the slots left from the last run without writing them. A handler that passed the
+        // `sampling` check before the stop may publish, or still be writing, after the last
+        // drain; wait for it rather than let its sample reach the next profile.
+        void discard_pending() {
+            u64 end = ring->enqueue_position.load(MemoryOrder::acquire);
+            while (ring->dequeue_position != end) {
+                u64 position = ring->dequeue_position;
+                Sample* s = &ring->slots[position & (slot_count - 1)];
+                if (s->sequence.load(MemoryOrder::acquire) != position + 1) {
+                    cpu_relax();
+                    continue;
+                }
+                s->sequence.store(position + slot_count, MemoryOrder::release);
+                ring->dequeue_position = position + 1;
+            }
+        }
+
+        void* drainer_main(void*) {
+            // The drainer only sleeps and writes. Leave the samples to the threads doing work.
+            sigset_t set;
+            sigemptyset(&set);
+            sigaddset(&set, SIGPROF);
+            pthread_sigmask(SIG_BLOCK, &set, nullptr);
+            while (!stop_drainer.load(MemoryOrder::acquire)) {
+                timespec ts{0, static_cast<long>(drain_interval_ms) * 1000000};
+                nanosleep(&ts, nullptr);
+                drain();
+            }
+            return nullptr;
+        }
+
+        // pprof finds the binaries and their load addresses in this text, in the format of
+        // `/proc/self/maps`.
+        void write_memory_map() {
+#if SPARGEL_IS_MACOS
+            u32 count = _dyld_image_count();
+            for (u32 i = 0; i < count; i++) {
+                auto header = reinterpret_cast<mach_header_64 const*>(_dyld_get_image_header(i));
+                if (header == nullptr || header->magic != MH_MAGIC_64) continue;
+                intptr_t slide = _dyld_get_image_vmaddr_slide(i);
+                auto command = reinterpret_cast<load_command const*>(header + 1);
+                for (u32 j = 0; j < header->ncmds; j++) {
+                    if (command->cmd == LC_SEGMENT_64) {
+                        auto segment = reinterpret_cast<segment_command_64 const*>(command);
+                        if (strcmp(segment->segname, "__TEXT") == 0) {
+                            u64 start = segment->vmaddr + static_cast<u64>(slide);
+                            fprintf(output, "%llx-%llx r-xp %llx 00:00 0 %s\n",
+                                    static_cast<unsigned long long>(start),
+                                    static_cast<unsigned long long>(start + segment->vmsize),
+                                    static_cast<unsigned long long>(segment->fileoff),
+                                    _dyld_get_image_name(i));
+                        }
+                    }
+                    command = reinterpret_cast<load_command const*>(
+                        reinterpret_cast<u8 const*>(command) + command->cmdsize);
+                }
+            }
+#else
+            int fd = open("/proc/self/maps", O_RDONLY);
+            if (fd < 0) return;
+            char buf[4096];
+            for (;;) {
+                ssize_t n = read(fd, buf, sizeof(buf));
+                if (n <= 0) break;
+                fwrite(buf, 1, static_cast<usize>(n), output);
+            }
+            close(fd);
+#endif
+        }
+
+        void set_timer(u32 interval_us) {
+            itimerval timer{};
+            timer.it_interval.tv_sec = interval_us / 1000000;
+            timer.it_interval.tv_usec = interval_us % 1000000;
+            timer.it_value = timer.it_interval;
+            setitimer(ITIMER_PROF, &timer, nullptr);
+        }
+    }  // namespace
+
+    bool start_sampling_profiler(char const* path, u32 frequency_hz) {
+        if (running || frequency_hz == 0) return false;
+
+        if (ring == nullptr) {
+            ring = static_cast<SampleRing*>(default_allocator()->allocate(sizeof(SampleRing)));
+            for (u64 i = 0; i < slot_count; i++) {
+                ring->slots[i].sequence.store(i, MemoryOrder::relaxed);
+            }
+            ring->enqueue_position.store(0, MemoryOrder::relaxed);
+            ring->dequeue_position = 0;
+        } else {
+            discard_pending();
+        }
+
+        output = fopen(path, "wb");
+        if (output == nullptr) return false;
+        period_us = 1000000 / frequency_hz;
+        if (period_us == 0) period_us = 1;
+        // The header: {header words, version, sampling period in microseconds, padding}.
+        uintptr_t header[5] = {0, 3, 0, static_cast<uintptr_t>(period_us), 0};
+        fwrite(header, sizeof(header), 1, output);
+
+        // Load the unwinder now; it is not safe to do so in the handler.
+        void* frames[4];
+        capture_backtrace(frames, 4);
+
+        sample_count.store(0, MemoryOrder::relaxed);
+        dropped_count.store(0, MemoryOrder::relaxed);
+        stop_drainer.store(false, MemoryOrder::relaxed);
+        if (pthread_create(&drainer, nullptr, drainer_main, nullptr) != 0) {
+            fclose(output);
+            output = nullptr;
+            return false;
+        }
+
+        struct sigaction action{};
+        action.sa_sigaction = on_sigprof;
+        action.sa_flags = SA_SIGINFO | SA_RESTART;
+        sigemptyset(&action.sa_mask);
+        sigaction(SIGPROF, &action, &previous_action);
+        sampling.store(true, MemoryOrder::release);
+        set_timer(period_us);
+
+        running = true;
+        if (!exit_hook_registered) {
+            atexit(stop_sampling_profiler);
+            exit_hook_registered = true;
+        }
+        return true;
+    }
+
+    void stop_sampling_profiler() {
+        if (!running) return;
+        running = false;
+
+        set_timer(0);
+        sampling.store(false, MemoryOrder::release);
+        // A signal still in flight would terminate the process under the default action.
+        if (previous_action.sa_handler == SIG_DFL) {
+            signal(SIGPROF, SIG_IGN);
+        } else {
+            sigaction(SIGPROF, &previous_action, nullptr);
+        }
+
+        stop_drainer.store(true, MemoryOrder::release);
+        pthread_join(drainer, nullptr);
+        drain();
+
+        // The trailer: a record of count 0 and depth 1.
+        uintptr_t trailer[3] = {0, 1, 0};
+        fwrite(trailer, sizeof(trailer), 1, output);
+        write_memory_map();
+        fclose(output);
+        output = nullptr;
+    }
+
+#else
+
+    bool start_sampling_profiler(char const*, u32) { return false; }
+
+    void stop_sampling_profiler() {}
+
+    namespace {
+        Atomic<u64> sample_count{0};
+        Atomic<u64> dropped_count{0};
+    }  // namespace
+
+#endif
+
+    SamplingProfilerStats sampling_profiler_stats() {
+        SamplingProfilerStats stats;
+        stats.samples = sample_count.load(MemoryOrder::relaxed);
+        stats.dropped = dropped_count.load(MemoryOrder::relaxed);
+        return stats;
+    }
+
+    bool start_sampling_profiler_from_env() {
+        char const* path = getenv("SPARGEL_SAMPLING_PROFILE");
+        if (path == nullptr || path[0] == '\0') return false;
+        u32 hz = 100;
+        if (char const* value = getenv("SPARGEL_SAMPLING_PROFILE_HZ")) {
+            long n = strtol(value, nullptr, 10);
+            if (n > 0 && n <= 10000) hz = static_cast<u32>(n);
+        }
+        bool started = start_sampling_profiler(path, hz);
+        if (!started) {
+            fprintf(stderr, "cannot start the sampling profiler: %s\n", path);
+        }
+        return started;
+    }
+
+}  // namespace spargel::base
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "spargel/base/types.h"
+
+namespace spargel::base {
+
+    // Sampling Profiler
+    //
+    // Interrupts the process `frequency_hz` times per second of CPU time with `SIGPROF`, and
+    // records the stack of the interrupted thread. Unlike trace regions, this needs no
+    // instrumentation and no special build, so it works on any binary.
+    //
+    // The output is a gperftools CPU profile, with the memory map of the process appended.
+    // Symbolize it offline:
+    //
+    //     pprof --flame <binary> <path>
+    //     scripts/fold_profile.py <path> > folded.txt    (for flamegraph.pl or speedscope)
+    //
+    // Note:
+    //     - POSIX only. Elsewhere `start_sampling_profiler` returns false.
+    //     - Stacks are captured with `capture_backtrace`, so a build with frame pointers or
+    //       unwind tables walks deeper.
+    //     - The timer counts CPU time of the whole process; the signal goes to a thread that is
+    //       running. Threads that block are not sampled.
+    //     - Samples go to a fixed lock-free ring that a background thread drains to the file.
+    //       When the ring is full, samples are dropped and counted.
+    //     - The profile is complete only after `stop_sampling_profiler`, which also runs at exit.
+    //
+
+    struct SamplingProfilerStats {
+        u64 samples = 0;
+        u64 dropped = 0;
+    };
+
+    // Return false if the profiler is already running, the file cannot be created, or the
+    // platform has no `SIGPROF`.
+    bool start_sampling_profiler(char const* path, u32 frequency_hz = 100);
+
+    // Stop sampling and finish the file. Does nothing if the profiler is not running.
+    void stop_sampling_profiler();
+
+    // Of the current or the last run.
+    SamplingProfilerStats sampling_profiler_stats();
+
+    // Start the profiler if the environment asks for it:
+    //
+    //     SPARGEL_SAMPLING_PROFILE=<path>    the output file
+    //     SPARGEL_SAMPLING_PROFILE_HZ=<n>    the sampling frequency, 100 by default
+    //
+    // Return whether the profiler was started.
+    bool start_sampling_profiler_from_env();
+
+}  // namespace spargel::base
@@ -0,0 +1,92 @@
+#include "spargel/base/sampling_profiler.h"
+
+#include "spargel/base/backtrace.h"
+#include "spargel/base/benchmark.h"
+#include "spargel/base/check.h"
+#include "spargel/base/test.h"
+
+#if SPARGEL_IS_POSIX
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+namespace spargel::base {
+    namespace {
+#if SPARGEL_IS_POSIX
+        u64 cpu_time_ns() {
+            timespec ts;
+            clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+            return static_cast<u64>(ts.tv_sec) * 1000000000 + static_cast<u64>(ts.tv_nsec);
+        }
+
+        void burn_cpu(u64 ns) {
+            u64 end = cpu_time_ns() + ns;
+            u64 x = 0;
+            while (cpu_time_ns() < end) {
+                for (int i = 0; i < 1000; i++) {
+                    x = x * 6364136223846793005ull + 1442695040888963407ull;
+                }
+                do_not_optimize(x);
+            }
+        }
+
+        // Check the header of the profile at `path`, and return how many samples it holds.
+        u64 read_profile(char const* path) {
+            FILE* file = fopen(path, "rb");
+            spargel_check(file != nullptr);
+            uintptr_t header[5] = {};
+            spargel_check(fread(header, sizeof(header), 1, file) == 1);
+            spargel_check(header[0] == 0 && header[1] == 3 && header[3] == 1000);
+            u64 samples = 0;
+            for (;;) {
+                // {count, depth, pc...}, up to the trailer of count 0.
+                uintptr_t record[2] = {};
+                spargel_check(fread(record, sizeof(record), 1, file) == 1);
+                spargel_check(record[1] > 0);
+                if (record[0] == 0) break;
+                samples += record[0];
+                spargel_check(fseek(file, static_cast<long>(record[1] * sizeof(void*)),
+                                    SEEK_CUR) == 0);
+            }
+            fclose(file);
+            unlink(path);
+            return samples;
+        }
+
+        TEST(SamplingProfiler_Profile) {
+            char const* path = "sampling_profiler_test.prof";
+            spargel_check(start_sampling_profiler(path, 1000));
+            // Already running.
+            spargel_check(!start_sampling_profiler(path, 1000));
+            burn_cpu(100000000);
+            stop_sampling_profiler();
+            // Stopping twice is fine.
+            stop_sampling_profiler();
+
+            SamplingProfilerStats stats = sampling_profiler_stats();
+            spargel_check(stats.samples > 0);
+            // A sample counted by a handler still running at the stop may miss the file.
+            u64 written = read_profile(path);
+            spargel_check(written > 0 && written <= stats.samples);
+
+            // A second run reuses the ring, and writes only its own samples.
+            spargel_check(start_sampling_profiler(path, 1000));
+            burn_cpu(20000000);
+            stop_sampling_profiler();
+            spargel_check(read_profile(path) <= sampling_profiler_stats().samples);
+        }
+#endif
+
+        TEST(SamplingProfiler_CaptureBacktrace) {
+            void* frames[16];
+            usize count = capture_backtrace(frames, 16);
+            spargel_check(count <= 16);
+#if SPARGEL_IS_LINUX || SPARGEL_IS_MACOS
+            spargel_check(count > 0);
+#endif
+            // Truncated to the room given.
+            spargel_check(capture_backtrace(frames, 1) <= 1);
+        }
+    }  // namespace
+}  // namespace spargel::base
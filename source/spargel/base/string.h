@@ -128,6 +128,10 @@ namespace spargel::base {
 
         /// A UTF-8 string.
         ///
+        /// Strings of at most `inline_capacity` bytes are stored inline without allocation.
+        /// Longer strings live on the heap, and grow geometrically when appended to.
+        /// The bytes are not null-terminated, see `CString`.
+        ///
         ///-------
         /// UTF-8
         ///
@@ -138,73 +142,63 @@ namespace spargel::base {
         ///
         class String {
         public:
+            static constexpr usize inline_capacity = 16;
+
             static String from_range(char const* begin, char const* end) {
                 spargel_check(begin <= end);
-                usize len = static_cast<usize>(end - begin);
-                String result;
-                result._bytes.reserve(len);
-                result._bytes.set_count(len);
-                memcpy(result._bytes.data(), begin, len);
-                return result;
+                return String(StringView(begin, end));
             }
 
             String() {}
 
-            String(String const& other) : _bytes(other._bytes) {}
+            String(String const& other) : String(other.view()) {}
             String& operator=(String const& other) {
                 String tmp(other);
                 swap(*this, tmp);
                 return *this;
             }
 
-            String(String&& other) : _bytes(base::move(other._bytes)) {}
+            String(String&& other) { stealFrom(other); }
             String& operator=(String&& other) {
                 String tmp(base::move(other));
                 swap(*this, tmp);
                 return *this;
             }
 
-            ~String() = default;
+            ~String() { freeHeap(); }
 
             // migration from base::String
-            explicit String(StringView view) {
-                usize len = view.length();
-                _bytes.reserve(len);
-                _bytes.set_count(len);
-                memcpy(_bytes.data(), view.data(), len);
-            }
-            /*explicit*/ String(char const* cstr) {
-                usize len = strlen(cstr);
-                _bytes.reserve(len);
-                _bytes.set_count(len);
-                memcpy(_bytes.data(), cstr, len);
-            }
+            explicit String(StringView view) { assign(view.data(), view.length()); }
+            /*explicit*/ String(char const* cstr) { assign(cstr, strlen(cstr)); }
             String& operator=(char const* cstr) {
                 String tmp(cstr);
                 swap(*this, tmp);
                 return *this;
             }
-            explicit String(char ch) {
-                _bytes.reserve(1);
-                _bytes.set_count(1);
-                _bytes.data()[0] = ch;
-            }
+            explicit String(char ch) { assign(&ch, 1); }
             String& operator=(char ch) {
                 String tmp(ch);
                 swap(*this, tmp);
                 return *this;
             }
 
-            char& operator[](usize i) { return _bytes[i]; }
-            char const& operator[](usize i) const { return _bytes[i]; }
+            char& operator[](usize i) {
+                spargel_check(i < _length);
+                return _data[i];
+            }
+            char const& operator[](usize i) const {
+                spargel_check(i < _length);
+                return _data[i];
+            }
 
-            usize length() const { return _bytes.count(); }
-            char* begin() { return _bytes.begin(); }
-            char const* begin() const { return _bytes.begin(); }
-            char* end() { return _bytes.end(); }
-            char const* end() const { return _bytes.end(); }
-            char* data() { return _bytes.data(); }
-            char const* data() const { return _bytes.data(); }
+            usize length() const { return _length; }
+            usize capacity() const { return isInline() ? inline_capacity : _capacity; }
+            char* begin() { return _data; }
+            char const* begin() const { return _data; }
+            char* end() { return _data + _length; }
+            char const* end() const { return _data + _length; }
+            char* data() { return _data; }
+            char const* data() const { return _data; }
             StringView view() const { return StringView(begin(), end()); }
 
             friend bool operator==(String const& lhs, String const& rhs) {
@@ -216,46 +210,45 @@ namespace spargel::base {
                 return memcmp(lhs.data(), rhs.data(), lhs.length()) == 0;
             }
             friend String operator+(String const& lhs, String const& rhs) {
-                usize len = lhs.length() + rhs.length();
-                String result;
-                result._bytes.reserve(len);
-                result._bytes.set_count(len);
-                memcpy(result._bytes.data(), lhs.data(), lhs.length());
-                memcpy(result._bytes.data() + lhs.length(), rhs.data(), rhs.length());
-                return result;
+                return concat2(lhs.view(), rhs.view());
+            }
+            friend String operator+(String const& s, char ch) {
+                return concat2(s.view(), StringView(&ch, 1));
+            }
+            friend String operator+(String const& s, char const* s2) {
+                return concat2(s.view(), StringView(s2));
+            }
+            friend String operator+(String const& lhs, StringView rhs) {
+                return concat2(lhs.view(), rhs);
             }
-            // not efficient
-            friend String operator+(String const& s, char ch) { return s + String(ch); }
-            friend String operator+(String const& s, char const* s2) { return s + String(s2); }
 
             String& operator+=(StringView view) {
-                _bytes.reserve(length() + view.length());
-                memcpy(_bytes.data() + length(), view.data(), view.length());
+                append(view.data(), view.length());
                 return *this;
             }
 
-            friend String operator+(String const& lhs, StringView rhs) {
-                usize len = lhs.length() + rhs.length();
-                String result;
-                result._bytes.reserve(len);
-                result._bytes.set_count(len);
-                memcpy(result._bytes.data(), lhs.data(), lhs.length());
-                memcpy(result._bytes.data() + lhs.length(), rhs.data(), rhs.length());
-                return result;
+            // Ensure that `n` bytes fit without reallocation.
+            void reserve(usize n) {
+                if (n > capacity()) grow(n);
             }
 
             /// Get the `i`-th byte.
-            Byte getByte(usize i) const { return (Byte)_bytes[i]; }
+            Byte getByte(usize i) const { return (Byte)(*this)[i]; }
 
-            span<Byte> bytes() const { return _bytes.toSpan().asBytes(); }
+            span<Byte> bytes() const { return span<char>(begin(), end()).asBytes(); }
 
-            void resize(usize n) { _bytes.resize(n); }
+            // New bytes are zero.
+            void resize(usize n) {
+                reserve(n);
+                if (n > _length) memset(_data + _length, 0, n - _length);
+                _length = n;
+            }
 
             usize getLength() const {
                 usize len = 0;
                 usize i = 0;
                 while (i < length()) {
-                    Byte byte = bitCast<char, Byte>(_bytes[i]);
+                    Byte byte = bitCast<char, Byte>(_data[i]);
                     if ((byte & 0b10000000) == 0) {
                         i += 1;
                     } else if ((byte & 0b11100000) == 0b11000000) {
@@ -279,18 +272,87 @@ namespace spargel::base {
             // }
 
             // unsafe
-            void appendByte(Byte b) { _bytes.emplace((char)b); }
+            void appendByte(Byte b) {
+                if (_length == capacity()) [[unlikely]] {
+                    grow(_length + 1);
+                }
+                _data[_length++] = (char)b;
+            }
 
             friend void tag_invoke(tag<swap>, String& lhs, String& rhs) {
-                swap(lhs._bytes, rhs._bytes);
+                String tmp;
+                tmp.stealFrom(lhs);
+                lhs.stealFrom(rhs);
+                rhs.stealFrom(tmp);
             }
 
             friend void tag_invoke(tag<hash>, HashRun& r, String const& s) {
-                r.combine((u8 const*)s._bytes.data(), s.length());
+                r.combine((u8 const*)s.data(), s.length());
             }
 
         private:
-            vector<char> _bytes;
+            static String concat2(StringView a, StringView b) {
+                String result;
+                result.reserve(a.length() + b.length());
+                result.append(a.data(), a.length());
+                result.append(b.data(), b.length());
+                return result;
+            }
+
+            bool isInline() const { return _data == _inline; }
+
+            // requires: `*this` is empty
+            void assign(char const* p, usize n) {
+                reserve(n);
+                if (n > 0) memcpy(_data, p, n);
+                _length = n;
+            }
+
+            void append(char const* p, usize n) {
+                if (_length + n > capacity()) {
+                    grow(_length + n);
+                }
+                if (n > 0) memcpy(_data + _length, p, n);
+                _length += n;
+            }
+
+            void grow(usize need) {
+                usize cap = capacity() * 2;
+                if (cap < need) cap = need;
+                auto p = static_cast<char*>(tagged_allocator(AllocationTag::string)->allocate(cap));
+                if (_length > 0) memcpy(p, _data, _length);
+                freeHeap();
+                _data = p;
+                _capacity = cap;
+            }
+
+            void freeHeap() {
+                if (!isInline()) tagged_allocator(AllocationTag::string)->free(_data, _capacity);
+            }
+
+            // Take the contents of `other` and leave it empty.
+            // requires: `*this` owns no heap storage
+            void stealFrom(String& other) {
+                _length = other._length;
+                if (other.isInline()) {
+                    _data = _inline;
+                    memcpy(_inline, other._inline, inline_capacity);
+                } else {
+                    _data = other._data;
+                    _capacity = other._capacity;
+                    other._data = other._inline;
+                }
+                other._length = 0;
+            }
+
+            // Points to `_inline` for inline strings.
+            char* _data = _inline;
+            usize _length = 0;
+            union {
+                // Heap strings only.
+                usize _capacity;
+                char _inline[inline_capacity] = {};
+            };
         };
 
         class CString {
@@ -298,13 +360,14 @@ namespace spargel::base {
             CString(char const* beg, char const* end) {
                 spargel_check(beg <= end);
                 len_ = static_cast<usize>(end - beg);
-                data_ = reinterpret_cast<char*>(default_allocator()->allocate(len_ + 1));
+                auto alloc = tagged_allocator(AllocationTag::string);
+                data_ = reinterpret_cast<char*>(alloc->allocate(len_ + 1));
                 ::memcpy(data_, beg, len_);
                 data_[len_] = 0;
             }
             CString(StringView view) : CString(view.begin(), view.end()) {}
             CString(const String& s) : CString(s.begin(), s.end()) {}
-            ~CString() { default_allocator()->free(data_, len_ + 1); }
+            ~CString() { tagged_allocator(AllocationTag::string)->free(data_, len_ + 1); }
 
             auto data() const -> char const* { return data_; }
 
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "spargel/base/format.h"
+#include "spargel/base/string.h"
+#include "spargel/base/string_view.h"
+#include "spargel/base/types.h"
+
+namespace spargel::base {
+
+    // StringBuilder
+    //
+    // Builds a `String` piece by piece. The buffer grows geometrically, so appending `n` pieces
+    // costs O(total length) instead of the O(n * total length) of a chain of `String + String`.
+    //
+    // Example:
+    //
+    //     StringBuilder builder;
+    //     builder.append("line "_sv);
+    //     builder.appendFormat("{}: {}", line, message);
+    //     String s = builder.build();
+    //
+    class StringBuilder {
+    public:
+        StringBuilder() = default;
+        explicit StringBuilder(usize capacity) { reserve(capacity); }
+
+        // Ensure that a total of `n` bytes fit without reallocation.
+        void reserve(usize n) { _buffer.reserve(n); }
+
+        StringBuilder& append(StringView s) {
+            _buffer += s;
+            return *this;
+        }
+        StringBuilder& append(char c) {
+            _buffer.appendByte(static_cast<Byte>(c));
+            return *this;
+        }
+        StringBuilder& append(String const& s) { return append(s.view()); }
+        StringBuilder& append(char const* s) { return append(StringView(s)); }
+
+        template <typename... Args>
+        StringBuilder& appendFormat(detail::FormatString fmt, Args&&... args) {
+            formatTo(*this, fmt, base::forward<Args>(args)...);
+            return *this;
+        }
+
+        usize length() const { return _buffer.length(); }
+        StringView view() const { return _buffer.view(); }
+
+        void clear() { _buffer = String(); }
+
+        // Take the built string. The builder is left empty.
+        String build() { return base::move(_buffer); }
+
+    private:
+        String _buffer;
+    };
+
+    namespace detail {
+        inline usize concatLength(StringView s) { return s.length(); }
+        inline usize concatLength(String const& s) { return s.length(); }
+        inline usize concatLength(char const* s) { return strlen(s); }
+        inline usize concatLength(char) { return 1; }
+
+        inline void concatAppend(String& out, StringView s) { out += s; }
+        inline void concatAppend(String& out, String const& s) { out += s.view(); }
+        inline void concatAppend(String& out, char const* s) { out += StringView(s); }
+        inline void concatAppend(String& out, char c) { out.appendByte(static_cast<Byte>(c)); }
+    }  // namespace detail
+
+    // Concatenate strings, string views, C strings and characters with a single allocation.
+    //
+    // Example:
+    //
+    //     concat("cannot find member '", name, '\'')
+    //
+    template <typename... Args>
+    String concat(Args const&... args) {
+        String result;
+        result.reserve((detail::concatLength(args) + ... + 0));
+        (detail::concatAppend(result, args), ...);
+        return result;
+    }
+
+    // Format into a new string. See `formatTo`.
+    template <typename... Args>
+    String format(detail::FormatString fmt, Args&&... args) {
+        StringBuilder builder;
+        formatTo(builder, fmt, base::forward<Args>(args)...);
+        return builder.build();
+    }
+
+}  // namespace spargel::base
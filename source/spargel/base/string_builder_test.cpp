@@ -0,0 +1,64 @@
+#include "spargel/base/string_builder.h"
+
+#include "spargel/base/check.h"
+#include "spargel/base/test.h"
+
+namespace spargel::base {
+    namespace {
+        using namespace literals;
+
+        TEST(StringBuilder_Basic) {
+            StringBuilder builder;
+            builder.append("abc"_sv).append('d').append(String("ef"));
+            spargel_check(builder.length() == 6);
+            spargel_check(builder.view() == "abcdef"_sv);
+
+            String s = builder.build();
+            spargel_check(s == "abcdef"_sv);
+            spargel_check(builder.length() == 0);
+        }
+
+        TEST(StringBuilder_Grow) {
+            StringBuilder builder(4);
+            for (int i = 0; i < 1000; i++) {
+                builder.append("0123456789"_sv);
+            }
+            spargel_check(builder.length() == 10000);
+            auto v = builder.view();
+            for (usize i = 0; i < v.length(); i++) {
+                spargel_check(v[i] == (char)('0' + i % 10));
+            }
+        }
+
+        TEST(String_Concat) {
+            String name{"a member name that is long"_sv};
+            auto s = concat("cannot find member '", name, '\'');
+            spargel_check(s == "cannot find member 'a member name that is long'"_sv);
+            spargel_check(s.capacity() == s.length());
+
+            spargel_check(concat() == ""_sv);
+            spargel_check(concat('x', "y"_sv) == "xy"_sv);
+        }
+
+        TEST(Format_Basic) {
+            spargel_check(format("") == ""_sv);
+            spargel_check(format("abc") == "abc"_sv);
+            spargel_check(format("{}", 42) == "42"_sv);
+            spargel_check(format("{} + {} = {}", -1, 2u, (i64)1) == "-1 + 2 = 1"_sv);
+            spargel_check(format("{{{}}}", "x") == "{x}"_sv);
+            spargel_check(format("{}{}", true, 'c') == "truec"_sv);
+            spargel_check(format("[{}]", String("s")) == "[s]"_sv);
+            spargel_check(format("{}", (i64)(-9223372036854775807 - 1)) ==
+                          "-9223372036854775808"_sv);
+            spargel_check(format("{}", (u64)18446744073709551615u) == "18446744073709551615"_sv);
+        }
+
+        TEST(Format_Builder) {
+            StringBuilder builder;
+            builder.append("line ");
+            builder.appendFormat("{}: {}", 7, "unexpected end"_sv);
+            spargel_check(builder.view() == "line 7: unexpected end"_sv);
+        }
+
+    }  // namespace
+}  // namespace spargel::base
@@ -0,0 +1,65 @@
+#include "spargel/base/string_interner.h"
+
+#include "spargel/base/check.h"
+
+// libc
+#include <string.h>
+
+namespace spargel::base {
+
+    StringInterner::StringInterner() {
+        auto page = static_cast<StringView*>(_arena.allocate(sizeof(StringView) * page_size));
+        page[0] = StringView();
+        _pages[0].store(page, MemoryOrder::release);
+        _count.store(1, MemoryOrder::relaxed);
+    }
+
+    StringInterner::~StringInterner() = default;
+
+    Symbol StringInterner::intern(StringView s) {
+        if (s.length() == 0) return Symbol();
+
+        LockGuard guard(_lock);
+
+        if (u32 const* id = _ids.get(s)) return Symbol(*id);
+
+        u32 id = _count.load(MemoryOrder::relaxed);
+        u32 page_index = id >> page_shift;
+        spargel_check(page_index < max_pages);
+
+        StringView* page = _pages[page_index].load(MemoryOrder::relaxed);
+        if (page == nullptr) {
+            page = static_cast<StringView*>(_arena.allocate(sizeof(StringView) * page_size));
+            _pages[page_index].store(page, MemoryOrder::release);
+        }
+
+        auto bytes = static_cast<char*>(_arena.allocate(s.length()));
+        memcpy(bytes, s.data(), s.length());
+        StringView stored(bytes, s.length());
+
+        page[id & (page_size - 1)] = stored;
+        _ids.set(stored, id);
+        _count.store(id + 1, MemoryOrder::release);
+        return Symbol(id);
+    }
+
+    bool StringInterner::find(StringView s, Symbol& out) {
+        if (s.length() == 0) {
+            out = Symbol();
+            return true;
+        }
+
+        LockGuard guard(_lock);
+
+        u32 const* id = _ids.get(s);
+        if (id == nullptr) return false;
+        out = Symbol(*id);
+        return true;
+    }
+
+    StringInterner* default_interner() {
+        static StringInterner interner;
+        return &interner;
+    }
+
+}  // namespace spargel::base
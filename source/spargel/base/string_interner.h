@@ -0,0 +1,87 @@
+#pragma once
+
+#include "spargel/base/arena_allocator.h"
+#include "spargel/base/atomic.h"
+#include "spargel/base/hash_map.h"
+#include "spargel/base/string_view.h"
+#include "spargel/base/types.h"
+
+namespace spargel::base {
+
+    // Symbol
+    //
+    // A handle to an interned string. Two symbols from the same interner are equal if and only
+    // if their strings are equal, so comparing and hashing a symbol never touches the bytes.
+    //
+    // The default symbol is the empty string.
+    //
+    class Symbol {
+    public:
+        static constexpr bool trivially_hashable = true;
+
+        constexpr Symbol() = default;
+        constexpr explicit Symbol(u32 id) : _id{id} {}
+
+        constexpr u32 getId() const { return _id; }
+        constexpr bool isEmpty() const { return _id == 0; }
+
+        friend constexpr bool operator==(Symbol lhs, Symbol rhs) { return lhs._id == rhs._id; }
+
+    private:
+        u32 _id = 0;
+    };
+
+    // StringInterner
+    //
+    // Maps strings to `Symbol`s. Symbols are handed out densely, starting from 1.
+    //
+    // Note:
+    //     - `intern` and `find` take a lock, which sleeps under contention since interning a new
+    //       string may grow the table. `lookup` is lock-free.
+    //     - The bytes of every interned string are copied once, and stay valid (and at the same
+    //       address) until the interner is destroyed.
+    //
+    class StringInterner {
+    public:
+        StringInterner();
+        ~StringInterner();
+
+        StringInterner(StringInterner const&) = delete;
+        StringInterner& operator=(StringInterner const&) = delete;
+
+        Symbol intern(StringView s);
+
+        // Return `false` if `s` has not been interned.
+        bool find(StringView s, Symbol& out);
+
+        // The symbol must come from this interner.
+        StringView lookup(Symbol sym) const {
+            u32 id = sym.getId();
+            StringView const* page = _pages[id >> page_shift].load(MemoryOrder::acquire);
+            spargel_check(page != nullptr);
+            return page[id & (page_size - 1)];
+        }
+
+        // The number of symbols, including the empty one.
+        u32 count() const { return _count.load(MemoryOrder::acquire); }
+
+    private:
+        static constexpr u32 page_shift = 10;
+        static constexpr u32 page_size = 1u << page_shift;
+        static constexpr u32 max_pages = 4096;
+
+        Mutex _lock;
+        Atomic<u32> _count{0};
+        // The bytes and the pages.
+        ArenaAllocator _arena;
+        HashMap<StringView, u32> _ids;
+        // id -> string, so that `lookup` never takes the lock.
+        Atomic<StringView*> _pages[max_pages];
+    };
+
+    // The interner shared by the whole process.
+    StringInterner* default_interner();
+
+    inline Symbol intern(StringView s) { return default_interner()->intern(s); }
+
+}  // namespace spargel::base
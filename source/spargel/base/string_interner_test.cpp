@@ -0,0 +1,112 @@
+#include "spargel/base/string_interner.h"
+
+#include "spargel/base/check.h"
+#include "spargel/base/hash.h"
+#include "spargel/base/string.h"
+#include "spargel/base/test.h"
+
+// libc
+#include <pthread.h>
+#include <stdio.h>
+
+namespace spargel::base {
+    namespace {
+        using namespace literals;
+
+        TEST(StringInterner_Basic) {
+            StringInterner interner;
+            spargel_check(interner.count() == 1);
+
+            auto a = interner.intern("hello"_sv);
+            auto b = interner.intern("world"_sv);
+            spargel_check(a != b);
+            spargel_check(interner.count() == 3);
+
+            // The bytes are copied.
+            String s{"hello"_sv};
+            spargel_check(interner.intern(s.view()) == a);
+            spargel_check(interner.lookup(a).data() != s.data());
+            spargel_check(interner.lookup(a) == "hello"_sv);
+            spargel_check(interner.lookup(b) == "world"_sv);
+            spargel_check(hash(a) == hash(interner.intern("hello"_sv)));
+        }
+
+        TEST(StringInterner_Empty) {
+            StringInterner interner;
+            auto e = interner.intern(""_sv);
+            spargel_check(e.isEmpty());
+            spargel_check(e == Symbol());
+            spargel_check(interner.lookup(e).length() == 0);
+        }
+
+        TEST(StringInterner_Find) {
+            StringInterner interner;
+            Symbol sym;
+            spargel_check(!interner.find("key"_sv, sym));
+            auto k = interner.intern("key"_sv);
+            spargel_check(interner.find("key"_sv, sym));
+            spargel_check(sym == k);
+        }
+
+        TEST(StringInterner_Many) {
+            StringInterner interner;
+            char buf[16];
+            for (u32 i = 0; i < 5000; i++) {
+                usize n = (usize)snprintf(buf, sizeof(buf), "s%u", i);
+                auto sym = interner.intern(StringView(buf, n));
+                spargel_check(sym.getId() == i + 1);
+            }
+            for (u32 i = 0; i < 5000; i++) {
+                usize n = (usize)snprintf(buf, sizeof(buf), "s%u", i);
+                auto sym = Symbol(i + 1);
+                spargel_check(interner.lookup(sym) == StringView(buf, n));
+                spargel_check(interner.intern(StringView(buf, n)) == sym);
+            }
+        }
+
+        struct ConcurrentIntern {
+            StringInterner* interner;
+            Symbol symbols[2000];
+        };
+
+        void* intern_all(void* arg) {
+            auto state = static_cast<ConcurrentIntern*>(arg);
+            char buf[16];
+            for (u32 i = 0; i < 2000; i++) {
+                usize n = (usize)snprintf(buf, sizeof(buf), "s%u", i);
+                state->symbols[i] = state->interner->intern(StringView(buf, n));
+            }
+            return nullptr;
+        }
+
+        // The table grows while other threads intern the same strings.
+        TEST(StringInterner_Concurrent) {
+            StringInterner interner;
+            ConcurrentIntern states[4];
+            pthread_t threads[4];
+            for (int i = 0; i < 4; i++) {
+                states[i].interner = &interner;
+                pthread_create(&threads[i], nullptr, intern_all, &states[i]);
+            }
+            for (int i = 0; i < 4; i++) {
+                pthread_join(threads[i], nullptr);
+            }
+            spargel_check(interner.count() == 2001);
+            char buf[16];
+            for (u32 i = 0; i < 2000; i++) {
+                usize n = (usize)snprintf(buf, sizeof(buf), "s%u", i);
+                spargel_check(interner.lookup(states[0].symbols[i]) == StringView(buf, n));
+                for (int t = 1; t < 4; t++) {
+                    spargel_check(states[t].symbols[i] == states[0].symbols[i]);
+                }
+            }
+        }
+
+        TEST(StringInterner_Default) {
+            auto a = intern("spargel"_sv);
+            spargel_check(default_interner()->lookup(a) == "spargel"_sv);
+            spargel_check(intern("spargel"_sv) == a);
+        }
+
+    }  // namespace
+}  // namespace spargel::base
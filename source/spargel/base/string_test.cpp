@@ -15,11 +15,9 @@ namespace spargel::base {
             return memcmp(s.data(), s_expected, len) == 0 && s_expected[len] == 0;
         }
 
-        // FIXME
         TEST(String_Empty) {
             String s;
             spargel_check(s.length() == 0);
-            spargel_check(s.data() == nullptr);
 
             String s1, s2;
             spargel_check(s1 == s);
@@ -49,6 +47,60 @@ namespace spargel::base {
             }
         }
 
+        TEST(String_Inline) {
+            String s{"0123456789abcdef"_sv};
+            spargel_check(s.length() == String::inline_capacity);
+            spargel_check(s.capacity() == String::inline_capacity);
+            spargel_check(s.data() >= (char const*)&s && s.data() < (char const*)(&s + 1));
+
+            String t(base::move(s));
+            spargel_check(compare(t, "0123456789abcdef"));
+            spargel_check(t.data() >= (char const*)&t && t.data() < (char const*)(&t + 1));
+            spargel_check(s.length() == 0);
+        }
+
+        TEST(String_Heap) {
+            String s{"0123456789abcdefX"_sv};
+            spargel_check(s.capacity() >= s.length());
+            spargel_check(compare(s, "0123456789abcdefX"));
+
+            char const* p = s.data();
+            String t(base::move(s));
+            spargel_check(t.data() == p);
+            spargel_check(s.length() == 0);
+
+            String u = t;
+            spargel_check(u == t);
+            spargel_check(u.data() != t.data());
+        }
+
+        TEST(String_Append) {
+            String s;
+            for (int i = 0; i < 100; i++) {
+                s.appendByte((Byte)('a' + i % 26));
+            }
+            spargel_check(s.length() == 100);
+            for (usize i = 0; i < 100; i++) {
+                spargel_check(s[i] == (char)('a' + i % 26));
+            }
+
+            String t{"ab"_sv};
+            t += "cd"_sv;
+            t += "0123456789abcdef"_sv;
+            spargel_check(compare(t, "abcd0123456789abcdef"));
+        }
+
+        TEST(String_Swap) {
+            String a{"short"_sv};
+            String b{"a string that does not fit inline"_sv};
+            swap(a, b);
+            spargel_check(compare(a, "a string that does not fit inline"));
+            spargel_check(compare(b, "short"));
+            swap(a, b);
+            spargel_check(compare(a, "short"));
+            spargel_check(compare(b, "a string that does not fit inline"));
+        }
+
         TEST(CString_Basics) {
             char cs[] = {'a', 'b', 'c'};
             CString cstr{cs, cs + 3};
@@ -1,5 +1,292 @@
 #include "spargel/base/task.h"
 
+#include "spargel/base/allocator.h"
+#include "spargel/base/check.h"
+#include "spargel/base/intrinsic.h"
+
 namespace spargel::base {
+
+    namespace {
+        // Frames up to `max_pooled_frame` bytes are pooled, in power-of-two size classes.
+        constexpr usize min_frame_shift = 6;
+        constexpr usize max_frame_shift = 12;
+        constexpr usize max_pooled_frame = usize(1) << max_frame_shift;
+        constexpr usize frame_class_count = max_frame_shift - min_frame_shift + 1;
+        // Keep at most this many free frames per class and thread.
+        constexpr u32 max_free_frames = 64;
+
+        struct FreeFrame {
+            FreeFrame* next;
+        };
+
+        struct FramePool {
+            FreeFrame* free[frame_class_count] = {};
+            u32 count[frame_class_count] = {};
+
+            ~FramePool() {
+                for (usize c = 0; c < frame_class_count; c++) {
+                    while (free[c] != nullptr) {
+                        FreeFrame* f = free[c];
+                        free[c] = f->next;
+                        default_allocator()->free(f, classSize(c));
+                    }
+                }
+            }
+
+            static usize classOf(usize size) {
+                if (size <= (usize(1) << min_frame_shift)) return 0;
+                return GetMostSignificantBit(size - 1) + 1 - min_frame_shift;
+            }
+            static usize classSize(usize c) { return usize(1) << (c + min_frame_shift); }
+        };
+
+        FramePool& frame_pool() {
+            thread_local FramePool pool;
+            return pool;
+        }
+
+        thread_local TaskRunner* current_runner = nullptr;
+    }  // namespace
+
+    namespace detail {
+        void* allocate_frame(usize size) {
+            if (size > max_pooled_frame) return default_allocator()->allocate(size);
+            auto& pool = frame_pool();
+            usize c = FramePool::classOf(size);
+            if (FreeFrame* f = pool.free[c]) {
+                pool.free[c] = f->next;
+                pool.count[c]--;
+                return f;
+            }
+            return default_allocator()->allocate(FramePool::classSize(c));
+        }
+
+        void free_frame(void* ptr, usize size) {
+            if (size > max_pooled_frame) {
+                default_allocator()->free(ptr, size);
+                return;
+            }
+            auto& pool = frame_pool();
+            usize c = FramePool::classOf(size);
+            if (pool.count[c] >= max_free_frames) {
+                default_allocator()->free(ptr, FramePool::classSize(c));
+                return;
+            }
+            auto f = static_cast<FreeFrame*>(ptr);
+            f->next = pool.free[c];
+            pool.free[c] = f;
+            pool.count[c]++;
+        }
+    }  // namespace detail
+
+    // Event
+
+    struct Event::State {
+        Atomic<u32> refs{1};
+        Atomic<bool> set{false};
+        SpinLock lock;
+        EventAwaitable* waiters = nullptr;
+    };
+
+    Event::Event() : _state{new State} {}
+
+    Event::Event(Event const& other) : _state{other._state} {
+        if (_state) _state->refs.fetchAdd(1, MemoryOrder::relaxed);
+    }
+
+    Event& Event::operator=(Event const& other) {
+        Event tmp(other);
+        swap(_state, tmp._state);
+        return *this;
+    }
+
+    Event& Event::operator=(Event&& other) {
+        Event tmp(move(other));
+        swap(_state, tmp._state);
+        return *this;
+    }
+
+    Event::~Event() {
+        if (_state && _state->refs.fetchSub(1, MemoryOrder::acq_rel) == 1) {
+            spargel_check(_state->waiters == nullptr);
+            delete _state;
+        }
+    }
+
+    bool Event::isSet() const { return _state->set.load(MemoryOrder::acquire); }
+
+    void Event::notify() const {
+        EventAwaitable* waiters;
+        {
+            LockGuard guard(_state->lock);
+            _state->set.store(true, MemoryOrder::release);
+            waiters = _state->waiters;
+            _state->waiters = nullptr;
+        }
+        while (waiters != nullptr) {
+            // The awaitable lives in the waiting frame, which may be gone after resuming.
+            EventAwaitable* next = waiters->_next;
+            auto h = waiters->_handle;
+            if (TaskRunner* runner = waiters->_runner) {
+                runner->schedule(h);
+            } else {
+                h.resume();
+            }
+            waiters = next;
+        }
+    }
+
+    bool EventAwaitable::suspend(CoroutineHandle<> h, TaskRunner* runner) {
+        auto state = _event._state;
+        LockGuard guard(state->lock);
+        if (state->set.load(MemoryOrder::relaxed)) return false;
+        _handle = h;
+        _runner = runner;
+        _next = state->waiters;
+        state->waiters = this;
+        return true;
+    }
+
+    // Task
+
     Task Task::PromiseType::get_return_object() { return Task{HandleType::from_promise(*this)}; }
+
+    CoroutineHandle<> Task::FinalAwaitable::await_suspend(HandleType h) noexcept {
+        auto& p = h.promise();
+        auto continuation = p.continuation;
+        if (p.detached) {
+            h.destroy();
+        }
+        if (continuation) return continuation;
+        return noop_coroutine();
+    }
+
+    // TaskRunner
+
+    TaskRunner::~TaskRunner() {
+        if (current_runner == this) current_runner = nullptr;
+    }
+
+    void TaskRunner::bindCurrentThread() { current_runner = this; }
+
+    TaskRunner* TaskRunner::current() { return current_runner; }
+
+    void TaskRunner::schedule(CoroutineHandle<> h) {
+        {
+            LockGuard guard(_lock);
+            _ready.emplace(h);
+        }
+        _signal.fetchAdd(1);
+        if (_sleeping.load()) {
+            atomic_notify_one(_signal.raw());
+        }
+    }
+
+    usize TaskRunner::runUntilIdle() {
+        TaskRunner* prev = current_runner;
+        current_runner = this;
+        usize n = 0;
+        vector<CoroutineHandle<>> batch;
+        for (;;) {
+            {
+                LockGuard guard(_lock);
+                swap(batch, _ready);
+            }
+            if (batch.count() == 0) break;
+            for (auto h : batch) {
+                h.resume();
+            }
+            n += batch.count();
+            batch.clear();
+        }
+        current_runner = prev;
+        return n;
+    }
+
+    void TaskRunner::run() {
+        while (!_quit.load(MemoryOrder::acquire)) {
+            if (runUntilIdle() > 0) continue;
+
+            _sleeping.store(true);
+            u32 signal = _signal.load();
+            bool idle;
+            {
+                LockGuard guard(_lock);
+                idle = _ready.count() == 0;
+            }
+            if (idle && !_quit.load()) {
+                atomic_wait(_signal.raw(), signal);
+            }
+            _sleeping.store(false);
+        }
+        _quit.store(false);
+    }
+
+    void TaskRunner::quit() {
+        _quit.store(true, MemoryOrder::release);
+        _signal.fetchAdd(1);
+        atomic_notify_one(_signal.raw());
+    }
+
+    // when_all / when_any
+
+    namespace {
+        void start(Task t) {
+            if (TaskRunner* runner = TaskRunner::current()) {
+                runner->postTask(move(t));
+            } else {
+                t.detach(nullptr).resume();
+            }
+        }
+
+        Task runAndCount(Task t, Atomic<usize>* remaining, Event done) {
+            co_await move(t);
+            if (remaining->fetchSub(1, MemoryOrder::acq_rel) == 1) {
+                done.notify();
+            }
+        }
+
+        struct AnyState {
+            Atomic<u32> refs;
+            Atomic<bool> finished{false};
+            usize winner = 0;
+            Event done;
+
+            void release() {
+                if (refs.fetchSub(1, MemoryOrder::acq_rel) == 1) delete this;
+            }
+        };
+
+        Task runAndSignal(Task t, AnyState* state, usize index) {
+            co_await move(t);
+            if (!state->finished.exchange(true, MemoryOrder::acq_rel)) {
+                state->winner = index;
+                state->done.notify();
+            }
+            state->release();
+        }
+    }  // namespace
+
+    Task when_all(vector<Task> tasks) {
+        if (tasks.count() == 0) co_return;
+        Atomic<usize> remaining{tasks.count()};
+        Event done;
+        for (auto& t : tasks) {
+            start(runAndCount(move(t), &remaining, done));
+        }
+        co_await done;
+    }
+
+    Task when_any(vector<Task> tasks, usize* winner) {
+        spargel_check(tasks.count() > 0);
+        auto state = new AnyState;
+        state->refs.store(static_cast<u32>(tasks.count() + 1), MemoryOrder::relaxed);
+        for (usize i = 0; i < tasks.count(); i++) {
+            start(runAndSignal(move(tasks[i]), state, i));
+        }
+        co_await state->done;
+        if (winner != nullptr) *winner = state->winner;
+        state->release();
+    }
+
 }  // namespace spargel::base
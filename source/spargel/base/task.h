@@ -1,32 +1,109 @@
 #pragma once
 
+#include "spargel/base/atomic.h"
 #include "spargel/base/coroutine.h"
+#include "spargel/base/meta.h"
+#include "spargel/base/types.h"
+#include "spargel/base/vector.h"
 
 namespace spargel::base {
-    // this should be copyable
-    // a shared_ptr to internal state
-    class Event {};
-    class EventAwaitable {};
+    class TaskRunner;
+    class EventAwaitable;
+
+    namespace detail {
+        // Coroutine frames come from per-thread size-class free lists.
+        void* allocate_frame(usize size);
+        void free_frame(void* ptr, usize size);
+    }  // namespace detail
+
+    // An event that coroutines can wait for.
+    //
+    // This is copyable. Copies share the same state. Once notified, the event stays set, and
+    // later waiters do not suspend.
+    //
+    // A waiting coroutine is resumed on the runner it was running on, or inline by `notify()`
+    // if it has no runner.
+    class Event {
+    public:
+        Event();
+        Event(Event const& other);
+        Event& operator=(Event const& other);
+        Event(Event&& other) : _state{other._state} { other._state = nullptr; }
+        Event& operator=(Event&& other);
+        ~Event();
+
+        // Thread-safe.
+        void notify() const;
+        bool isSet() const;
+
+        EventAwaitable operator co_await() const;
+
+    private:
+        friend class EventAwaitable;
+        struct State;
+        State* _state;
+    };
+
     // Example:
     //   Task foo(Event e) {
     //     print_line("before event");
     //     co_await e;
     //     print_line("after event");
     //   }
+    //
+    // A `Task` is a coroutine that starts suspended. It can be:
+    //   - awaited by another task, which runs it to completion and then continues the awaiter
+    //     by symmetric transfer (no stack growth for long chains);
+    //   - posted to a `TaskRunner`, which takes ownership;
+    //   - resumed by hand with `resume()`.
     class Task {
     public:
+        struct PromiseType;
+
+        using promise_type = PromiseType;
+        using HandleType = CoroutineHandle<promise_type>;
+
+        struct FinalAwaitable {
+            bool await_ready() noexcept { return false; }
+            CoroutineHandle<> await_suspend(HandleType h) noexcept;
+            void await_resume() noexcept {}
+        };
+
         struct PromiseType {
             Task get_return_object();
             AlwaysSuspend initial_suspend() { return {}; }
-            AlwaysSuspend final_suspend() noexcept { return {}; }
+            FinalAwaitable final_suspend() noexcept { return {}; }
             void return_void() {}
             void unhandled_exception() {}
-            EventAwaitable await_transform(Event e);
+
+            static void* operator new(usize size) { return detail::allocate_frame(size); }
+            static void operator delete(void* ptr, usize size) { detail::free_frame(ptr, size); }
+
+            // Resumed when this task finishes.
+            CoroutineHandle<> continuation;
+            // Where this task is resumed after waiting for an event.
+            TaskRunner* runner = nullptr;
+            // The frame destroys itself when it finishes.
+            bool detached = false;
         };
 
-        using promise_type = PromiseType;
-        using HandleType = CoroutineHandle<promise_type>;
+        struct Awaiter {
+            HandleType handle;
 
+            bool await_ready() { return !handle || handle.done(); }
+            template <typename P>
+            HandleType await_suspend(CoroutineHandle<P> caller) {
+                auto& p = handle.promise();
+                p.continuation = caller;
+                if constexpr (IsSame<P, PromiseType>) {
+                    p.runner = caller.promise().runner;
+                }
+                return handle;
+            }
+            void await_resume() {}
+        };
+
+        Task() = default;
         explicit Task(HandleType h) : handle_{h} {}
 
         Task(Task const&) = delete;
@@ -50,15 +127,72 @@ namespace spargel::base {
         void resume() { handle_.resume(); }
         bool done() { return handle_.done(); }
 
+        // Give up ownership. The frame destroys itself when it finishes.
+        HandleType detach(TaskRunner* runner) {
+            auto h = handle_;
+            handle_ = nullptr;
+            h.promise().detached = true;
+            h.promise().runner = runner;
+            return h;
+        }
+
+        Awaiter operator co_await() && { return Awaiter{handle_}; }
+
     private:
         HandleType handle_;
     };
+
+    class EventAwaitable {
+    public:
+        explicit EventAwaitable(Event const& e) : _event{e} {}
+
+        bool await_ready() const { return _event.isSet(); }
+        template <typename P>
+        bool await_suspend(CoroutineHandle<P> h) {
+            TaskRunner* runner = nullptr;
+            if constexpr (IsSame<P, Task::PromiseType>) {
+                runner = h.promise().runner;
+            }
+            return suspend(h, runner);
+        }
+        void await_resume() {}
+
+    private:
+        friend class Event;
+
+        // Return `false` if the event was set in the meantime.
+        bool suspend(CoroutineHandle<> h, TaskRunner* runner);
+
+        Event _event;
+        CoroutineHandle<> _handle;
+        TaskRunner* _runner = nullptr;
+        // The next waiter of the same event.
+        EventAwaitable* _next = nullptr;
+    };
+
+    inline EventAwaitable Event::operator co_await() const { return EventAwaitable(*this); }
+
+    // Runs coroutines on one thread.
+    //
+    // `postTask` and `schedule` may be called from any thread. For multi-threaded execution,
+    // run one `TaskRunner` per thread. A task keeps running on the runner it was posted to,
+    // also after waiting for an event notified from another thread.
     class TaskRunner {
     public:
+        TaskRunner() = default;
+        // Coroutines still queued are neither resumed nor destroyed.
+        ~TaskRunner();
+
+        TaskRunner(TaskRunner const&) = delete;
+        TaskRunner& operator=(TaskRunner const&) = delete;
+
         // bind the current thread to the runner
         void bindCurrentThread();
 
-        void postTask(Task&& t);
+        // The runner bound to or running on the current thread, if any.
+        static TaskRunner* current();
+
+        void postTask(Task&& t) { schedule(t.detach(this)); }
         // Example:
         //   Event e1, e2;
         //   int a = 1;
@@ -72,7 +206,43 @@ namespace spargel::base {
         //     a = 3;
         //   });
         //   e1.notify();
+        //
+        // The callable is moved into the task, so its captures live as long as the task.
+        template <typename F>
+        void postTask(F&& f) {
+            postTask(invoke(RemoveCVRef<F>(forward<F>(f))));
+        }
+
+        // Resume `h` on this runner.
+        void schedule(CoroutineHandle<> h);
+
+        // Resume ready coroutines on the calling thread until there are none.
+        // Return the number of coroutines resumed.
+        usize runUntilIdle();
+
+        // Resume coroutines on the calling thread, sleeping when idle, until `quit()`.
+        void run();
+        // Thread-safe.
+        void quit();
+
+    private:
         template <typename F>
-        void postTask(F&& f);
+        static Task invoke(F f) {
+            co_await f();
+        }
+
+        SpinLock _lock;
+        vector<CoroutineHandle<>> _ready;
+        // Bumped on every `schedule` and `quit`, for `run` to sleep on.
+        Atomic<u32> _signal{0};
+        Atomic<bool> _sleeping{false};
+        Atomic<bool> _quit{false};
     };
+
+    // Run all the tasks concurrently on the current runner, and finish when all of them have.
+    Task when_all(vector<Task> tasks);
+
+    // Run all the tasks concurrently on the current runner, and finish when the first one does.
+    // The index of that task is stored in `winner`, if not null. The others keep running.
+    Task when_any(vector<Task> tasks, usize* winner = nullptr);
 }  // namespace spargel::base
@@ -0,0 +1,173 @@
+#include "spargel/base/task.h"
+
+#include "spargel/base/check.h"
+#include "spargel/base/test.h"
+
+#if SPARGEL_IS_POSIX
+#include <pthread.h>
+#endif
+
+namespace spargel::base {
+    namespace {
+        Task setAfter(Event e, int* out, int value) {
+            co_await e;
+            *out = value;
+        }
+
+        TEST(Task_Event) {
+            TaskRunner runner;
+            Event e1, e2;
+            int a = 1;
+            runner.postTask([&a, e1, e2]() -> Task {
+                co_await e1;
+                a = 2;
+                e2.notify();
+            });
+            runner.postTask(setAfter(e2, &a, 3));
+            runner.runUntilIdle();
+            spargel_check(a == 1);
+
+            e1.notify();
+            spargel_check(e1.isSet());
+            runner.runUntilIdle();
+            spargel_check(a == 3);
+
+            // A set event does not suspend.
+            runner.postTask(setAfter(e1, &a, 4));
+            runner.runUntilIdle();
+            spargel_check(a == 4);
+        }
+
+        Task leaf(int* counter) {
+            (*counter)++;
+            co_return;
+        }
+
+        Task chain(int* counter, int depth) {
+            if (depth == 0) {
+                co_await leaf(counter);
+                co_return;
+            }
+            co_await chain(counter, depth - 1);
+        }
+
+        Task loop(int* counter, int n) {
+            for (int i = 0; i < n; i++) {
+                co_await leaf(counter);
+            }
+        }
+
+        TEST(Task_SymmetricTransfer) {
+            // Neither a deep chain nor a long sequence of awaits grows the stack.
+            int counter = 0;
+            Task t = chain(&counter, 1000);
+            t.resume();
+            spargel_check(t.done());
+            spargel_check(counter == 1);
+
+            counter = 0;
+            Task u = loop(&counter, 10000);
+            u.resume();
+            spargel_check(u.done());
+            spargel_check(counter == 10000);
+        }
+
+        TEST(Task_WhenAll) {
+            TaskRunner runner;
+            Event e1, e2;
+            int a = 0, b = 0;
+            bool finished = false;
+            runner.postTask([&]() -> Task {
+                vector<Task> tasks;
+                tasks.emplace(setAfter(e1, &a, 1));
+                tasks.emplace(setAfter(e2, &b, 2));
+                co_await when_all(move(tasks));
+                finished = true;
+            });
+            runner.runUntilIdle();
+            e1.notify();
+            runner.runUntilIdle();
+            spargel_check(a == 1 && !finished);
+            e2.notify();
+            runner.runUntilIdle();
+            spargel_check(b == 2 && finished);
+        }
+
+        TEST(Task_WhenAny) {
+            TaskRunner runner;
+            Event e1, e2;
+            int a = 0, b = 0;
+            usize winner = 100;
+            runner.postTask([&]() -> Task {
+                vector<Task> tasks;
+                tasks.emplace(setAfter(e1, &a, 1));
+                tasks.emplace(setAfter(e2, &b, 2));
+                co_await when_any(move(tasks), &winner);
+            });
+            runner.runUntilIdle();
+            e2.notify();
+            runner.runUntilIdle();
+            spargel_check(winner == 1 && b == 2 && a == 0);
+            // The other task keeps running.
+            e1.notify();
+            runner.runUntilIdle();
+            spargel_check(a == 1 && winner == 1);
+        }
+
+#if SPARGEL_IS_POSIX
+        struct CrossThread {
+            TaskRunner runner;
+            Event ping;
+            Event pong;
+            Event started;
+            int value = 0;
+        };
+
+        void* runnerMain(void* arg) {
+            auto state = static_cast<CrossThread*>(arg);
+            state->runner.bindCurrentThread();
+            state->runner.run();
+            return nullptr;
+        }
+
+        TEST(Task_CrossThread) {
+            CrossThread state;
+            pthread_t thread;
+            pthread_create(&thread, nullptr, runnerMain, &state);
+
+            state.runner.postTask([&state]() -> Task {
+                state.started.notify();
+                co_await state.ping;
+                state.value = 42;
+                state.pong.notify();
+                state.runner.quit();
+            });
+
+            // Wait for the pong without a runner, so this thread is resumed inline.
+            int seen = 0;
+            Task waiter = [](CrossThread* s, int* out) -> Task {
+                co_await s->pong;
+                *out = s->value;
+            }(&state, &seen);
+            waiter.resume();
+
+            state.ping.notify();
+            pthread_join(thread, nullptr);
+            spargel_check(waiter.done());
+            spargel_check(seen == 42);
+        }
+#endif
+
+        TEST(Task_FramePool) {
+            // Freed frames are reused by the next frame of the same size class.
+            void* p = detail::allocate_frame(200);
+            detail::free_frame(p, 200);
+            void* q = detail::allocate_frame(250);
+            spargel_check(p == q);
+            detail::free_frame(q, 250);
+
+            void* big = detail::allocate_frame(100000);
+            detail::free_frame(big, 100000);
+        }
+    }  // namespace
+}  // namespace spargel::base
@@ -1,10 +1,477 @@
 #include "spargel/base/trace.h"
 
+#include "spargel/base/allocator.h"
+#include "spargel/base/object.h"
+#include "spargel/base/perf_counters.h"
+#include "spargel/base/platform.h"
+
+// libc
+#include <stdlib.h>
+#include <string.h>
+
+#if SPARGEL_IS_POSIX
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+#elif SPARGEL_IS_WINDOWS
+#include <windows.h>
+#endif
+
 namespace spargel::base {
 
+    namespace {
+        // How often the flusher drains the buffers.
+        constexpr u32 flush_interval_ms = 10;
+
+        // Set when the engine is created, after which the options are fixed.
+        Atomic<bool> engine_created{false};
+        bool options_configured = false;
+        TraceOptions options;
+
+        // Environment variables override the defaults.
+        void read_options_from_env() {
+            if (char const* path = getenv("SPARGEL_TRACE_FILE")) {
+                if (path[0] != '\0') options.path = path;
+            }
+            if (char const* size = getenv("SPARGEL_TRACE_RING_SIZE")) {
+                long mib = strtol(size, nullptr, 10);
+                if (mib > 0) options.ring_size = static_cast<usize>(mib) << 20;
+            }
+        }
+
+        // Set once the buffer of this thread is retired.
+        thread_local bool thread_exiting = false;
+
+        // The hardware counters of a thread, and their values where the enclosing regions began.
+        struct CountedRegions {
+            static constexpr u32 max_depth = 64;
+
+            PerfCounterGroup group;
+            // Regions nested deeper than `max_depth` record no counters.
+            u32 depth = 0;
+            PerfCounterValues begin[max_depth];
+        };
+
+        // Opens the counters of the calling thread on first use.
+        CountedRegions* counted_regions() {
+            thread_local CountedRegions regions;
+            return &regions;
+        }
+
+        void sleep_ms(u32 ms) {
+#if SPARGEL_IS_POSIX
+            timespec ts{0, static_cast<long>(ms) * 1000000};
+            nanosleep(&ts, nullptr);
+#elif SPARGEL_IS_WINDOWS
+            Sleep(ms);
+#else
+            (void)ms;
+#endif
+        }
+
+#if SPARGEL_IS_WINDOWS
+        // The thread routine for `CreateThread`, running `Main`.
+        template <void* (*Main)(void*)>
+        DWORD WINAPI windows_thread_main(LPVOID arg) {
+            Main(arg);
+            return 0;
+        }
+#endif
+    }  // namespace
+
+#if SPARGEL_IS_POSIX
+
+    // TraceRingFile
+    //
+    // A ring file mapped into memory, see `trace_ring_file_magic`. Only the drain writes it,
+    // under `_drain_lock`.
+    //
+    class TraceRingFile {
+    public:
+        struct Header {
+            char magic[8];
+            u32 version;
+            u32 event_size;
+            u64 names_capacity;
+            u64 events_capacity;
+            Atomic<u64> names_size;
+            Atomic<u64> events_tail;
+            Atomic<u64> events_head;
+            u64 reserved;
+        };
+        static_assert(sizeof(Header) == 64);
+
+        // Return null if the file cannot be created and mapped.
+        static TraceRingFile* open(char const* path, usize size) {
+            // Leave room for a few hundred thousand events.
+            constexpr usize min_size = 1 << 20;
+            if (size < min_size) size = min_size;
+            // Names take a sixteenth, in whole events.
+            u64 names_capacity = (size / 16) & ~u64{15};
+            u64 events_capacity = (size - sizeof(Header) - names_capacity) / sizeof(TraceEvent);
+            usize total = sizeof(Header) + names_capacity + events_capacity * sizeof(TraceEvent);
+
+            int fd = ::open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+            if (fd < 0) return nullptr;
+            if (ftruncate(fd, static_cast<off_t>(total)) != 0) {
+                ::close(fd);
+                return nullptr;
+            }
+            void* map = mmap(nullptr, total, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            ::close(fd);
+            if (map == MAP_FAILED) return nullptr;
+
+            // The file is zero-filled, so the sizes and positions start at zero.
+            auto header = static_cast<Header*>(map);
+            memcpy(header->magic, trace_ring_file_magic, sizeof(header->magic));
+            header->version = trace_file_version;
+            header->event_size = sizeof(TraceEvent);
+            header->names_capacity = names_capacity;
+            header->events_capacity = events_capacity;
+
+            auto ring =
+                static_cast<TraceRingFile*>(default_allocator()->allocate(sizeof(TraceRingFile)));
+            construct_at(ring);
+            ring->_header = header;
+            ring->_size = total;
+            ring->_names = static_cast<u8*>(map) + sizeof(Header);
+            ring->_events = reinterpret_cast<TraceEvent*>(ring->_names + names_capacity);
+            return ring;
+        }
+
+        static void close(TraceRingFile* ring) {
+            munmap(ring->_header, ring->_size);
+            destruct_at(ring);
+            default_allocator()->free(ring, sizeof(TraceRingFile));
+        }
+
+        // Names that do not fit are left out; their events show up without a name.
+        void writeName(u32 id, StringView name) {
+            u64 used = _header->names_size.load(MemoryOrder::relaxed);
+            usize length = name.length();
+            if (used + 8 + length > _header->names_capacity) return;
+            u32 entry[2] = {id, static_cast<u32>(length)};
+            memcpy(_names + used, entry, sizeof(entry));
+            memcpy(_names + used + 8, name.data(), length);
+            _header->names_size.store(used + 8 + length, MemoryOrder::release);
+        }
+
+        void writeEvents(u32 tid, TraceEvent const* events, usize count) {
+            if (count == 0) return;
+            u64 capacity = _header->events_capacity;
+            // Keep the newest events, behind their leader.
+            if (count > capacity - 1) {
+                events += count - (capacity - 1);
+                count = static_cast<usize>(capacity - 1);
+            }
+            u64 head = _header->events_head.load(MemoryOrder::relaxed);
+            u64 new_head = head + 1 + count;
+            // Give up the slots about to be overwritten first.
+            if (new_head > capacity &&
+                _header->events_tail.load(MemoryOrder::relaxed) < new_head - capacity) {
+                _header->events_tail.store(new_head - capacity, MemoryOrder::release);
+            }
+            _events[head % capacity] = TraceEvent{tid, 0, EventKind::thread};
+            for (usize i = 0; i < count; i++) {
+                _events[(head + 1 + i) % capacity] = events[i];
+            }
+            _header->events_head.store(new_head, MemoryOrder::release);
+        }
+
+        // Ask the kernel to write the pages back. The pages already survive a crash of the
+        // process; this is for a crash of the machine.
+        void sync() { msync(_header, _size, MS_ASYNC); }
+
+    private:
+        Header* _header = nullptr;
+        usize _size = 0;
+        u8* _names = nullptr;
+        TraceEvent* _events = nullptr;
+    };
+
+#else
+
+    // The ring needs `mmap`. Elsewhere the engine never creates one.
+    class TraceRingFile {
+    public:
+        static TraceRingFile* open(char const*, usize) { return nullptr; }
+        static void close(TraceRingFile*) {}
+        void writeName(u32, StringView) {}
+        void writeEvents(u32, TraceEvent const*, usize) {}
+        void sync() {}
+    };
+
+#endif
+
+    thread_local TraceEngine::ThreadBuffer* TraceEngine::_thread_buffer = nullptr;
+    Atomic<bool> TraceEngine::_alive{false};
+
+    // Once the owning thread drops its pointer and marks the buffer retired, the next drain
+    // frees it. If the engine is gone, the buffer was left allocated, and marking it is
+    // harmless.
+    struct TraceEngine::ThreadSlot {
+        ThreadBuffer* buffer = nullptr;
+        ~ThreadSlot() {
+            if (buffer == nullptr) return;
+            _thread_buffer = nullptr;
+            thread_exiting = true;
+            buffer->retired.store(true, MemoryOrder::release);
+        }
+    };
+
     TraceEngine* TraceEngine::getInstance() {
         static TraceEngine inst;
         return &inst;
     }
 
+    bool TraceEngine::configure(TraceOptions const& o) {
+        if (engine_created.load(MemoryOrder::acquire)) return false;
+        options = o;
+        options_configured = true;
+        return true;
+    }
+
+    void TraceEngine::flushForCrash() {
+        if (!_alive.load(MemoryOrder::acquire)) return;
+        TraceEngine* self = getInstance();
+        if (!self->_drain_lock.tryLock()) return;
+        self->drain();
+        if (self->_ring != nullptr) self->_ring->sync();
+        if (self->_file != nullptr) fflush(self->_file);
+        self->_drain_lock.unlock();
+    }
+
+    TraceEngine::TraceEngine() {
+        engine_created.store(true, MemoryOrder::release);
+        if (!options_configured) read_options_from_env();
+        char const* perf = getenv("SPARGEL_TRACE_PERF_COUNTERS");
+        _perf_counters = perf != nullptr && strcmp(perf, "1") == 0;
+        if (options.ring_size != 0) {
+            _ring = TraceRingFile::open(options.path, options.ring_size);
+            if (_ring == nullptr) {
+                fprintf(stderr, "cannot map the trace ring %s; writing a stream instead\n",
+                        options.path);
+            }
+        }
+        if (_ring == nullptr) {
+            _file = fopen(options.path, "wb");
+            writeHeader();
+        }
+        _alive.store(true, MemoryOrder::release);
+#if SPARGEL_IS_POSIX
+        auto thread = new pthread_t;
+        if (pthread_create(thread, nullptr, flusherMain, this) == 0) {
+            _flusher = thread;
+        } else {
+            delete thread;
+        }
+#elif SPARGEL_IS_WINDOWS
+        _flusher = CreateThread(nullptr, 0, windows_thread_main<flusherMain>, this, 0, nullptr);
+#endif
+    }
+
+    TraceEngine::~TraceEngine() {
+        _stop.store(true, MemoryOrder::release);
+#if SPARGEL_IS_POSIX
+        if (_flusher != nullptr) {
+            auto thread = static_cast<pthread_t*>(_flusher);
+            pthread_join(*thread, nullptr);
+            delete thread;
+        }
+#elif SPARGEL_IS_WINDOWS
+        if (_flusher != nullptr) {
+            WaitForSingleObject(_flusher, INFINITE);
+            CloseHandle(_flusher);
+        }
+#endif
+        _alive.store(false, MemoryOrder::release);
+        // The drain frees the buffers of exited threads. The others stay allocated: threads
+        // that were not joined may still be in `record`, past the check of `_alive`.
+        flush();
+        if (_file != nullptr) fclose(_file);
+        if (_ring != nullptr) TraceRingFile::close(_ring);
+    }
+
+    u64 TraceEngine::now() { return get_monotonic_time_ns(); }
+
+    u32 TraceEngine::registerName(StringView name) {
+        // E.g. from a static destructor that runs after the engine's.
+        if (!_alive.load(MemoryOrder::acquire)) return 0;
+        return _names.intern(name).getId();
+    }
+
+    void TraceEngine::writeHeader() {
+        if (_file == nullptr) return;
+        u32 header[2] = {trace_file_version, sizeof(TraceEvent)};
+        fwrite(trace_file_magic, sizeof(trace_file_magic), 1, _file);
+        fwrite(header, sizeof(header), 1, _file);
+    }
+
+    // Requires `_drain_lock`.
+    void TraceEngine::writeNewNames() {
+        u32 count = _names.count();
+        if (count == _names_written) return;
+        if (_ring != nullptr) {
+            for (u32 id = _names_written; id < count; id++) {
+                _ring->writeName(id, lookupName(id));
+            }
+            _names_written = count;
+            return;
+        }
+        u32 header[2] = {static_cast<u32>(TraceRecord::names), count - _names_written};
+        fwrite(header, sizeof(header), 1, _file);
+        for (u32 id = _names_written; id < count; id++) {
+            StringView name = lookupName(id);
+            u32 entry[2] = {id, static_cast<u32>(name.length())};
+            fwrite(entry, sizeof(entry), 1, _file);
+            fwrite(name.data(), 1, name.length(), _file);
+        }
+        _names_written = count;
+    }
+
+    // Requires `_drain_lock`.
+    void TraceEngine::writeEvents(u32 tid, TraceEvent const* events, usize count) {
+        if (count == 0) return;
+        if (_ring != nullptr) {
+            _ring->writeEvents(tid, events, count);
+            return;
+        }
+        u32 header[3] = {static_cast<u32>(TraceRecord::events), tid, static_cast<u32>(count)};
+        fwrite(header, sizeof(header), 1, _file);
+        fwrite(events, sizeof(TraceEvent), count, _file);
+    }
+
+    TraceEngine::ThreadBuffer* TraceEngine::registerThread() {
+        if (thread_exiting) return nullptr;
+        thread_local ThreadSlot slot;
+
+        auto b = static_cast<ThreadBuffer*>(default_allocator()->allocate(sizeof(ThreadBuffer)));
+        construct_at(b);
+        b->tid = static_cast<u32>(get_current_thread_id());
+
+        ThreadBuffer* head = _new_buffers.load(MemoryOrder::relaxed);
+        do {
+            b->next = head;
+        } while (!_new_buffers.compareExchangeWeak(head, b, MemoryOrder::release,
+                                                    MemoryOrder::relaxed));
+
+        slot.buffer = b;
+        _thread_buffer = b;
+        return b;
+    }
+
+    void TraceEngine::enterCountedRegion() {
+        CountedRegions* r = counted_regions();
+        if (r->depth < CountedRegions::max_depth && r->group.isAvailable()) {
+            r->begin[r->depth] = r->group.read();
+        }
+        r->depth++;
+    }
+
+    void TraceEngine::leaveCountedRegion(u32 name) {
+        CountedRegions* r = counted_regions();
+        // Unbalanced.
+        if (r->depth == 0) {
+            record(name, EventKind::leave_region);
+            return;
+        }
+        r->depth--;
+        if (r->depth >= CountedRegions::max_depth || !r->group.isAvailable()) {
+            record(name, EventKind::leave_region);
+            return;
+        }
+        PerfCounterValues v = r->group.read() - r->begin[r->depth];
+        record(name, EventKind::leave_region, v.cycles, v.instructions, v.cache_misses,
+               v.branch_misses);
+    }
+
+    bool TraceEngine::makeRoom(ThreadBuffer* b) {
+        if (_flusher == nullptr) {
+            flush();
+            return true;
+        }
+        b->dropped.store(b->dropped.load(MemoryOrder::relaxed) + 1, MemoryOrder::relaxed);
+        return false;
+    }
+
+    void TraceEngine::flush() {
+        LockGuard guard(_drain_lock);
+        drain();
+        if (_file != nullptr) fflush(_file);
+        if (_ring != nullptr) _ring->sync();
+    }
+
+    u64 TraceEngine::droppedEventCount() {
+        LockGuard guard(_drain_lock);
+        u64 n = _retired_dropped;
+        for (ThreadBuffer* b = _buffers; b != nullptr; b = b->next) {
+            n += b->dropped.load(MemoryOrder::relaxed);
+        }
+        return n;
+    }
+
+    // Requires `_drain_lock`.
+    void TraceEngine::drain() {
+        // Adopt the buffers of new threads.
+        ThreadBuffer* fresh = _new_buffers.exchange(nullptr, MemoryOrder::acquire);
+        while (fresh != nullptr) {
+            ThreadBuffer* next = fresh->next;
+            fresh->next = _buffers;
+            _buffers = fresh;
+            fresh = next;
+        }
+
+        // Snapshot the buffers first, so that every name the drained events refer to is
+        // visible below, and goes into the file before them.
+        for (ThreadBuffer* b = _buffers; b != nullptr; b = b->next) {
+            // Read before the head: a retired buffer gets no more events.
+            b->drain_retired = b->retired.load(MemoryOrder::acquire);
+            b->drain_head = b->head.load(MemoryOrder::acquire);
+        }
+        bool has_output = _file != nullptr || _ring != nullptr;
+        if (has_output) writeNewNames();
+
+        ThreadBuffer** link = &_buffers;
+        while (ThreadBuffer* b = *link) {
+            bool retired = b->drain_retired;
+            u64 tail = b->tail.load(MemoryOrder::relaxed);
+            u64 head = b->drain_head;
+            if (head != tail && has_output) {
+                usize mask = ThreadBuffer::capacity - 1;
+                usize begin = static_cast<usize>(tail & mask);
+                usize count = static_cast<usize>(head - tail);
+                usize first = count < ThreadBuffer::capacity - begin
+                                  ? count
+                                  : ThreadBuffer::capacity - begin;
+                // The buffer wraps around: write the two parts as two runs.
+                writeEvents(b->tid, &b->events[begin], first);
+                writeEvents(b->tid, &b->events[0], count - first);
+            }
+            b->tail.store(head, MemoryOrder::release);
+
+            if (retired) {
+                *link = b->next;
+                _retired_dropped += b->dropped.load(MemoryOrder::relaxed);
+                destruct_at(b);
+                default_allocator()->free(b, sizeof(ThreadBuffer));
+            } else {
+                link = &b->next;
+            }
+        }
+    }
+
+    void* TraceEngine::flusherMain(void* arg) {
+        auto self = static_cast<TraceEngine*>(arg);
+        while (!self->_stop.load(MemoryOrder::acquire)) {
+            sleep_ms(flush_interval_ms);
+            LockGuard guard(self->_drain_lock);
+            self->drain();
+            // Hand the events to the kernel, so they outlive a crash of the process.
+            if (self->_file != nullptr) fflush(self->_file);
+        }
+        return nullptr;
+    }
+
 }  // namespace spargel::base
@@ -1,109 +1,331 @@
 #pragma once
 
-#include "spargel/base/allocator.h"
+#include "spargel/base/atomic.h"
+#include "spargel/base/string_interner.h"
+#include "spargel/base/string_view.h"
 #include "spargel/base/types.h"
 #include "spargel/config.h"
 
 //
 #include <stdio.h>
-#include <string.h>
-
-#if SPARGEL_IS_POSIX
-#include <sys/time.h>
-#endif
 
 namespace spargel::base {
 
-    enum class EventKind {
+    enum class EventKind : u32 {
         enter_region,
+        // With hardware counters on, followed by four `argument`s: the cycles, instructions,
+        // cache misses and branch misses of the region, see `TraceEngine`.
         leave_region,
+        // A point in time.
+        instant,
+        // A sample of a counter track. Followed by an `argument` holding the value as `i64`.
+        counter,
+        // Arrows between events, e.g. from where a task is posted to where it runs. Followed by
+        // an `argument` holding the flow id, see `TraceEngine::newFlowId()`.
+        flow_begin,
+        flow_step,
+        flow_end,
+        // The payload of the previous event, stored in `timestamp`. Not an event by itself.
+        argument,
+        // Only in ring files: the events up to the next `thread` belong to the thread whose id
+        // is stored in `timestamp`.
+        thread,
+    };
+
+    // The layout of a stream file, the default output, in native byte order:
+    //
+    //     header:  char magic[8] = "SPTRACE\0", u32 version, u32 sizeof(TraceEvent)
+    //     then any number of records, each starting with a u32 `TraceRecord`:
+    //       names:   u32 count, then `count` times { u32 id, u32 length, char[length] }
+    //       events:  u32 tid, u32 count, then `count` TraceEvents of that thread
+    //
+    // A name record always precedes the first event that refers to one of its names.
+    //
+    constexpr char trace_file_magic[8] = "SPTRACE";
+    constexpr u32 trace_file_version = 3;
+
+    enum class TraceRecord : u32 {
+        names = 1,
+        events = 2,
     };
 
     struct TraceEvent {
-        char name[64];
-        EventKind kind;
+        // Nanoseconds, see `get_monotonic_time_ns()`.
         u64 timestamp;
+        // See `TraceEngine::registerName`.
+        u32 name;
+        EventKind kind;
     };
 
-    static_assert(sizeof(TraceEvent) == 80);
+    static_assert(sizeof(TraceEvent) == 16);
+
+    // The layout of a ring file, see `TraceOptions::ring_size`, in native byte order:
+    //
+    //     header:  char magic[8] = "SPTRING\0", u32 version, u32 sizeof(TraceEvent),
+    //              u64 names_capacity, u64 events_capacity,
+    //              u64 names_size, u64 events_tail, u64 events_head, u64 reserved
+    //     then names_capacity bytes: `names_size` bytes of { u32 id, u32 length, char[length] }
+    //     then events_capacity TraceEvents: event `i` is at `i % events_capacity`
+    //
+    // Events `events_tail` to `events_head` are valid, and each run of events is led by a
+    // `thread` event. The sizes and positions are updated after the data they cover, and the
+    // tail before the data it drops, so the file is consistent at any point. A reader skips
+    // the events before the first `thread`, which lost their leader to the wrap.
+    //
+    constexpr char trace_ring_file_magic[8] = "SPTRING";
+
+    class TraceRingFile;
 
+    struct TraceOptions {
+        // The output file. Must stay alive until the engine opens it.
+        char const* path = "trace.bin";
+        // If not zero, write to a memory-mapped ring file of this many bytes instead of a
+        // stream. The oldest events are overwritten, and the file is readable even after the
+        // process crashes. POSIX only; elsewhere the stream is used.
+        usize ring_size = 0;
+    };
+
+    // TraceEngine
+    //
+    // Records trace events into per-thread ring buffers. A background thread drains the
+    // buffers into the output file every few milliseconds, see `TraceOptions`.
+    //
+    // Event names are registered once, usually per call site, and events refer to them by id.
+    //
+    // Note:
+    //     - Recording never blocks or takes a lock: a thread only writes its own buffer. When
+    //       the buffer is full, the event is dropped and counted.
+    //     - Each buffer is single-producer single-consumer. Buffers of exited threads are
+    //       drained, then freed. Events recorded by a thread after its buffer is retired, e.g.
+    //       by destructors of other thread-locals, are dropped.
+    //     - Once the engine is destroyed, recording does nothing. The buffers of threads that
+    //       are still running are left allocated, since those threads may be writing them.
+    //     - Events of different threads are not ordered in the file. Sort them by timestamp.
+    //     - With `SPARGEL_TRACE_PERF_COUNTERS=1` in the environment, regions also record the
+    //       hardware counters of their thread, see `PerfCounterGroup`. Reading them takes two
+    //       system calls per region, so keep regions coarse. Threads without counters record
+    //       plain regions.
+    //     - Without `configure`, the options come from the environment: `SPARGEL_TRACE_FILE`
+    //       is the path, and `SPARGEL_TRACE_RING_SIZE` the ring size in MiB.
+    //     - On `panic_at`, the buffers are drained before the process stops.
+    //
     class TraceEngine {
     public:
         static TraceEngine* getInstance();
 
-        TraceEngine() {
-            _file = fopen("trace.bin", "w");
-            _buffer = reinterpret_cast<u8*>(default_allocator()->allocate(4096));
-            _end = _buffer + 4096;
-            _cur = _buffer;
-        }
+        // Set the options of the engine. Return false if it has already started, i.e. after
+        // the first event or name.
+        static bool configure(TraceOptions const& options);
 
-        ~TraceEngine() {
-            flush();
-            fclose(_file);
-            default_allocator()->free(_buffer, 4096);
-        }
+        // Drain the buffers if the engine is running and the drain is not in progress, e.g. on
+        // this very thread. For crash handlers.
+        static void flushForCrash();
 
-        void enterRegion(char const* name) { emit(name, EventKind::enter_region, getTimestamp()); }
+        ~TraceEngine();
 
-        void leaveRegion(char const* name) { emit(name, EventKind::leave_region, getTimestamp()); }
+        TraceEngine(TraceEngine const&) = delete;
+        TraceEngine& operator=(TraceEngine const&) = delete;
 
-        void emit(char const* name, EventKind k, u64 t) {
-            // if (_cnt >= 1000) return;
+        // Return the id of `name`. Registering the same string again returns the same id.
+        // Takes a lock, so register names once and keep the id.
+        u32 registerName(StringView name);
 
-            usize l = strlen(name);
-            if (l > 63) l = 63;
-            TraceEvent e;
-            memcpy(e.name, name, l);
-            e.name[l] = 0;
-            e.kind = k;
-            e.timestamp = t;
+        // The string of a registered name.
+        StringView lookupName(u32 id) const { return _names.lookup(Symbol(id)); }
 
-            if (_cur + sizeof(e) > _end) {
-                flush();
+        void enterRegion(u32 name) {
+            record(name, EventKind::enter_region);
+            if (_perf_counters) [[unlikely]] {
+                enterCountedRegion();
             }
-            memcpy(_cur, &e, sizeof(e));
-            _cur += sizeof(e);
         }
 
-    private:
-#if SPARGEL_IS_POSIX
-        u64 getTimestamp() {
-            struct timeval tv;
-            gettimeofday(&tv, NULL);
-            return static_cast<u64>(tv.tv_usec);
+        void leaveRegion(u32 name) {
+            if (_perf_counters) [[unlikely]] {
+                leaveCountedRegion(name);
+                return;
+            }
+            record(name, EventKind::leave_region);
         }
-#else
-        u64 getTimestamp() {
-            return 0;  // TODO
+
+        void instant(u32 name) { record(name, EventKind::instant); }
+
+        void counter(u32 name, i64 value) {
+            record(name, EventKind::counter, static_cast<u64>(value));
         }
-#endif
 
-        void flush() {
-            fwrite(_buffer, static_cast<usize>(_cur - _buffer), 1, _file);
-            _cnt++;
-            _cur = _buffer;
+        void flowBegin(u32 name, u64 flow) { record(name, EventKind::flow_begin, flow); }
+
+        void flowStep(u32 name, u64 flow) { record(name, EventKind::flow_step, flow); }
+
+        void flowEnd(u32 name, u64 flow) { record(name, EventKind::flow_end, flow); }
+
+        // A fresh id for a chain of flow events. Thread-safe.
+        u64 newFlowId() { return _next_flow.fetchAdd(1, MemoryOrder::relaxed); }
+
+        // Write out every event recorded so far. Thread-safe.
+        void flush();
+
+        // The number of events dropped because a buffer was full.
+        u64 droppedEventCount();
+
+    private:
+        // Record an event, followed by an `argument` event for each argument.
+        template <typename... Args>
+        void record(u32 name, EventKind kind, Args... arguments) {
+            constexpr usize slots = 1 + sizeof...(Args);
+            if (!_alive.load(MemoryOrder::relaxed)) [[unlikely]] {
+                return;
+            }
+            ThreadBuffer* b = _thread_buffer;
+            if (b == nullptr) [[unlikely]] {
+                b = registerThread();
+                if (b == nullptr) return;
+            }
+            u64 head = b->head.load(MemoryOrder::relaxed);
+            if (head - b->tail.load(MemoryOrder::acquire) > ThreadBuffer::capacity - slots) {
+                if (!makeRoom(b)) return;
+            }
+            constexpr usize mask = ThreadBuffer::capacity - 1;
+            TraceEvent& e = b->events[head & mask];
+            e.timestamp = now();
+            e.name = name;
+            e.kind = kind;
+            [[maybe_unused]] u64 slot = head;
+            ((b->events[++slot & mask] = TraceEvent{static_cast<u64>(arguments), name,
+                                                    EventKind::argument}),
+             ...);
+            // Publish the slots to the flusher together, so a drain never splits them.
+            b->head.store(head + slots, MemoryOrder::release);
         }
 
-        FILE* _file;
-        u8* _buffer;
-        u8* _end;
-        u8* _cur;
-        u32 _cnt = 0;
+        struct ThreadBuffer {
+            // In events. A power of two.
+            static constexpr usize capacity = 16384;
+
+            // Written by the owning thread only.
+            Atomic<u64> head{0};
+            Atomic<u64> dropped{0};
+            // See `get_current_thread_id()`.
+            u32 tid = 0;
+            // Set by the owning thread when it exits.
+            Atomic<bool> retired{false};
+            // Keep `tail` off the cache line of `head`.
+            u8 _padding[64];
+            // Written by the flusher only.
+            Atomic<u64> tail{0};
+            // The state seen by the current drain.
+            u64 drain_head = 0;
+            bool drain_retired = false;
+            ThreadBuffer* next = nullptr;
+            TraceEvent events[capacity];
+        };
+
+        // Retires the buffer of an exiting thread, see trace.cpp.
+        struct ThreadSlot;
+
+        TraceEngine();
+
+        static u64 now();
+
+        // Return null if the thread is exiting.
+        ThreadBuffer* registerThread();
+        void enterCountedRegion();
+        void leaveCountedRegion(u32 name);
+        void writeHeader();
+        void writeNewNames();
+        void writeEvents(u32 tid, TraceEvent const* events, usize count);
+        // Drain the full buffer if there is no flusher thread. Otherwise count the event as
+        // dropped, and return false.
+        bool makeRoom(ThreadBuffer* b);
+        void drain();
+        static void* flusherMain(void* arg);
+
+        static thread_local ThreadBuffer* _thread_buffer;
+        // Set while the engine is between its constructor and its destructor.
+        static Atomic<bool> _alive;
+
+        FILE* _file = nullptr;
+        // Instead of `_file`, if configured.
+        TraceRingFile* _ring = nullptr;
+        StringInterner _names;
+        // Names with a smaller id are already in the file.
+        u32 _names_written = 1;
+        // Buffers registered since the last drain, pushed lock-free by new threads.
+        Atomic<ThreadBuffer*> _new_buffers{nullptr};
+        // Only touched while holding `_drain_lock`.
+        ThreadBuffer* _buffers = nullptr;
+        u64 _retired_dropped = 0;
+        SpinLock _drain_lock;
+        Atomic<bool> _stop{false};
+        Atomic<u64> _next_flow{1};
+        // See `SPARGEL_TRACE_PERF_COUNTERS`.
+        bool _perf_counters = false;
+        // The flusher thread, see trace.cpp.
+        void* _flusher = nullptr;
+    };
+
+    // A name registered on first use. Meant to be a function-local static, so that every call
+    // site registers its name once.
+    struct TraceName {
+        explicit TraceName(StringView name) : id{TraceEngine::getInstance()->registerName(name)} {}
+
+        u32 id;
     };
 
     struct RegionTrace {
-        RegionTrace(char const* n) : name{n} { TraceEngine::getInstance()->enterRegion(name); }
+        RegionTrace(TraceName const& n) : name{n.id} {
+            TraceEngine::getInstance()->enterRegion(name);
+        }
 
         ~RegionTrace() { TraceEngine::getInstance()->leaveRegion(name); }
 
-        char const* name;
+        u32 name;
     };
 
 }  // namespace spargel::base
 
+#define _spargel_trace_concat2(a, b) a##b
+#define _spargel_trace_concat(a, b) _spargel_trace_concat2(a, b)
+
+// Trace macros
+//
+// Every call site registers its name once. With `SPARGEL_ENABLE_TRACING` off, they compile to
+// nothing and their arguments are not evaluated.
+//
+//     - `spargel_trace_scope(name)`: a region from here to the end of the enclosing scope.
+//     - `spargel_trace_instant(name)`: a point in time.
+//     - `spargel_trace_counter(name, value)`: a sample of the counter track `name`.
+//     - `spargel_trace_flow_begin(name, id)`, `spargel_trace_flow_step(name, id)` and
+//       `spargel_trace_flow_end(name, id)`: a chain of arrows between the enclosing regions,
+//       identified by an id from `TraceEngine::newFlowId()`.
+//
 #if SPARGEL_ENABLE_TRACING
-#define spargel_trace_scope(name) ::spargel::base::RegionTrace _trace_scope_##__LINE__(name)
+#define _spargel_trace_event(name, method, ...)                                \
+    do {                                                                        \
+        static ::spargel::base::TraceName const _trace_name{name};              \
+        ::spargel::base::TraceEngine::getInstance()->method(                    \
+            _trace_name.id __VA_OPT__(, ) __VA_ARGS__);                         \
+    } while (0)
+
+#define spargel_trace_instant(name) _spargel_trace_event(name, instant)
+#define spargel_trace_counter(name, value) \
+    _spargel_trace_event(name, counter, static_cast<::i64>(value))
+#define spargel_trace_flow_begin(name, id) _spargel_trace_event(name, flowBegin, id)
+#define spargel_trace_flow_step(name, id) _spargel_trace_event(name, flowStep, id)
+#define spargel_trace_flow_end(name, id) _spargel_trace_event(name, flowEnd, id)
+
+#define spargel_trace_scope(name)                                                           \
+    static ::spargel::base::TraceName const _spargel_trace_concat(_trace_name_, __LINE__){ \
+        name};                                                                              \
+    ::spargel::base::RegionTrace _spargel_trace_concat(_trace_scope_, __LINE__)(            \
+        _spargel_trace_concat(_trace_name_, __LINE__))
 #else
 #define spargel_trace_scope(name)
+#define spargel_trace_instant(name) ((void)0)
+// `sizeof` keeps the arguments used without evaluating them.
+#define spargel_trace_counter(name, value) ((void)sizeof(value))
+#define spargel_trace_flow_begin(name, id) ((void)sizeof(id))
+#define spargel_trace_flow_step(name, id) ((void)sizeof(id))
+#define spargel_trace_flow_end(name, id) ((void)sizeof(id))
 #endif
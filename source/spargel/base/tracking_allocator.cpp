@@ -0,0 +1,159 @@
+#include "spargel/base/tracking_allocator.h"
+
+#include "spargel/base/check.h"
+#include "spargel/base/intrinsic.h"
+#include "spargel/base/trace.h"
+
+namespace spargel::base {
+
+    namespace {
+#if SPARGEL_ENABLE_TRACING
+        // Report the heap to the tracer when live bytes cross a multiple of this.
+        constexpr u32 trace_granularity_shift = 16;
+
+        // The tracer allocates too. Do not report its own allocations.
+        thread_local bool in_tracer = false;
+#endif
+
+        usize histogram_bucket(usize size) {
+            if (size == 0) return 0;
+            usize width = static_cast<usize>(GetMostSignificantBit(static_cast<u64>(size))) + 1;
+            return width < AllocationStats::histogram_buckets
+                       ? width
+                       : AllocationStats::histogram_buckets - 1;
+        }
+    }  // namespace
+
+    char const* allocation_tag_name(AllocationTag tag) {
+        switch (tag) {
+        case AllocationTag::untagged:
+            return "untagged";
+        case AllocationTag::vector:
+            return "vector";
+        case AllocationTag::hash_map:
+            return "hash_map";
+        case AllocationTag::string:
+            return "string";
+        case AllocationTag::ecs:
+            return "ecs";
+        case AllocationTag::json:
+            return "json";
+        default:
+            return "?";
+        }
+    }
+
+    TrackingAllocator::TrackingAllocator(Allocator* parent) : _parent{parent} {
+        for (usize i = 0; i < tag_count; i++) {
+            _views[i].owner = this;
+            _views[i].tag = static_cast<AllocationTag>(i);
+        }
+    }
+
+    void* TrackingAllocator::allocate(AllocationTag tag, usize size) {
+        void* p = _parent->allocate(size);
+        usize bucket = histogram_bucket(size);
+        _total.allocations.fetchAdd(1, MemoryOrder::relaxed);
+        _total.histogram[bucket].fetchAdd(1, MemoryOrder::relaxed);
+        auto& c = _tags[static_cast<usize>(tag)];
+        c.allocations.fetchAdd(1, MemoryOrder::relaxed);
+        c.histogram[bucket].fetchAdd(1, MemoryOrder::relaxed);
+        record(tag, static_cast<i64>(size));
+        return p;
+    }
+
+    void* TrackingAllocator::resize(AllocationTag tag, void* ptr, usize old_size,
+                                    usize new_size) {
+        void* p = _parent->resize(ptr, old_size, new_size);
+        _total.resizes.fetchAdd(1, MemoryOrder::relaxed);
+        _tags[static_cast<usize>(tag)].resizes.fetchAdd(1, MemoryOrder::relaxed);
+        record(tag, static_cast<i64>(new_size) - static_cast<i64>(old_size));
+        return p;
+    }
+
+    void TrackingAllocator::free(AllocationTag tag, void* ptr, usize size) {
+        _parent->free(ptr, size);
+        _total.frees.fetchAdd(1, MemoryOrder::relaxed);
+        _tags[static_cast<usize>(tag)].frees.fetchAdd(1, MemoryOrder::relaxed);
+        record(tag, -static_cast<i64>(size));
+    }
+
+    void TrackingAllocator::record(AllocationTag tag, i64 delta) {
+        _tags[static_cast<usize>(tag)].add(delta);
+        i64 after = _total.add(delta);
+        i64 before = after - delta;
+#if SPARGEL_ENABLE_TRACING
+        if ((before >> trace_granularity_shift) != (after >> trace_granularity_shift) &&
+            !in_tracer) {
+            in_tracer = true;
+            spargel_trace_counter("heap", after);
+            in_tracer = false;
+        }
+#else
+        (void)before;
+#endif
+    }
+
+    i64 TrackingAllocator::Counters::add(i64 delta) {
+        i64 live = live_bytes.fetchAdd(delta, MemoryOrder::relaxed) + delta;
+        i64 peak = peak_bytes.load(MemoryOrder::relaxed);
+        while (live > peak &&
+               !peak_bytes.compareExchangeWeak(peak, live, MemoryOrder::relaxed,
+                                               MemoryOrder::relaxed)) {
+        }
+        return live;
+    }
+
+    AllocationStats TrackingAllocator::Counters::snapshot() const {
+        AllocationStats s;
+        s.live_bytes = live_bytes.load(MemoryOrder::relaxed);
+        s.peak_bytes = peak_bytes.load(MemoryOrder::relaxed);
+        s.allocations = allocations.load(MemoryOrder::relaxed);
+        s.resizes = resizes.load(MemoryOrder::relaxed);
+        s.frees = frees.load(MemoryOrder::relaxed);
+        for (usize i = 0; i < AllocationStats::histogram_buckets; i++) {
+            s.histogram[i] = histogram[i].load(MemoryOrder::relaxed);
+        }
+        return s;
+    }
+
+    AllocationStats TrackingAllocator::stats(AllocationTag tag) const {
+        spargel_check(tag < AllocationTag::_count);
+        return _tags[static_cast<usize>(tag)].snapshot();
+    }
+
+    AllocationStats TrackingAllocator::totals() const { return _total.snapshot(); }
+
+    void TrackingAllocator::dump(FILE* out) const {
+        fprintf(out, "%-10s %14s %14s %12s %12s %12s\n", "tag", "live bytes", "peak bytes",
+                "allocs", "resizes", "frees");
+        auto row = [out](char const* name, AllocationStats const& s) {
+            fprintf(out, "%-10s %14lld %14lld %12llu %12llu %12llu\n", name,
+                    static_cast<long long>(s.live_bytes), static_cast<long long>(s.peak_bytes),
+                    static_cast<unsigned long long>(s.allocations),
+                    static_cast<unsigned long long>(s.resizes),
+                    static_cast<unsigned long long>(s.frees));
+        };
+        for (usize i = 0; i < tag_count; i++) {
+            auto s = _tags[i].snapshot();
+            if (s.allocations == 0 && s.live_bytes == 0) continue;
+            row(allocation_tag_name(static_cast<AllocationTag>(i)), s);
+        }
+        auto total = totals();
+        row("total", total);
+
+        fprintf(out, "\n%-20s %12s\n", "allocation size", "count");
+        for (usize i = 1; i < AllocationStats::histogram_buckets; i++) {
+            if (total.histogram[i] == 0) continue;
+            unsigned long long lo = 1ull << (i - 1);
+            if (i + 1 == AllocationStats::histogram_buckets) {
+                fprintf(out, ">= %-17llu %12llu\n", lo,
+                        static_cast<unsigned long long>(total.histogram[i]));
+            } else {
+                fprintf(out, "%8llu - %-9llu %12llu\n", lo, (lo << 1) - 1,
+                        static_cast<unsigned long long>(total.histogram[i]));
+            }
+        }
+    }
+
+}  // namespace spargel::base
@@ -0,0 +1,110 @@
+#pragma once
+
+#include "spargel/base/allocator.h"
+#include "spargel/base/atomic.h"
+#include "spargel/base/types.h"
+
+//
+#include <stdio.h>
+
+namespace spargel::base {
+
+    // A snapshot of the counters of a `TrackingAllocator`.
+    struct AllocationStats {
+        // Bucket `i` counts allocations of `[2^(i-1), 2^i)` bytes, and bucket 0 those of zero
+        // bytes. The last bucket also counts everything larger.
+        static constexpr usize histogram_buckets = 32;
+
+        i64 live_bytes = 0;
+        i64 peak_bytes = 0;
+        u64 allocations = 0;
+        u64 resizes = 0;
+        u64 frees = 0;
+        u64 histogram[histogram_buckets] = {};
+    };
+
+    // TrackingAllocator
+    //
+    // Forwards to a parent allocator and counts live bytes, the peak, calls, and a size
+    // histogram, in total and per `AllocationTag`.
+    //
+    // Setting the environment variable `SPARGEL_TRACK_ALLOCATIONS` makes a tracking allocator
+    // the `default_allocator()` of the process, see `tracking_allocator()`. With the value
+    // `dump`, the statistics are printed to stderr at exit.
+    //
+    // Note:
+    //     - Thread-safe. Every call updates a few shared atomics, so this is for diagnostics,
+    //       not for production builds.
+    //     - With tracing on, live bytes are also reported as the counter track `heap`, at 64 KiB
+    //       granularity.
+    //
+    class TrackingAllocator final : public Allocator {
+    public:
+        explicit TrackingAllocator(Allocator* parent);
+
+        TrackingAllocator(TrackingAllocator const&) = delete;
+        TrackingAllocator& operator=(TrackingAllocator const&) = delete;
+
+        // Untagged allocations.
+        void* allocate(usize size) override { return allocate(AllocationTag::untagged, size); }
+        void* resize(void* ptr, usize old_size, usize new_size) override {
+            return resize(AllocationTag::untagged, ptr, old_size, new_size);
+        }
+        void free(void* ptr, usize size) override { free(AllocationTag::untagged, ptr, size); }
+
+        // A view that accounts its memory to `tag`. Lives as long as this allocator.
+        Allocator* tagged(AllocationTag tag) { return &_views[static_cast<usize>(tag)]; }
+
+        AllocationStats stats(AllocationTag tag) const;
+        AllocationStats totals() const;
+
+        // Print a table of the statistics per tag, and the total size histogram.
+        void dump(FILE* out) const;
+
+    private:
+        static constexpr usize tag_count = static_cast<usize>(AllocationTag::_count);
+
+        struct Counters {
+            Atomic<i64> live_bytes{0};
+            Atomic<i64> peak_bytes{0};
+            Atomic<u64> allocations{0};
+            Atomic<u64> resizes{0};
+            Atomic<u64> frees{0};
+            Atomic<u64> histogram[AllocationStats::histogram_buckets];
+
+            // Add `delta` to the live bytes, raise the peak if needed, and return the new live
+            // bytes.
+            i64 add(i64 delta);
+            AllocationStats snapshot() const;
+        };
+
+        class View final : public Allocator {
+        public:
+            void* allocate(usize size) override { return owner->allocate(tag, size); }
+            void* resize(void* ptr, usize old_size, usize new_size) override {
+                return owner->resize(tag, ptr, old_size, new_size);
+            }
+            void free(void* ptr, usize size) override { owner->free(tag, ptr, size); }
+
+            TrackingAllocator* owner = nullptr;
+            AllocationTag tag = AllocationTag::untagged;
+        };
+
+        void* allocate(AllocationTag tag, usize size);
+        void* resize(AllocationTag tag, void* ptr, usize old_size, usize new_size);
+        void free(AllocationTag tag, void* ptr, usize size);
+
+        void record(AllocationTag tag, i64 delta);
+
+        Allocator* _parent;
+        Counters _total;
+        Counters _tags[tag_count];
+        View _views[tag_count];
+    };
+
+    // The tracking allocator behind `default_allocator()`, or null if tracking is off.
+    TrackingAllocator* tracking_allocator();
+
+    char const* allocation_tag_name(AllocationTag tag);
+
+}  // namespace spargel::base
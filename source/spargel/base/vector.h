@@ -24,13 +24,23 @@ namespace spargel::base {
         /// Questions:
         ///     - Do iterators remain valid when the vector is moved?
         ///       => No.
+        ///     - Which allocator does the vector use after copy/move/swap?
+        ///       => The storage always stays with the allocator that provided it:
+        ///            - copy construction uses the allocator of the source,
+        ///            - copy assignment keeps the allocator of the destination,
+        ///            - move and swap exchange the allocators together with the storage,
+        ///              and a moved-from vector keeps its allocator.
         ///
         template <typename T>
         class vector {
         public:
             vector() {}
 
-            vector(vector const& other) {
+            explicit vector(Allocator* alloc) : _alloc{alloc} { spargel_check(alloc != nullptr); }
+
+            vector(vector const& other) : vector(other, other._alloc) {}
+            vector(vector const& other, Allocator* alloc) : _alloc{alloc} {
+                spargel_check(alloc != nullptr);
                 usize cnt = other.count();
                 if (cnt > 0) {
                     allocate(cnt);
@@ -38,12 +48,16 @@ namespace spargel::base {
                 }
             }
             vector& operator=(vector const& other) {
-                vector tmp(other);
+                vector tmp(other, _alloc);
                 swap(*this, tmp);
                 return *this;
             }
 
-            vector(vector&& other) { swap(*this, other); }
+            vector(vector&& other) : _alloc{other._alloc} {
+                swap(_begin, other._begin);
+                swap(_end, other._end);
+                swap(_capacity, other._capacity);
+            }
             vector& operator=(vector&& other) {
                 vector tmp(move(other));
                 swap(*this, tmp);
@@ -183,18 +197,15 @@ namespace spargel::base {
 
             Span<T> toSpan() const { return Span<T>(_begin, _end); }
 
-            // Allocator* getAllocator() { return _alloc; }
+            Allocator* getAllocator() const { return _alloc; }
 
+            // The allocators are exchanged as well, so that each buffer is always freed by the
+            // allocator that provided it.
             friend void tag_invoke(tag<swap>, vector& lhs, vector& rhs) {
-                // todo: how to compare allocator?
-                // if (lhs._alloc == rhs._alloc) [[likely]] {
                 swap(lhs._begin, rhs._begin);
                 swap(lhs._end, rhs._end);
                 swap(lhs._capacity, rhs._capacity);
-                // } else [[unlikely]] {
-                //   spargel_log_fatal("unimplemented: swapping vectors with different allocators");
-                //   spargel_panic_here();
-                // }
+                swap(lhs._alloc, rhs._alloc);
             }
 
         private:
@@ -215,18 +226,17 @@ namespace spargel::base {
 #if spargel_has_builtin(__is_trivially_copyable)
                 if constexpr (__is_trivially_copyable(T)) {
                     if (_begin == nullptr) {
-                        new_begin = static_cast<T*>(
-                            default_allocator()->allocate(sizeof(T) * new_capacity));
+                        new_begin =
+                            static_cast<T*>(_alloc->allocate(sizeof(T) * new_capacity));
                     } else {
-                        new_begin = static_cast<T*>(default_allocator()->resize(
+                        new_begin = static_cast<T*>(_alloc->resize(
                             _begin, capacity() * sizeof(T), sizeof(T) * new_capacity));
                     }
                 } else
 #endif
                 {
 
-                    new_begin =
-                        static_cast<T*>(default_allocator()->allocate(sizeof(T) * new_capacity));
+                    new_begin = static_cast<T*>(_alloc->allocate(sizeof(T) * new_capacity));
                     if (_begin != nullptr) [[likely]] {
 #if spargel_has_builtin(__builtin_is_cpp_trivially_relocatable)
                         if constexpr (__builtin_is_cpp_trivially_relocatable(T)) {
@@ -262,12 +272,12 @@ namespace spargel::base {
             }
 
             void allocate(usize capacity) {
-                _begin = static_cast<T*>(default_allocator()->allocate(sizeof(T) * capacity));
+                _begin = static_cast<T*>(_alloc->allocate(sizeof(T) * capacity));
                 _end = _begin;
                 _capacity = _begin + capacity;
             }
 
-            void deallocate() { default_allocator()->free(_begin, sizeof(T) * capacity()); }
+            void deallocate() { _alloc->free(_begin, sizeof(T) * capacity()); }
 
             void copyRange(T const* begin, T const* end) {
                 for (; begin < end; begin++, _end++) {
@@ -278,7 +288,7 @@ namespace spargel::base {
             T* _begin = nullptr;
             T* _end = nullptr;
             T* _capacity = nullptr;
-            // Allocator* _alloc = default_allocator();
+            Allocator* _alloc = tagged_allocator(AllocationTag::vector);
         };
 
     }  // namespace __vector
@@ -1,11 +1,33 @@
 #include "spargel/base/vector.h"
 
+#include "spargel/base/allocator.h"
 #include "spargel/base/check.h"
 #include "spargel/base/meta.h"
 #include "spargel/base/test.h"
 
 namespace spargel::base {
     namespace {
+        class CountingAlloc final : public Allocator {
+        public:
+            ~CountingAlloc() { spargel_check(bytes == 0); }
+
+            void* allocate(usize size) override {
+                bytes += size;
+                return default_allocator()->allocate(size);
+            }
+            void* resize(void* ptr, usize old_size, usize new_size) override {
+                bytes = bytes - old_size + new_size;
+                return default_allocator()->resize(ptr, old_size, new_size);
+            }
+            void free(void* ptr, usize size) override {
+                spargel_check(bytes >= size);
+                bytes -= size;
+                default_allocator()->free(ptr, size);
+            }
+
+            usize bytes = 0;
+        };
+
         TEST(Vector_Basic) {
             vector<int> v1;
             spargel_check(v1.count() == 0);
@@ -54,5 +76,43 @@ namespace spargel::base {
             x.eraseIfFast([](int n) { return n % 2 == 0; });
             spargel_check(x.count() == 5);
         }
+
+        TEST(Vector_Allocator) {
+            CountingAlloc a1;
+            CountingAlloc a2;
+            {
+                vector<int> x(&a1);
+                for (int i = 0; i < 100; i++) {
+                    x.push(i);
+                }
+                spargel_check(x.getAllocator() == &a1);
+                spargel_check(a1.bytes >= 100 * sizeof(int));
+
+                // Copy construction follows the source.
+                vector<int> y(x);
+                spargel_check(y.getAllocator() == &a1);
+
+                // Copy assignment keeps the destination.
+                vector<int> z(&a2);
+                z = x;
+                spargel_check(z.getAllocator() == &a2);
+                spargel_check(z.count() == 100);
+                spargel_check(a2.bytes >= 100 * sizeof(int));
+
+                // Swap exchanges allocators with the storage.
+                swap(x, z);
+                spargel_check(x.getAllocator() == &a2);
+                spargel_check(z.getAllocator() == &a1);
+
+                // Moved-from vectors keep their allocator.
+                vector<int> w(move(x));
+                spargel_check(w.getAllocator() == &a2);
+                spargel_check(x.getAllocator() == &a2);  // NOLINT(clang-analyzer-cplusplus.Move)
+                spargel_check(x.count() == 0);           // NOLINT(clang-analyzer-cplusplus.Move)
+                x.push(1);
+            }
+            spargel_check(a1.bytes == 0);
+            spargel_check(a2.bytes == 0);
+        }
     }  // namespace
 }  // namespace spargel::base
@@ -11,6 +11,7 @@
 #include "spargel/base/meta.h"
 #include "spargel/base/optional.h"
 #include "spargel/base/string.h"
+#include "spargel/base/string_builder.h"
 #include "spargel/base/tuple.h"
 #include "spargel/base/vector.h"
 
@@ -20,6 +21,7 @@ namespace spargel::codec {
     class CodecError {
     public:
         CodecError(const base::String& message) { append(message.view()); }
+        CodecError(base::String&& message) { messages_.push(base::move(message)); }
         CodecError(base::StringView message) { append(message); }
 
         const base::String& message() {
@@ -572,7 +574,7 @@ namespace spargel::codec {
                     return decoder.decode(backend, base::move(result.left().value()));
                 } else {
                     return base::Right(
-                        ErrorType<DB>(base::String("cannot find member '") + name + '\''));
+                        ErrorType<DB>(base::concat("cannot find member '", name, '\'')));
                 }
             } else {
                 return base::Right(base::move(result.right()));
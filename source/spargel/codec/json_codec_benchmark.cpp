@@ -0,0 +1,90 @@
+#include "spargel/base/benchmark.h"
+#include "spargel/base/check.h"
+#include "spargel/base/functional.h"
+#include "spargel/base/string_view.h"
+#include "spargel/base/vector.h"
+#include "spargel/codec/codec.h"
+#include "spargel/codec/json_codec.h"
+#include "spargel/json/json_parser.h"
+#include "spargel/json/json_value.h"
+
+// libc
+#include <stdio.h>
+#include <string.h>
+
+using namespace spargel::base::literals;
+
+namespace spargel::codec {
+
+    namespace {
+
+        using namespace json;
+
+        struct Texture {
+            base::String name;
+            base::Optional<base::String> label;
+            u32 width;
+            u32 height;
+            bool srgb;
+            base::vector<f32> scales;
+
+            static auto codec() {
+                return makeRecordCodec<Texture>(
+                    base::Constructor<Texture>{},
+                    makeNormalField<Texture>("name"_sv, StringCodec{},
+                                             [](auto& o) { return o.name; }),
+                    makeOptionalField<Texture>("label"_sv, StringCodec{},
+                                               [](auto& o) { return o.label; }),
+                    makeNormalField<Texture>("width"_sv, U32Codec{},
+                                             [](auto& o) { return o.width; }),
+                    makeNormalField<Texture>("height"_sv, U32Codec{},
+                                             [](auto& o) { return o.height; }),
+                    makeNormalField<Texture>("srgb"_sv, BooleanCodec{},
+                                             [](auto& o) { return o.srgb; }),
+                    makeNormalField<Texture>("scales"_sv, makeVectorCodec(F32Codec{}),
+                                             [](auto& o) { return o.scales; }));
+            }
+        };
+
+        JsonValue make_document(u32 records) {
+            base::vector<char> text;
+            auto append = [&text](char const* s) {
+                usize length = strlen(s);
+                for (usize i = 0; i < length; i++) {
+                    text.push(s[i]);
+                }
+            };
+            append("[");
+            for (u32 i = 0; i < records; i++) {
+                char buf[256];
+                snprintf(buf, sizeof(buf),
+                         "%s{\"name\": \"texture_%u\", %s\"width\": %u, \"height\": %u, "
+                         "\"srgb\": %s, \"scales\": [1, 0.5, 0.25]}",
+                         i == 0 ? "" : ",", i, i % 3 == 0 ? "\"label\": \"ui\", " : "",
+                         64 + i % 512, 32 + i % 256, i % 2 == 0 ? "true" : "false");
+                append(buf);
+            }
+            append("]");
+            auto result = parseJson(text.data(), text.count());
+            spargel_check(result.isLeft());
+            return base::move(result.left());
+        }
+
+        void decode_document(base::BenchmarkState& state, u32 records) {
+            auto doc = make_document(records);
+            auto codec = makeVectorCodec(Texture::codec());
+            JsonDecodeBackend backend;
+            state.setItemsPerIteration(records);
+            while (state.keepRunning()) {
+                auto result = codec.decode(backend, doc);
+                base::do_not_optimize(result);
+            }
+        }
+
+        BENCHMARK(JsonCodec_DecodeRecord) { decode_document(state, 1); }
+
+        BENCHMARK(JsonCodec_DecodeRecords) { decode_document(state, 1024); }
+
+    }  // namespace
+
+}  // namespace spargel::codec
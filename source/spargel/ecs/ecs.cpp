@@ -1,6 +1,9 @@
 #include "spargel/ecs/ecs.h"
 
 #include "spargel/base/allocator.h"
+#include "spargel/base/hash.h"
+#include "spargel/base/hash_map.h"
+#include "spargel/base/intrinsic.h"
 #include "spargel/base/object.h"
 #include "spargel/base/types.h"
 #include "spargel/base/vector.h"
@@ -11,22 +14,105 @@
 
 namespace spargel::ecs {
 
+    namespace {
+        base::Allocator* ecs_allocator() {
+            return base::tagged_allocator(base::AllocationTag::ecs);
+        }
+
+        /* the size of a chunk, unless a single entity does not fit */
+        constexpr ssize chunk_size = 16 * 1024;
+        /* the alignment of the arrays in a chunk */
+        constexpr ssize chunk_alignment = 16;
+        /* the pool allocates chunks of chunk_size this many at a time */
+        constexpr ssize chunks_per_block = 64;
+    }  // namespace
+
+    /**
+     * @brief a block holding up to chunk_capacity entities of an archetype
+     *
+     * The entity ids follow the header, then one array of chunk_capacity items per component, at
+     * the offsets in the column map of the archetype. Chunks of chunk_size bytes come from the
+     * pool of the world, and go back to it when emptied.
+     *
+     * How many entities a chunk has follows from its archetype, so that a view of a chunk does
+     * not touch it.
+     */
+    struct chunk {
+        /* the next chunk in the pool */
+        struct chunk* next;
+    };
+
     struct archetype {
-        ssize col_count;
-        ssize col_capacity;
-        entity_id* entities;
+        /* over all chunks; every chunk but the last is full */
+        ssize entity_count;
+        ssize chunk_count;
+        struct chunk** chunks;
+        ssize chunk_list_capacity;
+        /* entities per chunk */
+        ssize chunk_capacity;
+        /* chunk_size, or more if one entity does not fit in it */
+        ssize chunk_bytes;
+        /* component id -> byte offset of its array in a chunk, or -1; covers the ids below
+         * column_map_size */
+        ssize* columns;
+        ssize column_map_size;
         ssize row_count;
+        /* sorted in ascending order */
         component_id* component_ids;
-        void** components;
+        /* the components as a bitset, see build_signature() */
+        u64* signature;
+        ssize signature_size;
+        /* the next archetype whose signature hashes the same, or -1 */
+        ssize next_with_hash;
+    };
+
+    /**
+     * @brief the archetypes having all of a set of components
+     *
+     * The list only grows: archetypes are never removed, and their components never change. So
+     * a cached query is brought up to date by checking the archetypes created since.
+     */
+    struct query_cache {
+        /* the next query whose signature hashes the same, or -1 */
+        ssize next_with_hash = -1;
+        base::vector<u64> signature{ecs_allocator()};
+        /* the matching archetypes, in ascending order */
+        base::vector<ssize> archetypes{ecs_allocator()};
+        /* archetypes with a smaller id have been checked */
+        ssize checked_count = 0;
+        /* the position in archetypes that the last lookup stopped at */
+        ssize cursor = 0;
     };
 
+    /**
+     * @brief an archetype and a component to add to or remove from it
+     */
+    struct archetype_edge {
+        ssize archetype_id;
+        component_id component;
+
+        friend bool operator==(archetype_edge const& lhs, archetype_edge const& rhs) {
+            return lhs.archetype_id == rhs.archetype_id && lhs.component == rhs.component;
+        }
+        static constexpr bool trivially_hashable = true;
+    };
+
+    /**
+     * @brief a slot for an entity
+     *
+     * A free slot has archetype_id -1, and index is the next free slot, or -1.
+     */
     struct entity_info {
         ssize archetype_id;
         ssize index;
+        /* of the entity in the slot, or of the next one if the slot is free */
+        u32 generation;
     };
 
     struct world {
-        base::vector<entity_info> entities;
+        base::vector<entity_info> entities{ecs_allocator()};
+        /* the free slot in entities to use first, or -1 */
+        ssize free_entity = -1;
         struct {
             ssize* sizes = nullptr;
             ssize count = 0;
@@ -35,11 +121,26 @@ namespace spargel::ecs {
         struct archetype* archetypes = nullptr;
         ssize archetype_count = 0;
         ssize archetype_capacity = 0;
+        /* signature hash -> the first archetype with it */
+        base::HashMap<u64, ssize> archetype_index{ecs_allocator()};
+        base::vector<query_cache> queries{ecs_allocator()};
+        /* signature hash -> the first query with it */
+        base::HashMap<u64, ssize> query_index{ecs_allocator()};
+        /* the archetype an entity moves to when it gains or loses a component */
+        base::HashMap<archetype_edge, ssize> add_edges{ecs_allocator()};
+        base::HashMap<archetype_edge, ssize> remove_edges{ecs_allocator()};
+        /* the query looked up last; a loop over a view repeats it */
+        ssize last_query = -1;
+        /* scratch space for build_signature() */
+        base::vector<u64> signature{ecs_allocator()};
+        /* chunks of chunk_size bytes that no archetype uses */
+        struct chunk* free_chunks = nullptr;
+        /* what the pool allocated, each of chunks_per_block chunks */
+        base::vector<void*> chunk_blocks{ecs_allocator()};
     };
 
     world_id create_world() {
-        struct world* world =
-            (struct world*)base::default_allocator()->allocate(sizeof(struct world));
+        struct world* world = (struct world*)ecs_allocator()->allocate(sizeof(struct world));
         base::construct_at<struct world>(world);
         return world;
     }
@@ -48,31 +149,50 @@ namespace spargel::ecs {
         if (!world) return;
         for (ssize i = 0; i < world->archetype_count; i++) {
             struct archetype* archetype = &world->archetypes[i];
-            for (ssize j = 0; j < archetype->row_count; j++) {
-                if (archetype->components[j])
-                    base::default_allocator()->free(
-                        archetype->components[j],
-                        world->components.sizes[archetype->component_ids[j]] *
-                            archetype->col_capacity);
+            if (archetype->chunk_bytes != chunk_size) {
+                for (ssize j = 0; j < archetype->chunk_count; j++) {
+                    ecs_allocator()->free(archetype->chunks[j], archetype->chunk_bytes);
+                }
             }
-            if (archetype->entities)
-                base::default_allocator()->free(archetype->entities,
-                                                sizeof(entity_id) * archetype->col_capacity);
+            if (archetype->chunks)
+                ecs_allocator()->free(archetype->chunks,
+                                      sizeof(struct chunk*) * archetype->chunk_list_capacity);
             if (archetype->component_ids)
-                base::default_allocator()->free(archetype->component_ids,
-                                                sizeof(component_id) * archetype->row_count);
-            if (archetype->components)
-                base::default_allocator()->free(archetype->components,
-                                                sizeof(void*) * archetype->row_count);
+                ecs_allocator()->free(archetype->component_ids,
+                                      sizeof(component_id) * archetype->row_count);
+            if (archetype->signature)
+                ecs_allocator()->free(archetype->signature,
+                                      sizeof(u64) * archetype->signature_size);
+            if (archetype->columns)
+                ecs_allocator()->free(archetype->columns,
+                                      sizeof(ssize) * archetype->column_map_size);
         }
         if (world->components.sizes)
-            base::default_allocator()->free(world->components.sizes,
-                                            sizeof(ssize) * world->components.capacity);
+            ecs_allocator()->free(world->components.sizes,
+                                  sizeof(ssize) * world->components.capacity);
         if (world->archetypes)
-            base::default_allocator()->free(world->archetypes,
-                                            sizeof(struct archetype) * world->archetype_capacity);
+            ecs_allocator()->free(world->archetypes,
+                                  sizeof(struct archetype) * world->archetype_capacity);
+        for (void* block : world->chunk_blocks) {
+            ecs_allocator()->free(block, chunk_size * chunks_per_block);
+        }
         base::destruct_at<struct world>(world);
-        base::default_allocator()->free(world, sizeof(struct world));
+        ecs_allocator()->free(world, sizeof(struct world));
+    }
+
+    /**
+     * @brief allocate a block, or return NULL if it is empty
+     */
+    static void* allocate_array(ssize size) {
+        return size > 0 ? ecs_allocator()->allocate(size) : NULL;
+    }
+
+    /**
+     * @brief resize a block, or allocate it if there is none yet
+     */
+    static void* reallocate(void* ptr, ssize old_size, ssize new_size) {
+        if (!ptr) return ecs_allocator()->allocate(new_size);
+        return ecs_allocator()->resize(ptr, old_size, new_size);
     }
 
     /**
@@ -86,7 +206,7 @@ namespace spargel::ecs {
         ssize cap2 = *capacity * 2;
         ssize new_cap = cap2 > need ? cap2 : need;
         if (new_cap < 8) new_cap = 8;
-        *ptr = base::default_allocator()->resize(*ptr, *capacity * stride, new_cap * stride);
+        *ptr = reallocate(*ptr, *capacity * stride, new_cap * stride);
         *capacity = new_cap;
     }
 
@@ -103,41 +223,115 @@ namespace spargel::ecs {
         return RESULT_SUCCESS;
     }
 
-    static bool is_subset(ssize count1, component_id const* id1, ssize count2,
-                          component_id const* id2) {
-        if (count1 > count2) return false;
-        for (ssize i = 0; i < count1; i++) {
-            bool found = false;
-            for (ssize j = 0; j < count2; j++) {
-                if (id1[i] == id2[j]) {
-                    found = true;
-                    break;
-                }
+    /**
+     * @brief build the bitset of a set of components in world->signature
+     * @return false if a component appears twice
+     *
+     * Bit i % 64 of word i / 64 is set for component i. The bitset ends at the word of the
+     * largest component, so that equal sets have equal bitsets.
+     */
+    static bool build_signature(world_id world, ssize count, component_id const* ids) {
+        // The first word is built along with the size, in one pass.
+        component_id max_id = 0;
+        u64 first = 0;
+        for (ssize i = 0; i < count; i++) {
+            component_id id = ids[i];
+            if (id > max_id) max_id = id;
+            if (id >= 64) continue;
+            u64 bit = u64{1} << id;
+            if (first & bit) return false;
+            first |= bit;
+        }
+        ssize size = count > 0 ? (ssize)(max_id / 64) + 1 : 0;
+        base::vector<u64>& signature = world->signature;
+        signature.reserve(size);
+        u64* words = signature.data();
+        if (size > 0) words[0] = first;
+        for (ssize w = 1; w < size; w++) {
+            u64 bits = 0;
+            for (ssize i = 0; i < count; i++) {
+                if ((ssize)(ids[i] / 64) != w) continue;
+                u64 bit = u64{1} << (ids[i] % 64);
+                if (bits & bit) return false;
+                bits |= bit;
             }
-            if (!found) return false;
+            words[w] = bits;
+        }
+        signature.set_count(size);
+        return true;
+    }
+
+    static u64 hash_signature(ssize size, u64 const* words) {
+        base::HashRun run;
+        for (ssize i = 0; i < size; i++) {
+            run.combine(words[i]);
+        }
+        return run.result();
+    }
+
+    static bool same_signature(ssize size1, u64 const* words1, ssize size2, u64 const* words2) {
+        if (size1 != size2) return false;
+        for (ssize i = 0; i < size1; i++) {
+            if (words1[i] != words2[i]) return false;
         }
         return true;
     }
 
     /**
-     * @brief find the archetype with the given set of components
+     * @brief whether every component of the first signature is in the second
      */
-    static ssize find_archetype(world_id world, ssize count, component_id const* ids) {
-        ssize result = -1;
-        for (ssize i = 0; i < world->archetype_count; i++) {
+    static bool is_subset(ssize size1, u64 const* words1, ssize size2, u64 const* words2) {
+        // The last word of a signature is not zero.
+        if (size1 > size2) return false;
+        for (ssize i = 0; i < size1; i++) {
+            if (words1[i] & ~words2[i]) return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief find the archetype with the given signature
+     */
+    static ssize find_archetype(world_id world, u64 hash, ssize size, u64 const* words) {
+        ssize* first = world->archetype_index.get(hash);
+        if (!first) return -1;
+        for (ssize i = *first; i >= 0; i = world->archetypes[i].next_with_hash) {
             struct archetype* archetype = &world->archetypes[i];
-            if (archetype->row_count != count) continue;
-            if (is_subset(count, ids, archetype->row_count, archetype->component_ids) &&
-                is_subset(archetype->row_count, archetype->component_ids, count, ids)) {
-                result = i;
-                break;
+            if (same_signature(size, words, archetype->signature_size, archetype->signature)) {
+                return i;
             }
         }
-        return result;
+        return -1;
+    }
+
+    static ssize align_up(ssize n, ssize alignment) {
+        return (n + alignment - 1) / alignment * alignment;
+    }
+
+    /**
+     * @brief fit as many entities of an archetype as possible in a chunk
+     */
+    static void layout_chunks(world_id world, struct archetype* archetype) {
+        ssize entity_size = sizeof(entity_id);
+        for (ssize i = 0; i < archetype->row_count; i++) {
+            entity_size += world->components.sizes[archetype->component_ids[i]];
+        }
+        // Leave room for aligning each component array.
+        ssize room = chunk_size - (ssize)sizeof(struct chunk) -
+                     chunk_alignment * archetype->row_count;
+        ssize capacity = room / entity_size;
+        if (capacity < 1) capacity = 1;
+        ssize offset = sizeof(struct chunk) + sizeof(entity_id) * capacity;
+        for (ssize i = 0; i < archetype->row_count; i++) {
+            offset = align_up(offset, chunk_alignment);
+            archetype->columns[archetype->component_ids[i]] = offset;
+            offset += world->components.sizes[archetype->component_ids[i]] * capacity;
+        }
+        archetype->chunk_capacity = capacity;
+        archetype->chunk_bytes = offset > chunk_size ? offset : chunk_size;
     }
 
-    static ssize create_archetype(world_id world, ssize component_count,
-                                  component_id const* component_ids) {
+    static ssize create_archetype(world_id world, u64 hash, ssize size, u64 const* words) {
         if (world->archetype_count + 1 > world->archetype_capacity) {
             grow_array((void**)&world->archetypes, &world->archetype_capacity,
                        sizeof(struct archetype), world->archetype_count + 1);
@@ -145,123 +339,439 @@ namespace spargel::ecs {
         ssize id = world->archetype_count;
         world->archetype_count++;
         struct archetype* archetype = &world->archetypes[id];
-        archetype->col_count = 0;
-        archetype->col_capacity = 0;
-        archetype->entities = NULL;
+        archetype->entity_count = 0;
+        archetype->chunk_count = 0;
+        archetype->chunks = NULL;
+        archetype->chunk_list_capacity = 0;
+
+        ssize component_count = 0;
+        for (ssize i = 0; i < size; i++) {
+            for (u64 w = words[i]; w; w &= w - 1) component_count++;
+        }
         archetype->row_count = component_count;
-        archetype->component_ids = (component_id*)base::default_allocator()->allocate(
-            sizeof(component_id) * component_count);
-        memcpy(archetype->component_ids, component_ids, sizeof(component_id) * component_count);
-        archetype->components =
-            (void**)base::default_allocator()->allocate(sizeof(void*) * component_count);
-        memset(archetype->components, 0, sizeof(void*) * component_count);
+        archetype->component_ids =
+            (component_id*)allocate_array(sizeof(component_id) * component_count);
+
+        archetype->signature_size = size;
+        archetype->signature = (u64*)allocate_array(sizeof(u64) * size);
+        for (ssize i = 0; i < size; i++) {
+            archetype->signature[i] = words[i];
+        }
+
+        archetype->column_map_size =
+            size > 0 ? (size - 1) * 64 + base::GetMostSignificantBit(words[size - 1]) + 1 : 0;
+        archetype->columns =
+            (ssize*)allocate_array(sizeof(ssize) * archetype->column_map_size);
+        for (ssize i = 0; i < archetype->column_map_size; i++) {
+            archetype->columns[i] = -1;
+        }
+        ssize row = 0;
+        for (ssize i = 0; i < size; i++) {
+            for (u64 w = words[i]; w; w &= w - 1) {
+                archetype->component_ids[row] = i * 64 + base::CountTrailingZeros(w);
+                row++;
+            }
+        }
+
+        layout_chunks(world, archetype);
+
+        ssize& first = world->archetype_index.getOrConstruct(hash, -1);
+        archetype->next_with_hash = first;
+        first = id;
         return id;
     }
 
+    static ssize chunk_entity_count(struct archetype* archetype, ssize chunk_id) {
+        if (chunk_id + 1 < archetype->chunk_count) return archetype->chunk_capacity;
+        return archetype->entity_count - chunk_id * archetype->chunk_capacity;
+    }
+
+    static entity_id* chunk_entities(struct chunk* chunk) { return (entity_id*)(chunk + 1); }
+
+    static char* chunk_column(struct archetype* archetype, struct chunk* chunk, component_id c) {
+        return (char*)chunk + archetype->columns[c];
+    }
+
+    /**
+     * @brief add a block of chunks to the pool
+     *
+     * Chunks are allocated in blocks so that they do not end up between the small allocations of
+     * the world, which a query walks through.
+     */
+    static void refill_pool(world_id world) {
+        char* block = (char*)ecs_allocator()->allocate(chunk_size * chunks_per_block);
+        world->chunk_blocks.emplace(block);
+        for (ssize i = chunks_per_block - 1; i >= 0; i--) {
+            struct chunk* chunk = (struct chunk*)(block + chunk_size * i);
+            chunk->next = world->free_chunks;
+            world->free_chunks = chunk;
+        }
+    }
+
+    /**
+     * @brief add an empty chunk to an archetype
+     */
+    static struct chunk* acquire_chunk(world_id world, struct archetype* archetype) {
+        struct chunk* chunk;
+        if (archetype->chunk_bytes == chunk_size) {
+            if (!world->free_chunks) refill_pool(world);
+            chunk = world->free_chunks;
+            world->free_chunks = chunk->next;
+        } else {
+            chunk = (struct chunk*)ecs_allocator()->allocate(archetype->chunk_bytes);
+        }
+        chunk->next = NULL;
+        if (archetype->chunk_count + 1 > archetype->chunk_list_capacity) {
+            grow_array((void**)&archetype->chunks, &archetype->chunk_list_capacity,
+                       sizeof(struct chunk*), archetype->chunk_count + 1);
+        }
+        archetype->chunks[archetype->chunk_count] = chunk;
+        archetype->chunk_count++;
+        return chunk;
+    }
+
+    /**
+     * @brief remove the last chunk of an archetype, which is empty
+     */
+    static void release_last_chunk(world_id world, struct archetype* archetype) {
+        archetype->chunk_count--;
+        struct chunk* chunk = archetype->chunks[archetype->chunk_count];
+        if (archetype->chunk_bytes == chunk_size) {
+            chunk->next = world->free_chunks;
+            world->free_chunks = chunk;
+        } else {
+            ecs_allocator()->free(chunk, archetype->chunk_bytes);
+        }
+    }
+
     int spawn_entities(world_id world, struct spawn_descriptor* desc, struct view* view) {
-        ssize archetype_id = find_archetype(world, desc->component_count, desc->components);
+        if (!build_signature(world, desc->component_count, desc->components)) {
+            return RESULT_DUPLICATE_COMPONENT;
+        }
+        ssize size = world->signature.count();
+        u64 const* words = world->signature.begin();
+        u64 hash = hash_signature(size, words);
+        ssize archetype_id = find_archetype(world, hash, size, words);
         if (archetype_id < 0) {
-            archetype_id = create_archetype(world, desc->component_count, desc->components);
+            archetype_id = create_archetype(world, hash, size, words);
         }
         struct archetype* archetype = &world->archetypes[archetype_id];
-        if (archetype->col_count + desc->entity_count > archetype->col_capacity) {
-            ssize old_capacity = archetype->col_capacity;
-            grow_array((void**)&archetype->entities, &archetype->col_capacity, sizeof(entity_id),
-                       archetype->col_count + desc->entity_count);
-            for (ssize i = 0; i < archetype->row_count; i++) {
-                archetype->components[i] = base::default_allocator()->resize(
-                    archetype->components[i],
-                    world->components.sizes[archetype->component_ids[i]] * old_capacity,
-                    world->components.sizes[archetype->component_ids[i]] * archetype->col_capacity);
+        view->archetype_id = archetype_id;
+        if (desc->entity_count == 0) {
+            view->chunk_id = 0;
+            view->entity_count = 0;
+            view->entities = NULL;
+            for (ssize i = 0; i < desc->component_count; i++) {
+                view->components[i] = NULL;
             }
+            return RESULT_SUCCESS;
         }
-        ssize offset = archetype->col_count;
-        archetype->col_count += desc->entity_count;
 
-        view->archetype_id = archetype_id;
-        view->entity_count = desc->entity_count;
+        if (archetype->entity_count == archetype->chunk_count * archetype->chunk_capacity) {
+            acquire_chunk(world, archetype);
+        }
+        struct chunk* chunk = archetype->chunks[archetype->chunk_count - 1];
+        ssize offset = chunk_entity_count(archetype, archetype->chunk_count - 1);
+        ssize room = archetype->chunk_capacity - offset;
+        ssize count = desc->entity_count < room ? desc->entity_count : room;
+        ssize first_index = archetype->entity_count;
+        archetype->entity_count += count;
+
+        view->chunk_id = archetype->chunk_count - 1;
+        view->entity_count = count;
 
-        world->entities.reserve(world->entities.count() + desc->entity_count);
+        if (world->free_entity < 0) world->entities.reserve(world->entities.count() + count);
 
-        view->entities = archetype->entities + offset;
-        for (ssize i = 0; i < desc->entity_count; i++) {
-            ssize entity = world->entities.count();
-            view->entities[i] = entity;
-            world->entities.emplace(archetype_id, offset + i);
+        view->entities = chunk_entities(chunk) + offset;
+        for (ssize i = 0; i < count; i++) {
+            ssize slot = world->free_entity;
+            if (slot >= 0) {
+                entity_info* info = &world->entities[slot];
+                world->free_entity = info->index;
+                info->archetype_id = archetype_id;
+                info->index = first_index + i;
+            } else {
+                slot = world->entities.count();
+                world->entities.emplace(archetype_id, first_index + i, 0u);
+            }
+            view->entities[i] = ((u64)world->entities[slot].generation << 32) | (u64)slot;
         }
 
         for (ssize i = 0; i < desc->component_count; i++) {
-            ssize j = 0;
-            for (; j < archetype->row_count; j++) {
-                if (desc->components[i] == archetype->component_ids[j]) break;
-            }
-            view->components[i] = (char*)archetype->components[j] +
-                                  offset * world->components.sizes[archetype->component_ids[j]];
+            component_id c = desc->components[i];
+            view->components[i] = chunk_column(archetype, chunk, c) +
+                                  offset * world->components.sizes[c];
         }
-        return RESULT_SUCCESS;
+        return count < desc->entity_count ? RESULT_INCOMPLETE : RESULT_SUCCESS;
+    }
+
+    /**
+     * @brief find the query with the given signature, or create an empty one
+     */
+    static ssize lookup_query(world_id world, ssize size, u64 const* words) {
+        u64 hash = hash_signature(size, words);
+        ssize& first = world->query_index.getOrConstruct(hash, -1);
+        ssize index = first;
+        while (index >= 0) {
+            struct query_cache* q = &world->queries[index];
+            if (same_signature(size, words, q->signature.count(), q->signature.begin()))
+                return index;
+            index = q->next_with_hash;
+        }
+        index = world->queries.count();
+        world->queries.emplace();
+        struct query_cache* q = &world->queries[index];
+        q->next_with_hash = first;
+        q->signature.reserve(size);
+        for (ssize i = 0; i < size; i++) {
+            q->signature.emplace(words[i]);
+        }
+        first = index;
+        return index;
     }
 
-    static ssize find_base_archetype(world_id world, ssize component_count,
-                                     component_id const* component_ids, u64 start_archetype) {
-        ssize i = start_archetype;
-        ssize result = -1;
-        while (i < world->archetype_count) {
-            if (is_subset(component_count, component_ids, world->archetypes[i].row_count,
-                          world->archetypes[i].component_ids)) {
-                result = i;
-                break;
+    /**
+     * @brief find or create the cache of a signature, and bring it up to date
+     */
+    static struct query_cache* find_query(world_id world, ssize size, u64 const* words) {
+        ssize index = world->last_query;
+        if (index >= 0) {
+            struct query_cache* q = &world->queries[index];
+            if (!same_signature(size, words, q->signature.count(), q->signature.begin()))
+                index = -1;
+        }
+        if (index < 0) index = lookup_query(world, size, words);
+        world->last_query = index;
+
+        struct query_cache* q = &world->queries[index];
+        for (; q->checked_count < world->archetype_count; q->checked_count++) {
+            struct archetype* archetype = &world->archetypes[q->checked_count];
+            if (is_subset(size, words, archetype->signature_size, archetype->signature)) {
+                q->archetypes.emplace(q->checked_count);
             }
-            i++;
         }
-        return result;
+        return q;
     }
 
-    int query(world_id world, struct query_descriptor* desc, struct view* view) {
-        ssize archetype_id = find_base_archetype(world, desc->component_count, desc->components,
-                                                 desc->start_archetype_id);
-        if (archetype_id < 0) return RESULT_QUERY_END;
+    /**
+     * @brief find the first archetype not before start_archetype that has the given components
+     */
+    static ssize find_base_archetype(world_id world, ssize size, u64 const* words,
+                                     u64 start_archetype) {
+        struct query_cache* q = find_query(world, size, words);
+        ssize count = q->archetypes.count();
+        // A loop over the views asks for the last match again, for its next chunk, or for the
+        // match after it.
+        ssize cursor = q->cursor;
+        if (cursor < count && (u64)q->archetypes[cursor] >= start_archetype &&
+            (cursor == 0 || (u64)q->archetypes[cursor - 1] < start_archetype)) {
+            return q->archetypes[cursor];
+        }
+        ssize next = cursor + 1;
+        if (next <= count && (u64)q->archetypes[next - 1] < start_archetype &&
+            (next == count || (u64)q->archetypes[next] >= start_archetype)) {
+            q->cursor = next;
+            return next < count ? q->archetypes[next] : -1;
+        }
+        // The first match not less than start_archetype.
+        ssize lo = 0;
+        ssize hi = count;
+        while (lo < hi) {
+            ssize mid = lo + (hi - lo) / 2;
+            if ((u64)q->archetypes[mid] < start_archetype)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        q->cursor = lo;
+        return lo < count ? q->archetypes[lo] : -1;
+    }
 
-        struct archetype* archetype = &world->archetypes[archetype_id];
+    int query(world_id world, struct query_descriptor* desc, struct view* view) {
+        if (!build_signature(world, desc->component_count, desc->components)) {
+            return RESULT_DUPLICATE_COMPONENT;
+        }
+        u64 start_archetype = desc->start_archetype_id;
+        u64 start_chunk = desc->start_chunk_id;
+        // Past the last chunk of an archetype, which is where a loop over the views goes next.
+        if (start_chunk > 0 && start_archetype < (u64)world->archetype_count &&
+            start_chunk >= (u64)world->archetypes[start_archetype].chunk_count) {
+            start_archetype++;
+            start_chunk = 0;
+        }
+        ssize archetype_id;
+        struct archetype* archetype;
+        // Archetypes without entities have no chunks, hence no views.
+        while (true) {
+            archetype_id = find_base_archetype(world, world->signature.count(),
+                                               world->signature.begin(), start_archetype);
+            if (archetype_id < 0) return RESULT_QUERY_END;
+            archetype = &world->archetypes[archetype_id];
+            if ((u64)archetype_id != start_archetype) start_chunk = 0;
+            if (start_chunk < (u64)archetype->chunk_count) break;
+            start_archetype = archetype_id + 1;
+            start_chunk = 0;
+        }
+        struct chunk* chunk = archetype->chunks[start_chunk];
 
         view->archetype_id = archetype_id;
-        view->entity_count = archetype->col_count;
-        view->entities = archetype->entities;
+        view->chunk_id = start_chunk;
+        view->entity_count = chunk_entity_count(archetype, start_chunk);
+        view->entities = chunk_entities(chunk);
         for (ssize i = 0; i < desc->component_count; i++) {
-            ssize j = 0;
-            for (; j < archetype->row_count; j++) {
-                if (desc->components[i] == archetype->component_ids[j]) break;
-            }
-            view->components[i] = (char*)archetype->components[j];
+            view->components[i] = chunk_column(archetype, chunk, desc->components[i]);
         }
 
         return RESULT_INCOMPLETE;
     }
 
     static void delete_in_archetype(world_id world, struct archetype* archetype, ssize index) {
-        ssize last = archetype->col_count - 1;
-        if (index == last) {
-            archetype->col_count--;
-            return;
-        }
-        entity_id last_id = archetype->entities[last];
-        archetype->entities[index] = last_id;
-        world->entities[last_id].index = index;
-        for (ssize i = 0; i < archetype->row_count; i++) {
-            ssize size = world->components.sizes[archetype->component_ids[i]];
-            memcpy((char*)archetype->components[i] + size * index,
-                   (char*)archetype->components[i] + size * last, size);
+        ssize last = archetype->entity_count - 1;
+        struct chunk* last_chunk = archetype->chunks[last / archetype->chunk_capacity];
+        if (index != last) {
+            // Move the last entity into the hole.
+            struct chunk* chunk = archetype->chunks[index / archetype->chunk_capacity];
+            ssize row = index % archetype->chunk_capacity;
+            ssize last_row = last % archetype->chunk_capacity;
+            entity_id last_id = chunk_entities(last_chunk)[last_row];
+            chunk_entities(chunk)[row] = last_id;
+            world->entities[entity_index(last_id)].index = index;
+            for (ssize i = 0; i < archetype->row_count; i++) {
+                component_id c = archetype->component_ids[i];
+                ssize size = world->components.sizes[c];
+                memcpy(chunk_column(archetype, chunk, c) + size * row,
+                       chunk_column(archetype, last_chunk, c) + size * last_row, size);
+            }
+        }
+        archetype->entity_count--;
+        if (archetype->entity_count == (archetype->chunk_count - 1) * archetype->chunk_capacity) {
+            release_last_chunk(world, archetype);
         }
-        archetype->col_count--;
     }
 
+    /**
+     * @brief the slot of an entity, or NULL if it is not alive
+     */
+    static entity_info* find_entity(world_id world, entity_id entity) {
+        ssize slot = entity_index(entity);
+        if (slot >= (ssize)world->entities.count()) return NULL;
+        entity_info* info = &world->entities[slot];
+        if (info->archetype_id < 0 || info->generation != entity_generation(entity)) return NULL;
+        return info;
+    }
+
+    bool is_alive(world_id world, entity_id entity) { return find_entity(world, entity) != NULL; }
+
     void delete_entities(world_id world, ssize count, entity_id* entities) {
         for (ssize i = 0; i < count; i++) {
-            entity_id id = entities[i];
-            ssize archetype_id = world->entities[id].archetype_id;
-            ssize index = world->entities[id].index;
-            struct archetype* archetype = &world->archetypes[archetype_id];
-            delete_in_archetype(world, archetype, index);
+            entity_info* info = find_entity(world, entities[i]);
+            if (!info) continue;
+            struct archetype* archetype = &world->archetypes[info->archetype_id];
+            delete_in_archetype(world, archetype, info->index);
+            info->archetype_id = -1;
+            info->index = world->free_entity;
+            info->generation++;
+            world->free_entity = entity_index(entities[i]);
+        }
+    }
+
+    static bool has_component(struct archetype* archetype, component_id c) {
+        return (ssize)c < archetype->column_map_size && archetype->columns[c] >= 0;
+    }
+
+    /**
+     * @brief the archetype with the components of another one, plus or minus one
+     *
+     * Edges are cached both ways: if B is A plus c, then A is B minus c.
+     */
+    static ssize follow_edge(world_id world, ssize archetype_id, component_id c, bool add) {
+        archetype_edge edge = {archetype_id, c};
+        ssize* cached = (add ? world->add_edges : world->remove_edges).get(edge);
+        if (cached) return *cached;
+
+        struct archetype* archetype = &world->archetypes[archetype_id];
+        ssize size = archetype->signature_size;
+        ssize word = c / 64;
+        if (add && word >= size) size = word + 1;
+        base::vector<u64>& signature = world->signature;
+        signature.reserve(size);
+        u64* words = signature.data();
+        for (ssize i = 0; i < size; i++) {
+            words[i] = i < archetype->signature_size ? archetype->signature[i] : 0;
+        }
+        words[word] ^= u64{1} << (c % 64);
+        // Keep the last word non-zero.
+        while (size > 0 && words[size - 1] == 0) size--;
+        signature.set_count(size);
+
+        u64 hash = hash_signature(size, words);
+        ssize target = find_archetype(world, hash, size, words);
+        if (target < 0) target = create_archetype(world, hash, size, words);
+        (add ? world->add_edges : world->remove_edges).set(edge, target);
+        (add ? world->remove_edges : world->add_edges).set(archetype_edge{target, c}, archetype_id);
+        return target;
+    }
+
+    /**
+     * @brief move an entity to another archetype, keeping the components both have
+     */
+    static void move_entity(world_id world, entity_id entity, ssize target_id) {
+        entity_info info = world->entities[entity_index(entity)];
+        struct archetype* source = &world->archetypes[info.archetype_id];
+        struct archetype* target = &world->archetypes[target_id];
+
+        if (target->entity_count == target->chunk_count * target->chunk_capacity) {
+            acquire_chunk(world, target);
+        }
+        ssize index = target->entity_count;
+        target->entity_count++;
+        struct chunk* chunk = target->chunks[index / target->chunk_capacity];
+        ssize row = index % target->chunk_capacity;
+        struct chunk* source_chunk = source->chunks[info.index / source->chunk_capacity];
+        ssize source_row = info.index % source->chunk_capacity;
+
+        chunk_entities(chunk)[row] = entity;
+        for (ssize i = 0; i < source->row_count; i++) {
+            component_id c = source->component_ids[i];
+            if (!has_component(target, c)) continue;
+            ssize size = world->components.sizes[c];
+            memcpy(chunk_column(target, chunk, c) + size * row,
+                   chunk_column(source, source_chunk, c) + size * source_row, size);
         }
+
+        delete_in_archetype(world, source, info.index);
+        world->entities[entity_index(entity)].archetype_id = target_id;
+        world->entities[entity_index(entity)].index = index;
+    }
+
+    int add_component(world_id world, entity_id entity, component_id component, void** data) {
+        entity_info* info = find_entity(world, entity);
+        if (!info) return RESULT_INVALID_ENTITY;
+        ssize archetype_id = info->archetype_id;
+        if (has_component(&world->archetypes[archetype_id], component)) {
+            return RESULT_DUPLICATE_COMPONENT;
+        }
+        ssize target_id = follow_edge(world, archetype_id, component, true);
+        move_entity(world, entity, target_id);
+        if (data) {
+            struct archetype* target = &world->archetypes[target_id];
+            ssize index = world->entities[entity_index(entity)].index;
+            struct chunk* chunk = target->chunks[index / target->chunk_capacity];
+            *data = chunk_column(target, chunk, component) +
+                    world->components.sizes[component] * (index % target->chunk_capacity);
+        }
+        return RESULT_SUCCESS;
+    }
+
+    int remove_component(world_id world, entity_id entity, component_id component) {
+        entity_info* info = find_entity(world, entity);
+        if (!info) return RESULT_INVALID_ENTITY;
+        ssize archetype_id = info->archetype_id;
+        if (!has_component(&world->archetypes[archetype_id], component)) {
+            return RESULT_MISSING_COMPONENT;
+        }
+        move_entity(world, entity, follow_edge(world, archetype_id, component, false));
+        return RESULT_SUCCESS;
     }
 
 }  // namespace spargel::ecs
@@ -6,6 +6,12 @@ namespace spargel::ecs {
 
     typedef struct world* world_id;
     typedef u64 component_id;
+    /**
+     * @brief the index of the entity's slot in the world, and a generation in the high 32 bits
+     *
+     * A deleted entity's slot is reused, with the next generation, so its id does not refer to
+     * the new entity.
+     */
     typedef u64 entity_id;
 
     enum result {
@@ -13,10 +19,23 @@ namespace spargel::ecs {
         RESULT_DUPLICATE_COMPONENT,
         RESULT_INCOMPLETE,
         RESULT_QUERY_END,
+        RESULT_MISSING_COMPONENT,
+        RESULT_INVALID_ENTITY,
     };
 
+    inline u32 entity_index(entity_id entity) { return (u32)entity; }
+
+    inline u32 entity_generation(entity_id entity) { return (u32)(entity >> 32); }
+
+    /**
+     * @brief entities of one chunk of an archetype
+     *
+     * Entities are stored in fixed-size chunks, each with an array per component. The pointers
+     * stay valid until entities of the archetype are deleted.
+     */
     struct view {
         u64 archetype_id;
+        u64 chunk_id;
         ssize entity_count;
         entity_id* entities;
         void** components;
@@ -34,6 +53,8 @@ namespace spargel::ecs {
 
     struct query_descriptor {
         u64 start_archetype_id;
+        /* only for the archetype start_archetype_id */
+        u64 start_chunk_id;
         ssize component_count;
         component_id const* components;
     };
@@ -54,10 +75,47 @@ namespace spargel::ecs {
     int register_component(world_id world, struct component_descriptor const* descriptor,
                            component_id* id);
 
+    /**
+     * @brief spawn entities into the chunk with room, or a new one
+     *
+     * Returns RESULT_INCOMPLETE if the chunk fills up before all the entities are spawned; the
+     * view has the ones that were. Spawn the rest with another call.
+     */
     int spawn_entities(world_id world, struct spawn_descriptor* desc, struct view* view);
 
+    /**
+     * @brief get the first chunk, not before the start, of an archetype with the components
+     *
+     * Returns RESULT_INCOMPLETE with a view, or RESULT_QUERY_END. Continue from the next chunk
+     * of the same archetype.
+     */
     int query(world_id world, struct query_descriptor* desc, struct view* view);
 
+    /**
+     * @brief delete entities; ids that are not alive are skipped
+     */
     void delete_entities(world_id world, ssize count, entity_id* entities);
 
+    /**
+     * @brief whether an entity was spawned and not yet deleted
+     */
+    bool is_alive(world_id world, entity_id entity);
+
+    /**
+     * @brief give an entity one more component, moving it to another archetype
+     *
+     * The entity keeps its id and its other components. If data is not null, it receives where
+     * the new component is, uninitialized. Returns RESULT_DUPLICATE_COMPONENT if the entity
+     * already has the component, or RESULT_INVALID_ENTITY if it is not alive.
+     */
+    int add_component(world_id world, entity_id entity, component_id component, void** data);
+
+    /**
+     * @brief take a component from an entity, moving it to another archetype
+     *
+     * Returns RESULT_MISSING_COMPONENT if the entity does not have the component, or
+     * RESULT_INVALID_ENTITY if it is not alive.
+     */
+    int remove_component(world_id world, entity_id entity, component_id component);
+
 }  // namespace spargel::ecs
@@ -0,0 +1,151 @@
+#include "spargel/base/benchmark.h"
+#include "spargel/ecs/ecs.h"
+
+using namespace spargel;
+using namespace spargel::ecs;
+
+namespace {
+
+    constexpr ssize component_count = 12;
+
+    // A world with one entity in each of the 4095 archetypes made of the components.
+    struct crowded_world {
+        world_id world;
+        component_id ids[component_count];
+
+        crowded_world() {
+            world = create_world();
+            for (ssize i = 0; i < component_count; i++) {
+                component_descriptor desc = {.size = sizeof(u32)};
+                register_component(world, &desc, &ids[i]);
+            }
+            void* components[component_count];
+            view v = {.components = components};
+            for (u32 mask = 1; mask < (1u << component_count); mask++) {
+                component_id set[component_count];
+                ssize count = 0;
+                for (ssize i = 0; i < component_count; i++) {
+                    if (mask & (1u << i)) set[count++] = ids[i];
+                }
+                spawn_descriptor desc = {
+                    .component_count = count, .components = set, .entity_count = 1};
+                spawn_entities(world, &desc, &v);
+            }
+        }
+        ~crowded_world() { destroy_world(world); }
+    };
+
+    // Visit every chunk of the archetypes matching `count` components.
+    ssize run_query(world_id world, ssize count, component_id const* ids) {
+        void* components[component_count];
+        view v = {.components = components};
+        query_descriptor desc = {.component_count = count, .components = ids};
+        ssize entities = 0;
+        u64 next_archetype = 0;
+        u64 next_chunk = 0;
+        while (true) {
+            desc.start_archetype_id = next_archetype;
+            desc.start_chunk_id = next_chunk;
+            if (query(world, &desc, &v) == RESULT_QUERY_END) break;
+            entities += v.entity_count;
+            next_archetype = v.archetype_id;
+            next_chunk = v.chunk_id + 1;
+        }
+        return entities;
+    }
+
+    // 4 of 4095 archetypes match.
+    BENCHMARK(ECS_QueryFewMatches) {
+        crowded_world w;
+        while (state.keepRunning()) {
+            base::do_not_optimize(run_query(w.world, 10, w.ids));
+        }
+    }
+
+    // 2048 of 4095 archetypes match.
+    BENCHMARK(ECS_QueryManyMatches) {
+        crowded_world w;
+        state.setItemsPerIteration(2048);
+        while (state.keepRunning()) {
+            base::do_not_optimize(run_query(w.world, 1, w.ids));
+        }
+    }
+
+    BENCHMARK(ECS_SpawnIntoExisting) {
+        crowded_world w;
+        void* components[3];
+        view v = {.components = components};
+        component_id set[] = {w.ids[7], w.ids[2], w.ids[11]};
+        spawn_descriptor desc = {.component_count = 3, .components = set, .entity_count = 1};
+        while (state.keepRunning()) {
+            spawn_entities(w.world, &desc, &v);
+            base::do_not_optimize(components[0]);
+        }
+    }
+
+    // Toggle a component on an entity; both archetypes exist.
+    BENCHMARK(ECS_AddRemoveComponent) {
+        crowded_world w;
+        void* components[3];
+        view v = {.components = components};
+        component_id set[] = {w.ids[7], w.ids[2], w.ids[11]};
+        spawn_descriptor desc = {.component_count = 3, .components = set, .entity_count = 1};
+        spawn_entities(w.world, &desc, &v);
+        entity_id entity = v.entities[0];
+        state.setItemsPerIteration(2);
+        while (state.keepRunning()) {
+            remove_component(w.world, entity, w.ids[2]);
+            add_component(w.world, entity, w.ids[2], nullptr);
+        }
+    }
+
+    // Spawn and delete 256 entities at a time; the slots are reused.
+    BENCHMARK(ECS_SpawnDeleteChurn) {
+        crowded_world w;
+        void* components[3];
+        view v = {.components = components};
+        component_id set[] = {w.ids[7], w.ids[2], w.ids[11]};
+        entity_id entities[256];
+        state.setItemsPerIteration(256);
+        while (state.keepRunning()) {
+            spawn_descriptor desc = {.component_count = 3, .components = set, .entity_count = 256};
+            ssize count = 0;
+            while (desc.entity_count > 0) {
+                spawn_entities(w.world, &desc, &v);
+                for (ssize i = 0; i < v.entity_count; i++) {
+                    entities[count++] = v.entities[i];
+                }
+                desc.entity_count -= v.entity_count;
+            }
+            delete_entities(w.world, count, entities);
+        }
+    }
+
+    // 64K entities into an empty world, 256 at a time.
+    BENCHMARK(ECS_SpawnBatches) {
+        constexpr ssize total = 64 * 1024;
+        constexpr ssize batch = 256;
+        state.setItemsPerIteration(total);
+        while (state.keepRunning()) {
+            world_id world = create_world();
+            component_id ids[2];
+            for (ssize i = 0; i < 2; i++) {
+                component_descriptor desc = {.size = 4 * sizeof(float)};
+                register_component(world, &desc, &ids[i]);
+            }
+            void* components[2];
+            view v = {.components = components};
+            for (ssize n = 0; n < total; n += batch) {
+                spawn_descriptor desc = {
+                    .component_count = 2, .components = ids, .entity_count = batch};
+                while (desc.entity_count > 0) {
+                    spawn_entities(world, &desc, &v);
+                    base::do_not_optimize(components[0]);
+                    desc.entity_count -= v.entity_count;
+                }
+            }
+            destroy_world(world);
+        }
+    }
+
+}  // namespace
@@ -36,7 +36,10 @@ static void grow_array(void** ptr, ssize* capacity, ssize stride, ssize need) {
     ssize cap2 = *capacity * 2;
     ssize new_cap = cap2 > need ? cap2 : need;
     if (new_cap < 8) new_cap = 8;
-    *ptr = base::default_allocator()->resize(*ptr, *capacity * stride, new_cap * stride);
+    if (*ptr)
+        *ptr = base::default_allocator()->resize(*ptr, *capacity * stride, new_cap * stride);
+    else
+        *ptr = base::default_allocator()->allocate(new_cap * stride);
     *capacity = new_cap;
 }
 
@@ -138,17 +141,20 @@ int main() {
     {
         ecs::component_id ids[] = {position_id};
         u64 archetype_id = 0;
+        u64 chunk_id = 0;
         struct ecs::query_descriptor desc = {
             .component_count = 1,
             .components = ids,
         };
         while (true) {
             desc.start_archetype_id = archetype_id;
+            desc.start_chunk_id = chunk_id;
             int result = ecs::query(world, &desc, &view);
             if (result == ecs::RESULT_QUERY_END) break;
-            printf("info: query: get %ld entities with [ position ] in archetype %lu\n",
-                   view.entity_count, view.archetype_id);
-            archetype_id = view.archetype_id + 1;
+            printf("info: query: get %ld entities with [ position ] in archetype %lu chunk %lu\n",
+                   view.entity_count, view.archetype_id, view.chunk_id);
+            archetype_id = view.archetype_id;
+            chunk_id = view.chunk_id + 1;
 
             struct position* pos = (struct position*)components[0];
             for (ssize i = 0; i < view.entity_count; i++) {
@@ -161,17 +167,20 @@ int main() {
     {
         ecs::component_id ids[] = {health_id};
         u64 archetype_id = 0;
+        u64 chunk_id = 0;
         struct ecs::query_descriptor desc = {
             .component_count = 1,
             .components = ids,
         };
         while (true) {
             desc.start_archetype_id = archetype_id;
+            desc.start_chunk_id = chunk_id;
             int result = ecs::query(world, &desc, &view);
             if (result == ecs::RESULT_QUERY_END) break;
-            printf("info: query: get %ld entities with [ health ] in archetype %lu\n",
-                   view.entity_count, view.archetype_id);
-            archetype_id = view.archetype_id + 1;
+            printf("info: query: get %ld entities with [ health ] in archetype %lu chunk %lu\n",
+                   view.entity_count, view.archetype_id, view.chunk_id);
+            archetype_id = view.archetype_id;
+            chunk_id = view.chunk_id + 1;
 
             struct health* h = (struct health*)components[0];
             for (ssize i = 0; i < view.entity_count; i++) {
@@ -187,14 +196,19 @@ int main() {
             .components = ids,
             .entity_count = 2000,
         };
-        ecs::spawn_entities(world, &desc, &view);
-        printf("info: spawned 2000 x [ position, velocity ] with archetype %lu\n",
-               view.archetype_id);
-        struct position* pos = (struct position*)components[0];
-        struct velocity* vel = (struct velocity*)components[1];
-        for (ssize i = 0; i < view.entity_count; i++) {
-            pos[i].x = -i;
-            vel[i].v = i;
+        ssize spawned = 0;
+        while (desc.entity_count > 0) {
+            ecs::spawn_entities(world, &desc, &view);
+            printf("info: spawned %ld x [ position, velocity ] with archetype %lu chunk %lu\n",
+                   view.entity_count, view.archetype_id, view.chunk_id);
+            struct position* pos = (struct position*)components[0];
+            struct velocity* vel = (struct velocity*)components[1];
+            for (ssize i = 0; i < view.entity_count; i++) {
+                pos[i].x = -(spawned + i);
+                vel[i].v = spawned + i;
+            }
+            spawned += view.entity_count;
+            desc.entity_count -= view.entity_count;
         }
     }
 
@@ -203,17 +217,20 @@ int main() {
     {
         ecs::component_id ids[] = {position_id};
         u64 archetype_id = 0;
+        u64 chunk_id = 0;
         struct ecs::query_descriptor desc = {
             .component_count = 1,
             .components = ids,
         };
         while (true) {
             desc.start_archetype_id = archetype_id;
+            desc.start_chunk_id = chunk_id;
             int result = ecs::query(world, &desc, &view);
             if (result == ecs::RESULT_QUERY_END) break;
-            printf("info: query: get %ld entities with [ position ] in archetype %lu\n",
-                   view.entity_count, view.archetype_id);
-            archetype_id = view.archetype_id + 1;
+            printf("info: query: get %ld entities with [ position ] in archetype %lu chunk %lu\n",
+                   view.entity_count, view.archetype_id, view.chunk_id);
+            archetype_id = view.archetype_id;
+            chunk_id = view.chunk_id + 1;
 
             struct position* pos = (struct position*)components[0];
             for (ssize i = 0; i < view.entity_count; i++) {
@@ -230,17 +247,20 @@ int main() {
     {
         ecs::component_id ids[] = {position_id};
         u64 archetype_id = 0;
+        u64 chunk_id = 0;
         struct ecs::query_descriptor desc = {
             .component_count = 1,
             .components = ids,
         };
         while (true) {
             desc.start_archetype_id = archetype_id;
+            desc.start_chunk_id = chunk_id;
             int result = ecs::query(world, &desc, &view);
             if (result == ecs::RESULT_QUERY_END) break;
-            printf("info: query: get %ld entities with [ position ] in archetype %lu\n",
-                   view.entity_count, view.archetype_id);
-            archetype_id = view.archetype_id + 1;
+            printf("info: query: get %ld entities with [ position ] in archetype %lu chunk %lu\n",
+                   view.entity_count, view.archetype_id, view.chunk_id);
+            archetype_id = view.archetype_id;
+            chunk_id = view.chunk_id + 1;
 
             struct position* pos = (struct position*)components[0];
             for (ssize i = 0; i < view.entity_count; i++) {
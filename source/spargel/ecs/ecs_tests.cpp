@@ -0,0 +1,397 @@
+#include "spargel/base/check.h"
+#include "spargel/base/test.h"
+#include "spargel/ecs/ecs.h"
+
+using namespace spargel;
+using namespace spargel::ecs;
+
+namespace {
+
+    struct position {
+        float x;
+        float y;
+    };
+
+    struct velocity {
+        float v;
+    };
+
+    component_id register_sized(world_id world, ssize size) {
+        component_descriptor desc = {.size = size};
+        component_id id;
+        spargel_check(register_component(world, &desc, &id) == RESULT_SUCCESS);
+        return id;
+    }
+
+    // The number of entities with all of `ids`, over every matching archetype.
+    ssize count_matching(world_id world, ssize count, component_id const* ids) {
+        void* components[8];
+        view v = {.components = components};
+        query_descriptor desc = {.component_count = count, .components = ids};
+        ssize total = 0;
+        u64 next_archetype = 0;
+        u64 next_chunk = 0;
+        while (true) {
+            desc.start_archetype_id = next_archetype;
+            desc.start_chunk_id = next_chunk;
+            if (query(world, &desc, &v) == RESULT_QUERY_END) break;
+            total += v.entity_count;
+            next_archetype = v.archetype_id;
+            next_chunk = v.chunk_id + 1;
+        }
+        return total;
+    }
+
+    TEST(ECS_Spawn_SameArchetype) {
+        world_id world = create_world();
+        component_id pos = register_sized(world, sizeof(position));
+        component_id vel = register_sized(world, sizeof(velocity));
+
+        void* components[2];
+        view v = {.components = components};
+
+        component_id ids1[] = {pos, vel};
+        spawn_descriptor desc1 = {.component_count = 2, .components = ids1, .entity_count = 3};
+        spargel_check(spawn_entities(world, &desc1, &v) == RESULT_SUCCESS);
+        u64 archetype = v.archetype_id;
+        static_cast<position*>(components[0])[0] = {1, 2};
+        static_cast<velocity*>(components[1])[0] = {3};
+
+        // The order of the components does not matter, but the view follows it.
+        component_id ids2[] = {vel, pos};
+        spawn_descriptor desc2 = {.component_count = 2, .components = ids2, .entity_count = 1};
+        spargel_check(spawn_entities(world, &desc2, &v) == RESULT_SUCCESS);
+        spargel_check(v.archetype_id == archetype);
+        static_cast<velocity*>(components[0])[0] = {7};
+        static_cast<position*>(components[1])[0] = {5, 6};
+
+        query_descriptor q = {.start_archetype_id = 0, .component_count = 2, .components = ids1};
+        spargel_check(query(world, &q, &v) == RESULT_INCOMPLETE);
+        spargel_check(v.entity_count == 4);
+        auto p = static_cast<position*>(components[0]);
+        auto s = static_cast<velocity*>(components[1]);
+        spargel_check(p[0].x == 1 && p[0].y == 2 && s[0].v == 3);
+        spargel_check(p[3].x == 5 && p[3].y == 6 && s[3].v == 7);
+
+        destroy_world(world);
+    }
+
+    TEST(ECS_Spawn_DuplicateComponent) {
+        world_id world = create_world();
+        component_id pos = register_sized(world, sizeof(position));
+
+        void* components[2];
+        view v = {.components = components};
+        component_id ids[] = {pos, pos};
+        spawn_descriptor desc = {.component_count = 2, .components = ids, .entity_count = 1};
+        spargel_check(spawn_entities(world, &desc, &v) == RESULT_DUPLICATE_COMPONENT);
+
+        destroy_world(world);
+    }
+
+    TEST(ECS_Query_ManyArchetypes) {
+        world_id world = create_world();
+        constexpr ssize component_count = 10;
+        component_id ids[component_count];
+        for (ssize i = 0; i < component_count; i++) {
+            ids[i] = register_sized(world, sizeof(u32));
+        }
+
+        // One entity in each archetype of the first `n` components, for every non-empty subset.
+        auto spawn_subsets = [&](u32 begin, u32 end) {
+            void* components[component_count];
+            view v = {.components = components};
+            for (u32 mask = begin; mask < end; mask++) {
+                component_id set[component_count];
+                ssize count = 0;
+                for (ssize i = 0; i < component_count; i++) {
+                    if (mask & (1u << i)) set[count++] = ids[i];
+                }
+                spawn_descriptor desc = {
+                    .component_count = count, .components = set, .entity_count = 1};
+                spargel_check(spawn_entities(world, &desc, &v) == RESULT_SUCCESS);
+            }
+        };
+
+        spawn_subsets(1, 512);
+        // Half of the subsets contain a given component.
+        spargel_check(count_matching(world, 1, &ids[0]) == 256);
+        component_id pair[] = {ids[3], ids[1]};
+        spargel_check(count_matching(world, 2, pair) == 128);
+        spargel_check(count_matching(world, 1, &ids[9]) == 0);
+
+        // Cached queries see archetypes created later.
+        spawn_subsets(512, 1024);
+        spargel_check(count_matching(world, 1, &ids[0]) == 512);
+        spargel_check(count_matching(world, 2, pair) == 256);
+        spargel_check(count_matching(world, 1, &ids[9]) == 512);
+        spargel_check(count_matching(world, 0, nullptr) == 1023);
+
+        destroy_world(world);
+    }
+
+    // Components past the first 64 take more than one word of the signature.
+    TEST(ECS_Query_WideSignature) {
+        world_id world = create_world();
+        constexpr ssize component_count = 130;
+        component_id ids[component_count];
+        for (ssize i = 0; i < component_count; i++) {
+            ids[i] = register_sized(world, sizeof(u32));
+        }
+
+        void* components[2];
+        view v = {.components = components};
+        component_id set1[] = {ids[129], ids[0]};
+        component_id set2[] = {ids[64], ids[129]};
+        component_id set3[] = {ids[63]};
+        for (component_id const* set : {set1, set2}) {
+            spawn_descriptor desc = {.component_count = 2, .components = set, .entity_count = 1};
+            spargel_check(spawn_entities(world, &desc, &v) == RESULT_SUCCESS);
+            static_cast<u32*>(components[0])[0] = static_cast<u32>(set[0]);
+            static_cast<u32*>(components[1])[0] = static_cast<u32>(set[1]);
+        }
+        spawn_descriptor desc = {.component_count = 1, .components = set3, .entity_count = 1};
+        spargel_check(spawn_entities(world, &desc, &v) == RESULT_SUCCESS);
+
+        spargel_check(count_matching(world, 1, &ids[129]) == 2);
+        spargel_check(count_matching(world, 1, &ids[64]) == 1);
+        spargel_check(count_matching(world, 1, &ids[63]) == 1);
+        spargel_check(count_matching(world, 1, &ids[128]) == 0);
+        spargel_check(count_matching(world, 0, nullptr) == 3);
+
+        // Each view points at the column of its component.
+        component_id wanted[] = {ids[129], ids[64]};
+        query_descriptor q = {.start_archetype_id = 0, .component_count = 2, .components = wanted};
+        spargel_check(query(world, &q, &v) == RESULT_INCOMPLETE);
+        spargel_check(static_cast<u32*>(components[0])[0] == 129);
+        spargel_check(static_cast<u32*>(components[1])[0] == 64);
+        q.start_archetype_id = v.archetype_id;
+        q.start_chunk_id = v.chunk_id + 1;
+        spargel_check(query(world, &q, &v) == RESULT_QUERY_END);
+
+        destroy_world(world);
+    }
+
+    // Spawn `count` entities of `ids`, one chunk at a time. Return the number of views.
+    ssize spawn_all(world_id world, ssize component_count, component_id const* ids, ssize count,
+                    void (*fill)(view const&, ssize first)) {
+        void* components[8];
+        view v = {.components = components};
+        spawn_descriptor desc = {
+            .component_count = component_count, .components = ids, .entity_count = count};
+        ssize views = 0;
+        ssize spawned = 0;
+        while (desc.entity_count > 0) {
+            int result = spawn_entities(world, &desc, &v);
+            spargel_check(result == (v.entity_count < desc.entity_count ? RESULT_INCOMPLETE
+                                                                         : RESULT_SUCCESS));
+            if (fill) fill(v, spawned);
+            spawned += v.entity_count;
+            desc.entity_count -= v.entity_count;
+            views++;
+        }
+        return views;
+    }
+
+    TEST(ECS_Spawn_Chunks) {
+        world_id world = create_world();
+        component_id pos = register_sized(world, sizeof(position));
+
+        // 16 bytes an entity: about a thousand in a chunk.
+        ssize views = spawn_all(world, 1, &pos, 3000, [](view const& v, ssize first) {
+            auto p = static_cast<position*>(v.components[0]);
+            for (ssize i = 0; i < v.entity_count; i++) {
+                p[i] = {static_cast<float>(first + i), 0};
+            }
+        });
+        spargel_check(views == 3);
+        spargel_check(count_matching(world, 1, &pos) == 3000);
+
+        // Earlier chunks do not move as later ones are added.
+        void* components[1];
+        view v = {.components = components};
+        query_descriptor q = {.start_archetype_id = 0, .component_count = 1, .components = &pos};
+        spargel_check(query(world, &q, &v) == RESULT_INCOMPLETE);
+        void* first_chunk = components[0];
+        spawn_all(world, 1, &pos, 3000, nullptr);
+        spargel_check(query(world, &q, &v) == RESULT_INCOMPLETE);
+        spargel_check(components[0] == first_chunk);
+        spargel_check(static_cast<position*>(components[0])[5].x == 5);
+        spargel_check(count_matching(world, 1, &pos) == 6000);
+
+        destroy_world(world);
+    }
+
+    TEST(ECS_Spawn_LargeComponent) {
+        world_id world = create_world();
+        // Larger than a chunk.
+        component_id big = register_sized(world, 20000);
+        spargel_check(spawn_all(world, 1, &big, 3, [](view const& v, ssize) {
+                          spargel_check(v.entity_count == 1);
+                          static_cast<u8*>(v.components[0])[19999] = 1;
+                      }) == 3);
+        spargel_check(count_matching(world, 1, &big) == 3);
+        destroy_world(world);
+    }
+
+    TEST(ECS_Delete_MovesLastEntity) {
+        world_id world = create_world();
+        component_id pos = register_sized(world, sizeof(position));
+        component_id vel = register_sized(world, sizeof(velocity));
+        component_id ids[] = {pos, vel};
+
+        spawn_all(world, 2, ids, 2500, [](view const& v, ssize first) {
+            auto p = static_cast<position*>(v.components[0]);
+            auto s = static_cast<velocity*>(v.components[1]);
+            for (ssize i = 0; i < v.entity_count; i++) {
+                p[i] = {static_cast<float>(first + i), 0};
+                s[i] = {static_cast<float>(first + i)};
+            }
+        });
+
+        // 816 entities a chunk, so four chunks, the last one with 52. Entities are numbered in
+        // spawn order: delete the first 600, which moves the last ones into the first chunk and
+        // frees the last chunk.
+        entity_id doomed[600];
+        for (ssize i = 0; i < 600; i++) {
+            doomed[i] = i;
+        }
+        delete_entities(world, 600, doomed);
+        spargel_check(count_matching(world, 2, ids) == 1900);
+
+        // Every remaining entity still has its own components.
+        void* components[2];
+        view v = {.components = components};
+        query_descriptor q = {.start_archetype_id = 0, .component_count = 2, .components = ids};
+        ssize views = 0;
+        bool seen[2500] = {};
+        while (query(world, &q, &v) == RESULT_INCOMPLETE) {
+            auto p = static_cast<position*>(components[0]);
+            auto s = static_cast<velocity*>(components[1]);
+            for (ssize i = 0; i < v.entity_count; i++) {
+                spargel_check(p[i].x == static_cast<float>(v.entities[i]));
+                spargel_check(s[i].v == static_cast<float>(v.entities[i]));
+                spargel_check(v.entities[i] >= 600 && !seen[v.entities[i]]);
+                seen[v.entities[i]] = true;
+            }
+            views++;
+            q.start_archetype_id = v.archetype_id;
+            q.start_chunk_id = v.chunk_id + 1;
+        }
+        spargel_check(views == 3);
+
+        destroy_world(world);
+    }
+
+    TEST(ECS_AddRemoveComponent) {
+        world_id world = create_world();
+        component_id pos = register_sized(world, sizeof(position));
+        component_id vel = register_sized(world, sizeof(velocity));
+
+        spawn_all(world, 1, &pos, 3, [](view const& v, ssize) {
+            auto p = static_cast<position*>(v.components[0]);
+            for (ssize i = 0; i < v.entity_count; i++) {
+                p[i] = {static_cast<float>(v.entities[i]), 1};
+            }
+        });
+
+        void* data = nullptr;
+        spargel_check(add_component(world, 1, vel, &data) == RESULT_SUCCESS);
+        static_cast<velocity*>(data)->v = 7;
+        spargel_check(add_component(world, 1, vel, nullptr) == RESULT_DUPLICATE_COMPONENT);
+        spargel_check(count_matching(world, 1, &pos) == 3);
+
+        // The entity keeps its id and its position, next to its new velocity.
+        component_id both[] = {vel, pos};
+        void* components[2];
+        view v = {.components = components};
+        query_descriptor q = {.start_archetype_id = 0, .component_count = 2, .components = both};
+        spargel_check(query(world, &q, &v) == RESULT_INCOMPLETE);
+        spargel_check(v.entity_count == 1 && v.entities[0] == 1);
+        spargel_check(static_cast<velocity*>(components[0])[0].v == 7);
+        spargel_check(static_cast<position*>(components[1])[0].x == 1);
+        u64 both_archetype = v.archetype_id;
+
+        // Spawning the same components lands in the same archetype.
+        spawn_descriptor desc = {.component_count = 2, .components = both, .entity_count = 1};
+        spargel_check(spawn_entities(world, &desc, &v) == RESULT_SUCCESS);
+        spargel_check(v.archetype_id == both_archetype);
+
+        spargel_check(remove_component(world, 1, pos) == RESULT_SUCCESS);
+        spargel_check(remove_component(world, 1, pos) == RESULT_MISSING_COMPONENT);
+        spargel_check(count_matching(world, 1, &pos) == 3);
+        spargel_check(count_matching(world, 1, &vel) == 2);
+        // After the archetype of both, which has the entity spawned above.
+        q = {.start_archetype_id = both_archetype + 1, .component_count = 1, .components = &vel};
+        spargel_check(query(world, &q, &v) == RESULT_INCOMPLETE);
+        spargel_check(v.entity_count == 1 && v.entities[0] == 1);
+        spargel_check(static_cast<velocity*>(components[0])[0].v == 7);
+
+        // The entity has no components left. The others stayed in place.
+        spargel_check(remove_component(world, 1, vel) == RESULT_SUCCESS);
+        spargel_check(count_matching(world, 0, nullptr) == 4);
+        q = {.start_archetype_id = 0, .component_count = 1, .components = &pos};
+        spargel_check(query(world, &q, &v) == RESULT_INCOMPLETE);
+        spargel_check(v.entity_count == 2);
+        for (ssize i = 0; i < v.entity_count; i++) {
+            spargel_check(static_cast<position*>(components[0])[i].x ==
+                          static_cast<float>(v.entities[i]));
+        }
+
+        // And back again, through the cached edges.
+        spargel_check(add_component(world, 1, vel, nullptr) == RESULT_SUCCESS);
+        spargel_check(add_component(world, 1, pos, nullptr) == RESULT_SUCCESS);
+        q = {.start_archetype_id = 0, .component_count = 2, .components = both};
+        spargel_check(query(world, &q, &v) == RESULT_INCOMPLETE);
+        spargel_check(v.archetype_id == both_archetype && v.entity_count == 2);
+
+        destroy_world(world);
+    }
+
+    TEST(ECS_Entity_Generations) {
+        world_id world = create_world();
+        component_id pos = register_sized(world, sizeof(position));
+        spawn_all(world, 1, &pos, 4, nullptr);
+
+        entity_id doomed[] = {1, 2};
+        delete_entities(world, 2, doomed);
+        spargel_check(is_alive(world, 0) && is_alive(world, 3));
+        spargel_check(!is_alive(world, 1) && !is_alive(world, 2));
+        spargel_check(!is_alive(world, 4));
+
+        // The freed slots come back, with new ids.
+        entity_id reborn[2];
+        void* components[1];
+        view v = {.components = components};
+        spawn_descriptor desc = {.component_count = 1, .components = &pos, .entity_count = 2};
+        spargel_check(spawn_entities(world, &desc, &v) == RESULT_SUCCESS);
+        for (ssize i = 0; i < 2; i++) {
+            reborn[i] = v.entities[i];
+            u32 index = entity_index(reborn[i]);
+            spargel_check(index == 1 || index == 2);
+            spargel_check(entity_generation(reborn[i]) == 1);
+            spargel_check(is_alive(world, reborn[i]));
+        }
+        spargel_check(!is_alive(world, 1) && !is_alive(world, 2));
+
+        // Stale ids do not reach the entities now in their slots.
+        delete_entities(world, 2, doomed);
+        spargel_check(count_matching(world, 1, &pos) == 4);
+        spargel_check(add_component(world, 1, pos, nullptr) == RESULT_INVALID_ENTITY);
+        spargel_check(remove_component(world, 2, pos) == RESULT_INVALID_ENTITY);
+        spargel_check(is_alive(world, reborn[0]) && is_alive(world, reborn[1]));
+
+        // Spawning and deleting one at a time keeps to one slot.
+        desc.entity_count = 1;
+        for (int i = 0; i < 1000; i++) {
+            spawn_entities(world, &desc, &v);
+            entity_id entity = v.entities[0];
+            spargel_check(entity_index(entity) == 4);
+            delete_entities(world, 1, &entity);
+        }
+        spargel_check(count_matching(world, 1, &pos) == 4);
+
+        destroy_world(world);
+    }
+
+}  // namespace
@@ -0,0 +1,73 @@
+#include "spargel/base/benchmark.h"
+#include "spargel/base/vector.h"
+#include "spargel/json/json_parser.h"
+#include "spargel/json/json_value.h"
+
+// libc
+#include <stdio.h>
+#include <string.h>
+
+using namespace spargel;
+using namespace spargel::json;
+
+namespace {
+
+    void append(base::vector<char>& out, char const* s) {
+        usize length = strlen(s);
+        for (usize i = 0; i < length; i++) {
+            out.push(s[i]);
+        }
+    }
+
+    // A document shaped like a resource manifest: an array of objects with strings, numbers,
+    // booleans and a nested array each.
+    base::vector<char> make_document(u32 records) {
+        base::vector<char> out;
+        append(out, "[\n");
+        for (u32 i = 0; i < records; i++) {
+            char buf[256];
+            snprintf(buf, sizeof(buf),
+                     "  {\"name\": \"texture_%u\", \"path\": \"assets/textures/t%u.png\", "
+                     "\"width\": %u, \"height\": %u, \"scale\": %u.25, \"srgb\": %s, "
+                     "\"mips\": [%u, %u, %u]}%s\n",
+                     i, i, 64 + i % 512, 32 + i % 256, i % 4, i % 2 == 0 ? "true" : "false", i,
+                     i / 2, i / 4, i + 1 < records ? "," : "");
+            append(out, buf);
+        }
+        append(out, "]\n");
+        return out;
+    }
+
+    void parse_document(base::BenchmarkState& state, u32 records) {
+        auto doc = make_document(records);
+        state.setBytesPerIteration(doc.count());
+        state.setItemsPerIteration(records);
+        while (state.keepRunning()) {
+            auto result = parseJson(doc.data(), doc.count());
+            base::do_not_optimize(result);
+        }
+    }
+
+    BENCHMARK(JSON_ParseSmall) { parse_document(state, 8); }
+
+    BENCHMARK(JSON_ParseLarge) { parse_document(state, 2048); }
+
+    BENCHMARK(JSON_ParseNumbers) {
+        base::vector<char> doc;
+        append(doc, "[");
+        for (u32 i = 0; i < 4096; i++) {
+            char buf[32];
+            snprintf(buf, sizeof(buf), "%s%u.%03ue%d", i == 0 ? "" : ", ", i, i % 1000,
+                     static_cast<int>(i % 7) - 3);
+            append(doc, buf);
+        }
+        append(doc, "]");
+        state.setBytesPerIteration(doc.count());
+        state.setItemsPerIteration(4096);
+        while (state.keepRunning()) {
+            auto result = parseJson(doc.data(), doc.count());
+            base::do_not_optimize(result);
+        }
+    }
+
+}  // namespace
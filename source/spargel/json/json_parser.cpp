@@ -2,6 +2,7 @@
 
 #include "spargel/base/either.h"
 #include "spargel/base/optional.h"
+#include "spargel/base/string_builder.h"
 #include "spargel/base/string_view.h"
 #include "spargel/base/trace.h"
 #include "spargel/json/cursor.h"
@@ -28,9 +29,10 @@ namespace spargel::json {
 
         const auto UNEXPECTED_END = JsonParseError("unexpected end"_sv);
 
-        String char2hex(char ch) {
+        String invalidCharacterMessage(char ch) {
             const char hexDigits[] = "0123456789abcdef";
-            return String(hexDigits[(ch >> 4) & 0xf]) + hexDigits[ch & 0xf];
+            return base::concat("invalid character 0x", hexDigits[(ch >> 4) & 0xf],
+                                hexDigits[ch & 0xf]);
         }
 
         void appendUtf8(base::vector<char>& chars, u32 code) {
@@ -123,7 +125,7 @@ namespace spargel::json {
             if ((ch >= '0' && ch <= '9') || ch == '-') {
                 return parseNumber();
             } else {
-                return Right(JsonParseError(String("unexpected character: '") + ch + '\''));
+                return Right(JsonParseError(base::concat("unexpected character: '", ch, '\'')));
             }
         }
     }
@@ -214,7 +216,7 @@ namespace spargel::json {
         if (!cursor.tryEatChar('"')) return Right(JsonParseError("expected '\"'"_sv));
 
         // characters
-        base::vector<char> chars;
+        base::vector<char> chars(base::tagged_allocator(base::AllocationTag::json));
 
         while (!cursor.isEnd()) {
             char ch = (char)cursor.consumeChar();
@@ -276,14 +278,14 @@ namespace spargel::json {
                 } break;
                 default:
                     return Right(
-                        JsonParseError(String("unexpected escape character: '") + ch + '\''));
+                        JsonParseError(base::concat("unexpected escape character: '", ch, '\'')));
                 }
             } else if ((u8)ch >= 0x20) {
                 // TODO: unicode
                 // no problem for UTF-8
                 chars.emplace(ch);
             } else {
-                return Right(JsonParseError(String("invalid character 0x") + char2hex(ch)));
+                return Right(JsonParseError(invalidCharacterMessage(ch)));
             }
         }
 
@@ -488,7 +490,8 @@ namespace spargel::json {
     Either<JsonObject, JsonParseError> JsonParser::parseMembers() {
         spargel_trace_scope("parseMembers");
 
-        base::HashMap<JsonString, JsonValue> members;
+        base::HashMap<JsonString, JsonValue> members(
+            base::tagged_allocator(base::AllocationTag::json));
         while (!cursor.isEnd()) {
             // member
             JsonString key;
@@ -544,7 +547,7 @@ namespace spargel::json {
     Either<JsonArray, JsonParseError> JsonParser::parseElements() {
         spargel_trace_scope("parseElements");
 
-        base::vector<JsonValue> elements;
+        base::vector<JsonValue> elements(base::tagged_allocator(base::AllocationTag::json));
         while (!cursor.isEnd()) {
             // element
             auto result = parseElement();
@@ -3,6 +3,7 @@
 #include "spargel/base/either.h"
 #include "spargel/base/optional.h"
 #include "spargel/base/string.h"
+#include "spargel/base/string_builder.h"
 #include "spargel/base/string_view.h"
 #include "spargel/json/cursor.h"
 #include "spargel/json/json_value.h"
@@ -13,21 +14,22 @@ namespace spargel::json {
     class JsonParseError {
     public:
         JsonParseError(const base::String& message) : message_(message) {}
+        JsonParseError(base::String&& message) : message_(base::move(message)) {}
         JsonParseError(base::StringView message) : message_(message) {}
 
         const base::String& message() { return message_; }
 
         friend JsonParseError operator+(const JsonParseError& error, const base::StringView& str) {
-            return JsonParseError((error.message_ + str).view());
+            return JsonParseError(base::concat(error.message_, str));
         }
 
         friend JsonParseError operator+(const JsonParseError& error, char ch) {
-            return JsonParseError((error.message_ + ch).view());
+            return JsonParseError(base::concat(error.message_, ch));
         }
 
         friend JsonParseError operator+(const JsonParseError& error1,
                                         const JsonParseError& error2) {
-            return JsonParseError((error1.message_ + error2.message_).view());
+            return JsonParseError(base::concat(error1.message_, error2.message_));
         }
 
     private:
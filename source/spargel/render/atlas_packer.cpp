@@ -1,5 +1,7 @@
 #include "spargel/render/atlas_packer.h"
 
+#include "spargel/base/trace.h"
+
 namespace spargel::render {
     namespace {
         u16 max(u16 a, u16 b) { return a > b ? a : b; }
@@ -17,6 +19,7 @@ namespace spargel::render {
             return base::nullopt;
         }
         u16 y = current_row_ + GAP;
+        spargel_trace_counter("atlas rows used", next_row_);
         return base::makeOptional<PackResult>(x, y);
     }
 }  // namespace spargel::render
@@ -2,6 +2,7 @@
 
 #include "spargel/base/checked_convert.h"
 #include "spargel/base/logging.h"
+#include "spargel/base/platform.h"
 #include "spargel/config.h"
 #include "spargel/render/constants.h"
 
@@ -20,6 +21,7 @@ namespace spargel::render {
     }
     // TODO: Cache.
     UIRenderer::TextureHandle UIRenderer::prepareGlyph(text::GlyphId id, text::Font* font) {
+        u64 start = base::get_monotonic_time_ns();
         auto bitmap = font->rasterizeGlyph(id, scale_factor_);
         auto width = base::checkedConvert<u16>(bitmap.width);
         auto height = base::checkedConvert<u16>(bitmap.height);
@@ -32,6 +34,8 @@ namespace spargel::render {
         if (width > 0 && height > 0) {
             uploadBitmap(handle, bitmap);
         }
+        glyph_upload_count_++;
+        glyph_upload_ns_ += base::get_monotonic_time_ns() - start;
         return handle;
     }
     UIRenderer::TextureHandle UIRenderer::prepareGlyph(text::GlyphId id, text::Font* font,
@@ -51,6 +55,7 @@ namespace spargel::render {
     }
     UIRenderer::TextureHandle UIRenderer::prepareGlyph(text::GlyphId id, text::Font* font,
                                                        math::Vector2f subpixel_position) {
+        u64 start = base::get_monotonic_time_ns();
         auto bitmap = font->rasterizeGlyph(id, scale_factor_, subpixel_position);
         auto width = base::checkedConvert<u16>(bitmap.width);
         auto height = base::checkedConvert<u16>(bitmap.height);
@@ -63,6 +68,8 @@ namespace spargel::render {
         if (width > 0 && height > 0) {
             uploadBitmap(handle, bitmap);
         }
+        glyph_upload_count_++;
+        glyph_upload_ns_ += base::get_monotonic_time_ns() - start;
         return handle;
     }
 }  // namespace spargel::render
@@ -22,11 +22,7 @@ namespace spargel::render {
         friend bool operator==(SubpixelVariant const& lhs, SubpixelVariant const& rhs) {
             return lhs.x == rhs.x && lhs.y == rhs.y;
         }
-        friend void tag_invoke(base::tag<base::hash>, base::HashRun& run,
-                               SubpixelVariant const& self) {
-            run.combine(self.x);
-            run.combine(self.y);
-        }
+        static constexpr bool trivially_hashable = true;
     };
 
     class UIRenderer {
@@ -56,6 +52,15 @@ namespace spargel::render {
         void setScaleFactor(float s) { scale_factor_ = s; }
         float scaleFactor() const { return scale_factor_; }
 
+        // Glyphs rasterized and uploaded to the atlas, and the time it took, since the last
+        // `resetGlyphUploadStats()`. Cache hits are not counted.
+        u32 glyphUploadCount() const { return glyph_upload_count_; }
+        u64 glyphUploadNs() const { return glyph_upload_ns_; }
+        void resetGlyphUploadStats() {
+            glyph_upload_count_ = 0;
+            glyph_upload_ns_ = 0;
+        }
+
     protected:
         explicit UIRenderer(gpu::GPUContext* context, text::TextShaper* text_shaper)
             : context_{context}, text_shaper_{text_shaper}, packer_{ATLAS_SIZE, ATLAS_SIZE} {}
@@ -83,6 +88,8 @@ namespace spargel::render {
         text::TextShaper* text_shaper_;
         AtlasPacker packer_;
         float scale_factor_ = 1.0;
+        u32 glyph_upload_count_ = 0;
+        u64 glyph_upload_ns_ = 0;
 
         base::HashMap<GlyphCacheKey, TextureHandle> glyph_cache_;
     };
@@ -1,6 +1,7 @@
 #include "spargel/render/ui_scene.h"
 
 #include "spargel/base/check.h"
+#include "spargel/base/platform.h"
 #include "spargel/render/constants.h"
 #include "spargel/render/ui_renderer.h"
 #include "spargel/text/text_shaper.h"
@@ -29,7 +30,9 @@ namespace spargel::render {
     void UIScene::fillText(text::StyledText text, float x, float y, u32 color) {
         spargel_check(renderer_);
         auto shaper = renderer_->textShaper();
+        u64 shaping_start = base::get_monotonic_time_ns();
         auto shape_result = shaper->shapeLine(text);
+        shaping_ns_ += base::get_monotonic_time_ns() - shaping_start;
         for (auto const& segment : shape_result.segments) {
             for (usize i = 0; i < segment.glyphs.count(); i++) {
                 auto glyph = segment.glyphs[i];
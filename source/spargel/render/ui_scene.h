@@ -143,6 +143,7 @@ namespace spargel::render {
         usize commands2_count() const { return commands2_.count(); }
 
         void clear() {
+            shaping_ns_ = 0;
             commands_.clear();
             data_.clear();
             commands2_.clear();
@@ -162,6 +163,9 @@ namespace spargel::render {
 
         usize estimatedSlots() const { return estimated_slots_; }
 
+        // Time spent shaping text since the last `clear()`.
+        u64 shapingNs() const { return shaping_ns_; }
+
     private:
         enum class DrawCommand : u8 {
             fill_rect = 0,
@@ -218,5 +222,6 @@ namespace spargel::render {
         base::Vector<math::Vector2f> transform_stack_;
 
         usize estimated_slots_ = 0;
+        u64 shaping_ns_ = 0;
     };
 }  // namespace spargel::render
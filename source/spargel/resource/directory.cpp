@@ -225,7 +225,7 @@ namespace spargel::resource {
         if (_root_path.length() == 0) {
             return id.path();
         } else {
-            return _root_path + PATH_SPLIT + id.path();
+            return util::joinPath(_root_path.view(), id.path().view());
         }
     }
 
@@ -233,7 +233,7 @@ namespace spargel::resource {
         const base::String& resources_dir) {
         base::String root_path = util::dirname(base::get_executable_path());
         if (resources_dir.length() > 0)
-            root_path = root_path + PATH_SPLIT + base::String(resources_dir);
+            root_path = util::joinPath(root_path.view(), resources_dir.view());
         return base::make_unique<ResourceManagerDirectory>(root_path.view());
     }
 
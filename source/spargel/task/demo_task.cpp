@@ -1,11 +1,138 @@
+#include "spargel/base/atomic.h"
+#include "spargel/base/check.h"
 #include "spargel/base/logging.h"
+#include "spargel/base/vector.h"
+#include "spargel/task/parallel.h"
 #include "spargel/task/task_manager.h"
 
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
 namespace spargel::task {
     namespace {
+        constexpr u32 task_count = 1000000;
+        constexpr u32 latency_samples = 2000;
+        constexpr u32 reduce_count = 1 << 24;
+
+        u64 nowNanos() {
+            timespec ts;
+            clock_gettime(CLOCK_MONOTONIC, &ts);
+            return static_cast<u64>(ts.tv_sec) * 1000000000 + static_cast<u64>(ts.tv_nsec);
+        }
+
+        void waitFor(base::Atomic<u32>& counter, u32 target) {
+            while (counter.load(base::MemoryOrder::acquire) != target) {
+                base::cpu_relax();
+            }
+        }
+
+        // Tiny tasks posted from the main thread, i.e. through the injection queue.
+        f64 runExternal(TaskManager* tm) {
+            base::Atomic<u32> done{0};
+            u64 start = nowNanos();
+            for (u32 i = 0; i < task_count; i++) {
+                tm->postTask([&done] { done.fetchAdd(1, base::MemoryOrder::relaxed); });
+            }
+            waitFor(done, task_count);
+            return static_cast<f64>(nowNanos() - start) / task_count;
+        }
+
+        // Tiny tasks posted from a worker, i.e. through its deque and stealing.
+        f64 runFanOut(TaskManager* tm) {
+            base::Atomic<u32> done{0};
+            u64 start = nowNanos();
+            tm->postTask([tm, &done] {
+                for (u32 i = 0; i < task_count; i++) {
+                    tm->postTask([&done] { done.fetchAdd(1, base::MemoryOrder::relaxed); });
+                }
+            });
+            waitFor(done, task_count);
+            return static_cast<f64>(nowNanos() - start) / task_count;
+        }
+
+        int compareU64(void const* a, void const* b) {
+            u64 x = *static_cast<u64 const*>(a);
+            u64 y = *static_cast<u64 const*>(b);
+            return x < y ? -1 : (x > y ? 1 : 0);
+        }
+
+        // Time from `postTask` to the start of the task, with the workers idle or parked.
+        void runLatency(TaskManager* tm, u64& median, u64& p99) {
+            static u64 samples[latency_samples];
+            for (u32 i = 0; i < latency_samples; i++) {
+                base::Atomic<u32> done{0};
+                u64 started = 0;
+                u64 posted = nowNanos();
+                tm->postTask([&done, &started] {
+                    started = nowNanos();
+                    done.store(1, base::MemoryOrder::release);
+                });
+                waitFor(done, 1);
+                samples[i] = started - posted;
+
+                // Give the workers some time to park, every now and then.
+                if (i % 4 == 0) {
+                    timespec ts{0, 200000};
+                    nanosleep(&ts, nullptr);
+                }
+            }
+            qsort(samples, latency_samples, sizeof(u64), compareU64);
+            median = samples[latency_samples / 2];
+            p99 = samples[latency_samples * 99 / 100];
+        }
+
+        // A reduction over a large array, against the serial loop.
+        void runReduce(TaskManager* tm, base::vector<f64> const& data, f64& serial_ms,
+                       f64& parallel_ms) {
+            auto sum = [&data](usize b, usize e) {
+                f64 s = 0;
+                for (usize i = b; i < e; i++) s += data[i] * data[i];
+                return s;
+            };
+            auto add = [](f64 x, f64 y) { return x + y; };
+
+            u64 start = nowNanos();
+            volatile f64 expected = sum(0, data.count());
+            serial_ms = static_cast<f64>(nowNanos() - start) / 1e6;
+
+            start = nowNanos();
+            f64 result = parallelReduce(tm, 0, data.count(), 0, 0.0, sum, add);
+            parallel_ms = static_cast<f64>(nowNanos() - start) / 1e6;
+            spargel_check(result > expected * 0.999 && result < expected * 1.001);
+        }
+
         void demoMain() {
-            // auto tm = TaskManager::create();
-            // tm->postTask([] { spargel_log_info("hello task!"); });
+            auto tm = TaskManager::create();
+            tm->postTask([] { spargel_log_info("hello task!"); });
+            delete tm;
+
+            base::vector<f64> data;
+            data.reserve(reduce_count);
+            for (u32 i = 0; i < reduce_count; i++) {
+                data.emplace(static_cast<f64>(i % 1000) * 0.001);
+            }
+
+            printf("%8s %16s %16s %14s %14s %12s\n", "workers", "external ns/task",
+                   "fan-out ns/task", "latency p50", "latency p99", "reduce x");
+            long cores = sysconf(_SC_NPROCESSORS_ONLN);
+            for (u32 n = 1;; n *= 2) {
+                if (n > static_cast<u32>(cores)) n = static_cast<u32>(cores);
+                tm = TaskManager::create(n);
+                f64 external = runExternal(tm);
+                f64 fan_out = runFanOut(tm);
+                u64 median, p99;
+                runLatency(tm, median, p99);
+                f64 serial_ms, parallel_ms;
+                runReduce(tm, data, serial_ms, parallel_ms);
+                delete tm;
+                printf("%8u %16.1f %16.1f %11llu ns %11llu ns %12.2f\n", n, external, fan_out,
+                       (unsigned long long)median, (unsigned long long)p99,
+                       serial_ms / parallel_ms);
+                if (n == static_cast<u32>(cores)) break;
+            }
         }
     }  // namespace
 }  // namespace spargel::task
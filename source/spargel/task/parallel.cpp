@@ -0,0 +1,43 @@
+#include "spargel/task/parallel.h"
+
+namespace spargel::task {
+
+    namespace {
+        // Failed attempts to find a task before the waiter sleeps.
+        constexpr u32 spin_rounds = 64;
+        constexpr usize chunks_per_worker = 8;
+    }  // namespace
+
+    namespace detail {
+        void Latch::wait(TaskManager* tm) {
+            u32 spins = 0;
+            for (;;) {
+                u32 state = _state.load(base::MemoryOrder::acquire);
+                if ((state & ~waiting_bit) == 0) return;
+                if (tm->runOneTask()) {
+                    spins = 0;
+                    continue;
+                }
+                if (spins < spin_rounds) {
+                    spins++;
+                    base::cpu_relax();
+                    continue;
+                }
+                // Nothing to help with: the remaining tasks are running on other threads.
+                if ((state & waiting_bit) == 0 &&
+                    !_state.compareExchange(state, state | waiting_bit)) {
+                    continue;
+                }
+                base::atomic_wait(_state.raw(), state | waiting_bit);
+            }
+        }
+
+        usize auto_grain(TaskManager* tm, usize count) {
+            usize workers = tm->workerCount();
+            if (workers <= 1) return count;
+            usize grain = count / (workers * chunks_per_worker);
+            return grain > 0 ? grain : 1;
+        }
+    }  // namespace detail
+
+}  // namespace spargel::task
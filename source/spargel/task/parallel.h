@@ -0,0 +1,166 @@
+#pragma once
+
+#include "spargel/base/atomic.h"
+#include "spargel/base/meta.h"
+#include "spargel/base/span.h"
+#include "spargel/base/types.h"
+#include "spargel/base/vector.h"
+#include "spargel/task/task_manager.h"
+
+namespace spargel::task {
+
+    namespace detail {
+        // Counts outstanding tasks. The waiter helps run tasks until the count drops to zero.
+        class Latch {
+        public:
+            explicit Latch(u32 count) : _state{count} {}
+
+            Latch(Latch const&) = delete;
+            Latch& operator=(Latch const&) = delete;
+
+            void add(u32 n) { _state.fetchAdd(n, base::MemoryOrder::relaxed); }
+
+            // The waiter may return, and destroy the latch, as soon as the count drops to zero,
+            // so the wake below can land on a stale address. That is tolerated: a futex or
+            // WaitOnAddress wake only compares the address, and anything waiting at a reused
+            // address rechecks its condition after a spurious wake.
+            void countDown() {
+                u32 prev = _state.fetchSub(1, base::MemoryOrder::acq_rel);
+                if (prev == (waiting_bit | 1)) {
+                    base::atomic_notify_all(_state.raw());
+                }
+            }
+
+            void wait(TaskManager* tm);
+
+        private:
+            // Set once the waiter sleeps, so the last `countDown` knows to wake it.
+            static constexpr u32 waiting_bit = 0x80000000;
+
+            base::Atomic<u32> _state;
+        };
+
+        // The grain for `count` items when the caller passed zero: about eight chunks per
+        // worker, so that stealing can even out uneven work.
+        usize auto_grain(TaskManager* tm, usize count);
+
+        template <typename F>
+        struct ForContext {
+            TaskManager* tm;
+            F* fn;
+            usize grain;
+            Latch latch{1};
+
+            // Split off the upper half until the range fits in a grain, then run it here.
+            void split(usize begin, usize end) {
+                while (end - begin > grain) {
+                    usize mid = begin + (end - begin) / 2;
+                    latch.add(1);
+                    tm->postTask([this, mid, end] {
+                        split(mid, end);
+                        latch.countDown();
+                    });
+                    end = mid;
+                }
+                (*fn)(begin, end);
+            }
+        };
+    }  // namespace detail
+
+    // Call `fn(chunk_begin, chunk_end)` over disjoint chunks covering `[begin, end)`, in
+    // parallel, and return when all calls have returned.
+    //
+    // Parameters:
+    //     - `grain` is the largest chunk. Zero picks one from the range and the worker count.
+    //
+    // Note:
+    //     - The calling thread runs a share of the chunks, and runs other tasks while waiting,
+    //       so the parallel helpers nest: `fn` may itself call `parallelFor`.
+    //     - Ranges of at most one grain run inline without posting anything.
+    //
+    template <typename F>
+    void parallelForRange(TaskManager* tm, usize begin, usize end, usize grain, F&& fn) {
+        if (begin >= end) return;
+        if (grain == 0) grain = detail::auto_grain(tm, end - begin);
+        if (end - begin <= grain) {
+            fn(begin, end);
+            return;
+        }
+        detail::ForContext<base::RemoveReference<F>> ctx{tm, &fn, grain};
+        ctx.split(begin, end);
+        ctx.latch.countDown();
+        ctx.latch.wait(tm);
+    }
+
+    // Call `fn(i)` for every `i` in `[begin, end)`, in parallel.
+    template <typename F>
+    void parallelFor(TaskManager* tm, usize begin, usize end, usize grain, F&& fn) {
+        parallelForRange(tm, begin, end, grain, [&fn](usize b, usize e) {
+            for (usize i = b; i < e; i++) {
+                fn(i);
+            }
+        });
+    }
+
+    // Call `fn(item)` for every item of `items`, in parallel.
+    template <typename T, typename F>
+    void parallelFor(TaskManager* tm, base::Span<T> items, usize grain, F&& fn) {
+        T const* data = items.data();
+        parallelForRange(tm, 0, items.count(), grain, [data, &fn](usize b, usize e) {
+            for (usize i = b; i < e; i++) {
+                fn(data[i]);
+            }
+        });
+    }
+
+    // Reduce `[begin, end)` in parallel.
+    //
+    // Each chunk is reduced by `chunk(chunk_begin, chunk_end)`, which returns a `T`. The
+    // partial results are then folded into `identity` with `combine(T, T)`, from left to
+    // right, on the calling thread. The result therefore does not depend on scheduling, even
+    // when `combine` is not associative (e.g. floating point addition).
+    //
+    template <typename T, typename F, typename R>
+    T parallelReduce(TaskManager* tm, usize begin, usize end, usize grain, T identity, F&& chunk,
+                     R&& combine) {
+        if (begin >= end) return identity;
+        usize count = end - begin;
+        if (grain == 0) grain = detail::auto_grain(tm, count);
+        usize chunks = (count + grain - 1) / grain;
+        if (chunks == 1) return combine(base::move(identity), chunk(begin, end));
+
+        base::vector<T> partials;
+        partials.reserve(chunks);
+        for (usize i = 0; i < chunks; i++) {
+            partials.emplace(identity);
+        }
+        parallelFor(tm, 0, chunks, 1, [&](usize i) {
+            usize b = begin + i * grain;
+            usize e = count - i * grain > grain ? b + grain : end;
+            partials[i] = chunk(b, e);
+        });
+        for (usize i = 0; i < chunks; i++) {
+            identity = combine(base::move(identity), base::move(partials[i]));
+        }
+        return identity;
+    }
+
+    // Call every function in parallel, and return when all of them have returned. The first
+    // one runs on the calling thread.
+    template <typename F, typename... Fs>
+    void parallelInvoke(TaskManager* tm, F&& first, Fs&&... rest) {
+        if constexpr (sizeof...(Fs) == 0) {
+            first();
+        } else {
+            detail::Latch latch(sizeof...(Fs));
+            (tm->postTask([&latch, &rest] {
+                rest();
+                latch.countDown();
+            }),
+             ...);
+            first();
+            latch.wait(tm);
+        }
+    }
+
+}  // namespace spargel::task
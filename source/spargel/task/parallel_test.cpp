@@ -0,0 +1,142 @@
+#include "spargel/task/parallel.h"
+
+#include "spargel/base/atomic.h"
+#include "spargel/base/check.h"
+#include "spargel/base/span.h"
+#include "spargel/base/test.h"
+#include "spargel/task/task_manager.h"
+
+namespace spargel::task {
+    namespace {
+        constexpr usize item_count = 10000;
+
+        void checkVisitedOnce(TaskManager* tm, usize grain) {
+            auto visits = new base::Atomic<u32>[item_count];
+            parallelFor(tm, 0, item_count, grain, [visits](usize i) {
+                visits[i].fetchAdd(1, base::MemoryOrder::relaxed);
+            });
+            for (usize i = 0; i < item_count; i++) {
+                spargel_check(visits[i].load() == 1);
+            }
+            delete[] visits;
+        }
+
+        TEST(ParallelFor_VisitsEveryIndexOnce) {
+            TaskManager* tm = TaskManager::create(4);
+            checkVisitedOnce(tm, 0);
+            checkVisitedOnce(tm, 1);
+            checkVisitedOnce(tm, 7);
+            checkVisitedOnce(tm, item_count);
+            delete tm;
+        }
+
+        TEST(ParallelFor_EmptyRange) {
+            TaskManager* tm = TaskManager::create(2);
+            int calls = 0;
+            parallelFor(tm, 5, 5, 0, [&calls](usize) { calls++; });
+            parallelFor(tm, 6, 5, 1, [&calls](usize) { calls++; });
+            parallelForRange(tm, 3, 3, 0, [&calls](usize, usize) { calls++; });
+            spargel_check(calls == 0);
+            spargel_check(parallelReduce(
+                              tm, 4, 4, 0, 42, [](usize, usize) { return 1; },
+                              [](int x, int y) { return x + y; }) == 42);
+            delete tm;
+        }
+
+        // `combine` is not associative, so only a left-to-right fold gives the serial result.
+        TEST(ParallelReduce_LeftToRight) {
+            TaskManager* tm = TaskManager::create(4);
+            auto chunk = [](usize b, usize e) {
+                u64 s = 0;
+                for (usize i = b; i < e; i++) s += i;
+                return s;
+            };
+            auto combine = [](u64 x, u64 y) { return x * 1000003 + y; };
+
+            usize grain = 13;
+            u64 expected = 1;
+            for (usize b = 0; b < item_count; b += grain) {
+                usize e = b + grain < item_count ? b + grain : item_count;
+                expected = combine(expected, chunk(b, e));
+            }
+            for (int round = 0; round < 10; round++) {
+                spargel_check(parallelReduce(tm, 0, item_count, grain, u64(1), chunk, combine) ==
+                              expected);
+            }
+
+            // The automatic grain depends on the worker count only, so floating point sums
+            // repeat exactly.
+            auto sum = [](usize b, usize e) {
+                f64 s = 0;
+                for (usize i = b; i < e; i++) s += 1.0 / static_cast<f64>(i + 1);
+                return s;
+            };
+            auto add = [](f64 x, f64 y) { return x + y; };
+            f64 first = parallelReduce(tm, 0, item_count, 0, 0.0, sum, add);
+            for (int round = 0; round < 10; round++) {
+                spargel_check(parallelReduce(tm, 0, item_count, 0, 0.0, sum, add) == first);
+            }
+            delete tm;
+        }
+
+        void nestedFor(TaskManager* tm, base::Atomic<u32>& count) {
+            parallelFor(tm, 0, 32, 1, [tm, &count](usize) {
+                parallelFor(tm, 0, 32, 1,
+                            [&count](usize) { count.fetchAdd(1, base::MemoryOrder::relaxed); });
+            });
+        }
+
+        // Waiting inside a task runs other tasks, so nesting does not deadlock even when every
+        // worker is waiting.
+        TEST(ParallelFor_Nested) {
+            TaskManager* tm = TaskManager::create(2);
+            base::Atomic<u32> count{0};
+            nestedFor(tm, count);
+            spargel_check(count.load() == 32 * 32);
+
+            base::Atomic<u32> in_tasks{0};
+            base::Atomic<u32> done{0};
+            for (int i = 0; i < 4; i++) {
+                tm->postTask([tm, &in_tasks, &done] {
+                    nestedFor(tm, in_tasks);
+                    done.fetchAdd(1, base::MemoryOrder::release);
+                });
+            }
+            while (done.load(base::MemoryOrder::acquire) != 4) {
+                if (!tm->runOneTask()) base::cpu_relax();
+            }
+            spargel_check(in_tasks.load() == 4 * 32 * 32);
+            delete tm;
+        }
+
+        TEST(ParallelFor_Span) {
+            TaskManager* tm = TaskManager::create(4);
+            u32 items[1000];
+            for (u32 i = 0; i < 1000; i++) {
+                items[i] = i;
+            }
+            base::Atomic<u32> sum{0};
+            base::Atomic<u32> calls{0};
+            parallelFor(tm, base::Span<u32>(items, items + 1000), 10, [&](u32 const& x) {
+                sum.fetchAdd(x, base::MemoryOrder::relaxed);
+                calls.fetchAdd(1, base::MemoryOrder::relaxed);
+            });
+            spargel_check(calls.load() == 1000);
+            spargel_check(sum.load() == 999 * 1000 / 2);
+            delete tm;
+        }
+
+        TEST(ParallelInvoke_RunsAll) {
+            TaskManager* tm = TaskManager::create(2);
+            base::Atomic<u32> a{0}, b{0}, c{0};
+            parallelInvoke(
+                tm, [&a] { a.fetchAdd(1); }, [&b] { b.fetchAdd(1); }, [&c] { c.fetchAdd(1); });
+            spargel_check(a.load() == 1 && b.load() == 1 && c.load() == 1);
+            int only = 0;
+            parallelInvoke(tm, [&only] { only++; });
+            spargel_check(only == 1);
+            delete tm;
+        }
+
+    }  // namespace
+}  // namespace spargel::task
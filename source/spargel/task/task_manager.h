@@ -1,6 +1,10 @@
 #pragma once
 
+#include "spargel/base/concept.h"
 #include "spargel/base/meta.h"
+#include "spargel/base/trace.h"
+#include "spargel/base/types.h"
+#include "spargel/task/task_node.h"
 
 namespace spargel::task {
     class Task {
@@ -8,25 +12,56 @@ namespace spargel::task {
         virtual ~Task() = default;
         virtual void execute() = 0;
     };
-    namespace detail {
-        template <typename F>
-        struct TaskAdapter final : public Task {
-            void execute() override { func(); }
-            F func;
-        };
-    }  // namespace detail
     class TaskManager {
     public:
-        static TaskManager* create();
+        // Parameters:
+        //     - `worker_count` is the number of worker threads. Zero means one per online core.
+        //       Backends that manage their own threads (e.g. libdispatch) ignore it.
+        //
+        static TaskManager* create(u32 worker_count = 0);
 
         virtual ~TaskManager() = default;
 
+        // Ownership is transferred to the TaskManager. The manager calls `run()` on the node.
+        virtual void postNode(TaskNode* node) = 0;
+
+        // The number of threads that run tasks.
+        virtual u32 workerCount() const = 0;
+
+        // Run one pending task on the calling thread, if there is one. Return whether a task ran.
+        //
+        // A thread that waits for other tasks calls this in a loop, so that waiting inside a
+        // task does not take a worker away from the pool. Backends that cannot hand out tasks
+        // return false.
+        //
+        virtual bool runOneTask() { return false; }
+
         // Ownership is transferred to the TaskManager.
-        virtual void postTask(Task* task) = 0;
+        void postTask(Task* task) {
+            postNode(TaskNode::create([task] {
+                task->execute();
+                delete task;
+            }));
+        }
 
+        // Callables of at most `TaskNode::inline_size` bytes are posted without allocation.
+        //
+        // With tracing on, a flow event connects the poster to the region of the task.
         template <typename F>
+            requires(!base::ConvertibleTo<F, Task*>)
         void postTask(F&& f) {
-            postTask(new detail::TaskAdapter<F>{base::forward<F>(f)});
+#if SPARGEL_ENABLE_TRACING
+            u64 flow = base::TraceEngine::getInstance()->newFlowId();
+            spargel_trace_flow_begin("postTask", flow);
+            auto traced = [g = base::RemoveCVRef<F>(base::forward<F>(f)), flow]() mutable {
+                spargel_trace_scope("task");
+                spargel_trace_flow_end("postTask", flow);
+                g();
+            };
+            postNode(TaskNode::create(base::move(traced)));
+#else
+            postNode(TaskNode::create(base::forward<F>(f)));
+#endif
         }
     };
 }  // namespace spargel::task
@@ -0,0 +1,182 @@
+#include "spargel/task/task_manager_linux.h"
+
+#include "spargel/base/check.h"
+#include "spargel/base/trace.h"
+
+// libc
+#include <unistd.h>
+
+namespace spargel::task {
+
+    namespace {
+        // The worker running on this thread, if any.
+        thread_local void* current_worker = nullptr;
+        // The steal victim sequence of threads outside the pool.
+        thread_local u64 external_rng = 0x2545f4914f6cdd1dull;
+
+        constexpr u32 spin_rounds = 64;
+
+        u64 nextRandom(u64& state) {
+            // xorshift64
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            return state;
+        }
+    }  // namespace
+
+    TaskManager* TaskManager::create(u32 worker_count) {
+        return new TaskManagerLinux(worker_count);
+    }
+
+    TaskManagerLinux::TaskManagerLinux(u32 worker_count) {
+        if (worker_count == 0) {
+            long n = sysconf(_SC_NPROCESSORS_ONLN);
+            worker_count = n > 0 ? static_cast<u32>(n) : 1;
+        }
+        _workers.reserve(worker_count);
+        for (u32 i = 0; i < worker_count; i++) {
+            _workers.emplace(new Worker(this, i));
+        }
+        // Start the threads only after `_workers` is complete, since thieves read it.
+        for (auto w : _workers) {
+            int err = pthread_create(&w->thread, nullptr, workerMain, w);
+            spargel_check(err == 0);
+        }
+    }
+
+    TaskManagerLinux::~TaskManagerLinux() {
+        _stop.store(true);
+        _epoch.fetchAdd(1);
+        base::atomic_notify_all(_epoch.raw());
+        for (auto w : _workers) {
+            pthread_join(w->thread, nullptr);
+        }
+        for (auto w : _workers) {
+            delete w;
+        }
+    }
+
+    void TaskManagerLinux::postNode(TaskNode* node) {
+        auto self = static_cast<Worker*>(current_worker);
+        if (self != nullptr && self->manager == this) {
+            self->deque.push(node);
+        } else {
+            base::LockGuard guard(_inject_lock);
+            node->next = nullptr;
+            if (_inject_tail != nullptr) {
+                _inject_tail->next = node;
+            } else {
+                _inject_head = node;
+            }
+            _inject_tail = node;
+            usize depth = _inject_count.fetchAdd(1, base::MemoryOrder::relaxed) + 1;
+            spargel_trace_counter("task injection queue", depth);
+        }
+        // Pairs with the fence in `park`: either we see the sleeper, or it sees the task.
+        base::atomic_fence(base::MemoryOrder::seq_cst);
+        if (_sleepers.load(base::MemoryOrder::relaxed) > 0) {
+            wakeOne();
+        }
+    }
+
+    bool TaskManagerLinux::runOneTask() {
+        auto self = static_cast<Worker*>(current_worker);
+        TaskNode* node;
+        if (self != nullptr && self->manager == this) {
+            node = findTask(self);
+        } else {
+            node = popInjected();
+            if (node == nullptr) node = steal(nullptr);
+        }
+        if (node == nullptr) return false;
+        node->run();
+        return true;
+    }
+
+    void* TaskManagerLinux::workerMain(void* arg) {
+        auto self = static_cast<Worker*>(arg);
+        current_worker = self;
+        self->manager->run(self);
+        current_worker = nullptr;
+        return nullptr;
+    }
+
+    void TaskManagerLinux::run(Worker* self) {
+        for (;;) {
+            TaskNode* node = findTask(self);
+            if (node == nullptr) {
+                for (u32 i = 0; i < spin_rounds && node == nullptr; i++) {
+                    base::cpu_relax();
+                    node = findTask(self);
+                }
+            }
+            if (node != nullptr) {
+                node->run();
+                continue;
+            }
+            if (_stop.load(base::MemoryOrder::acquire)) {
+                // Every task posted before the destructor has been taken by some worker.
+                return;
+            }
+            park();
+        }
+    }
+
+    TaskNode* TaskManagerLinux::findTask(Worker* self) {
+        TaskNode* node;
+        if (self->deque.pop(node)) return node;
+        node = popInjected();
+        if (node != nullptr) return node;
+        return steal(self);
+    }
+
+    TaskNode* TaskManagerLinux::popInjected() {
+        if (_inject_count.load(base::MemoryOrder::relaxed) == 0) return nullptr;
+
+        base::LockGuard guard(_inject_lock);
+        TaskNode* node = _inject_head;
+        if (node == nullptr) return nullptr;
+        _inject_head = node->next;
+        if (_inject_head == nullptr) _inject_tail = nullptr;
+        _inject_count.fetchSub(1, base::MemoryOrder::relaxed);
+        return node;
+    }
+
+    TaskNode* TaskManagerLinux::steal(Worker* self) {
+        usize n = _workers.count();
+        if (n == 0 || (n == 1 && self != nullptr)) return nullptr;
+        u64& rng = self != nullptr ? self->rng : external_rng;
+        usize start = static_cast<usize>(nextRandom(rng) % n);
+        for (usize i = 0; i < n; i++) {
+            Worker* victim = _workers[(start + i) % n];
+            if (victim == self) continue;
+            TaskNode* node;
+            if (victim->deque.steal(node)) return node;
+        }
+        return nullptr;
+    }
+
+    void TaskManagerLinux::park() {
+        _sleepers.fetchAdd(1);
+        u32 epoch = _epoch.load();
+        base::atomic_fence(base::MemoryOrder::seq_cst);
+
+        // The final check, after registering as a sleeper.
+        bool has_work = _inject_count.load(base::MemoryOrder::relaxed) > 0;
+        for (usize i = 0; i < _workers.count() && !has_work; i++) {
+            has_work = !_workers[i]->deque.isEmpty();
+        }
+        if (!has_work && !_stop.load(base::MemoryOrder::acquire)) {
+            base::atomic_wait(_epoch.raw(), epoch);
+        }
+
+        _sleepers.fetchSub(1);
+    }
+
+    void TaskManagerLinux::wakeOne() {
+        _epoch.fetchAdd(1);
+        base::atomic_notify_one(_epoch.raw());
+    }
+
+}  // namespace spargel::task
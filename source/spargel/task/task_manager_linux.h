@@ -0,0 +1,79 @@
+#pragma once
+
+#include "spargel/base/atomic.h"
+#include "spargel/base/types.h"
+#include "spargel/base/vector.h"
+#include "spargel/task/task_manager.h"
+#include "spargel/task/work_stealing_deque.h"
+
+// libc
+#include <pthread.h>
+
+namespace spargel::task {
+
+    // TaskManagerLinux
+    //
+    // A work-stealing thread pool.
+    //
+    // Every worker owns a `WorkStealingDeque`. Tasks posted from a worker go to its own deque
+    // and run LIFO, which keeps the working set hot. Tasks posted from other threads go to a
+    // shared injection queue. An idle worker first drains its own deque, then the injection
+    // queue, then steals from a random victim, and finally parks on a futex.
+    //
+    // Note:
+    //     - The destructor runs every task posted before it, then joins the workers.
+    //     - There is no ordering between tasks.
+    //
+    class TaskManagerLinux final : public TaskManager {
+    public:
+        // Parameters:
+        //     - `worker_count` is the number of worker threads. Zero means one per online core.
+        //
+        explicit TaskManagerLinux(u32 worker_count = 0);
+        ~TaskManagerLinux() override;
+
+        TaskManagerLinux(TaskManagerLinux const&) = delete;
+        TaskManagerLinux& operator=(TaskManagerLinux const&) = delete;
+
+        void postNode(TaskNode* node) override;
+        u32 workerCount() const override { return static_cast<u32>(_workers.count()); }
+        bool runOneTask() override;
+
+    private:
+        struct Worker {
+            Worker(TaskManagerLinux* m, u32 i)
+                : manager{m}, index{i}, rng{0x9e3779b97f4a7c15ull * (i + 1)} {}
+
+            TaskManagerLinux* manager;
+            u32 index;
+            u64 rng;
+            pthread_t thread;
+            WorkStealingDeque<TaskNode*> deque;
+        };
+
+        static void* workerMain(void* arg);
+
+        void run(Worker* self);
+        TaskNode* findTask(Worker* self);
+        TaskNode* popInjected();
+        // `self` is null for threads outside the pool.
+        TaskNode* steal(Worker* self);
+        void park();
+        void wakeOne();
+
+        base::vector<Worker*> _workers;
+
+        // The injection queue, a FIFO linked through `TaskNode::next`.
+        base::SpinLock _inject_lock;
+        TaskNode* _inject_head = nullptr;
+        TaskNode* _inject_tail = nullptr;
+        base::Atomic<usize> _inject_count{0};
+
+        // Parking. A worker registers in `_sleepers` before its final check for work, and
+        // waits on `_epoch`. A poster that sees a sleeper bumps `_epoch` and wakes one.
+        base::Atomic<u32> _epoch{0};
+        base::Atomic<u32> _sleepers{0};
+        base::Atomic<bool> _stop{false};
+    };
+
+}  // namespace spargel::task
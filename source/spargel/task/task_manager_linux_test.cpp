@@ -0,0 +1,120 @@
+#include "spargel/task/task_manager_linux.h"
+
+#include "spargel/base/atomic.h"
+#include "spargel/base/check.h"
+#include "spargel/base/test.h"
+
+// libc
+#include <time.h>
+
+namespace spargel::task {
+    namespace {
+        constexpr u32 task_count = 20000;
+
+        void sleepMs(long ms) {
+            timespec ts{0, ms * 1000000};
+            nanosleep(&ts, nullptr);
+        }
+
+        void waitFor(base::Atomic<u32>& counter, u32 target) {
+            while (counter.load(base::MemoryOrder::acquire) != target) {
+                base::cpu_relax();
+            }
+        }
+
+        // Through the injection queue.
+        TEST(TaskManagerLinux_ExternalTasksRunOnce) {
+            auto runs = new base::Atomic<u32>[task_count];
+            base::Atomic<u32> done{0};
+            {
+                TaskManagerLinux tm(4);
+                spargel_check(tm.workerCount() == 4);
+                for (u32 i = 0; i < task_count; i++) {
+                    tm.postTask([runs, i, &done] {
+                        runs[i].fetchAdd(1, base::MemoryOrder::relaxed);
+                        done.fetchAdd(1, base::MemoryOrder::release);
+                    });
+                }
+                waitFor(done, task_count);
+            }
+            for (u32 i = 0; i < task_count; i++) {
+                spargel_check(runs[i].load() == 1);
+            }
+            delete[] runs;
+        }
+
+        // Through the deque of the posting worker, which grows past its initial capacity while
+        // the other workers steal from it.
+        TEST(TaskManagerLinux_WorkerTasksRunOnce) {
+            auto runs = new base::Atomic<u32>[task_count];
+            base::Atomic<u32> done{0};
+            {
+                TaskManagerLinux tm(4);
+                tm.postTask([&tm, runs, &done] {
+                    for (u32 i = 0; i < task_count; i++) {
+                        tm.postTask([runs, i, &done] {
+                            runs[i].fetchAdd(1, base::MemoryOrder::relaxed);
+                            done.fetchAdd(1, base::MemoryOrder::release);
+                        });
+                    }
+                });
+                waitFor(done, task_count);
+            }
+            for (u32 i = 0; i < task_count; i++) {
+                spargel_check(runs[i].load() == 1);
+            }
+            delete[] runs;
+        }
+
+        // The workers park once idle. A task posted then wakes one of them.
+        TEST(TaskManagerLinux_WakeParkedWorker) {
+            TaskManagerLinux tm(2);
+            base::Atomic<u32> done{0};
+            for (u32 round = 1; round <= 5; round++) {
+                sleepMs(20);
+                tm.postTask([&done] { done.fetchAdd(1, base::MemoryOrder::release); });
+                waitFor(done, round);
+            }
+        }
+
+        // A thread outside the pool runs tasks with `runOneTask` while the only worker is busy.
+        TEST(TaskManagerLinux_RunOneTask) {
+            TaskManagerLinux tm(1);
+            base::Atomic<bool> blocked{false};
+            base::Atomic<bool> release{false};
+            tm.postTask([&blocked, &release] {
+                blocked.store(true, base::MemoryOrder::release);
+                while (!release.load(base::MemoryOrder::acquire)) {
+                    base::cpu_relax();
+                }
+            });
+            while (!blocked.load(base::MemoryOrder::acquire)) {
+                base::cpu_relax();
+            }
+
+            u32 ran = 0;
+            for (u32 i = 0; i < 100; i++) {
+                tm.postTask([&ran] { ran++; });
+            }
+            u32 helped = 0;
+            while (tm.runOneTask()) {
+                helped++;
+            }
+            spargel_check(helped == 100 && ran == 100);
+            release.store(true, base::MemoryOrder::release);
+        }
+
+        // The destructor runs every pending task before it joins the workers.
+        TEST(TaskManagerLinux_DestructorDrains) {
+            base::Atomic<u32> done{0};
+            auto tm = new TaskManagerLinux(2);
+            tm->postTask([] { sleepMs(10); });
+            for (u32 i = 0; i < task_count; i++) {
+                tm->postTask([&done] { done.fetchAdd(1, base::MemoryOrder::relaxed); });
+            }
+            delete tm;
+            spargel_check(done.load() == task_count);
+        }
+
+    }  // namespace
+}  // namespace spargel::task
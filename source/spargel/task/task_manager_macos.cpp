@@ -1,5 +1,19 @@
 #include "spargel/task/task_manager_macos.h"
 
+// libc
+#include <dispatch/dispatch.h>
+#include <unistd.h>
+
 namespace spargel::task {
-    TaskManager* TaskManager::create() { return new TaskManagerMac; }
+    TaskManager* TaskManager::create(u32) { return new TaskManagerMac; }
+
+    TaskManagerMac::TaskManagerMac() {
+        long n = sysconf(_SC_NPROCESSORS_ONLN);
+        _worker_count = n > 0 ? static_cast<u32>(n) : 1;
+    }
+
+    void TaskManagerMac::postNode(TaskNode* node) {
+        dispatch_async_f(dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), node,
+                         [](void* ctx) { static_cast<TaskNode*>(ctx)->run(); });
+    }
 }  // namespace spargel::task
@@ -3,8 +3,22 @@
 #include "spargel/task/task_manager.h"
 
 namespace spargel::task {
+    // TaskManagerMac
+    //
+    // Posts every node to a global concurrent dispatch queue.
+    //
+    // Note:
+    //     - libdispatch does not hand out queued work, so `runOneTask()` always returns false
+    //       and waiting threads block.
+    //
     class TaskManagerMac final : public TaskManager {
     public:
-        void postTask(Task*) override {}
+        TaskManagerMac();
+
+        void postNode(TaskNode* node) override;
+        u32 workerCount() const override { return _worker_count; }
+
+    private:
+        u32 _worker_count;
     };
 }  // namespace spargel::task
@@ -0,0 +1,100 @@
+#include "spargel/task/task_node.h"
+
+#include "spargel/base/allocator.h"
+#include "spargel/base/atomic.h"
+
+namespace spargel::task {
+
+    namespace {
+        // Nodes move between threads in batches of this many.
+        constexpr usize batch_size = 64;
+        // Nodes obtained from the system at once.
+        constexpr usize chunk_nodes = 256;
+
+        // Full batches given back by threads that free more nodes than they create.
+        base::SpinLock global_lock;
+        TaskNode* global_batches = nullptr;
+        base::Atomic<usize> total_nodes{0};
+    }  // namespace
+
+    // Two lists give hysteresis: a thread that creates and runs nodes at the same rate never
+    // touches the global lock.
+    struct TaskNode::Cache {
+        // Nodes ready for reuse, linked through `next`.
+        TaskNode* active = nullptr;
+        // Roughly the nodes recycled into `active` since it was last refilled.
+        usize active_count = 0;
+        // A full batch, or null.
+        TaskNode* spill = nullptr;
+
+        ~Cache() {
+            // Give the nodes back when the thread exits.
+            if (spill != nullptr) pushBatch(spill);
+            if (active != nullptr) pushBatch(active);
+        }
+    };
+
+    TaskNode::Cache& TaskNode::cache() {
+        thread_local Cache c;
+        return c;
+    }
+
+    usize TaskNode::totalNodeCount() { return total_nodes.load(base::MemoryOrder::relaxed); }
+
+    // A batch is a list of nodes. The head of a batch keeps the next batch in its storage.
+    void TaskNode::pushBatch(TaskNode* batch) {
+        base::LockGuard guard(global_lock);
+        *reinterpret_cast<TaskNode**>(batch->_storage) = global_batches;
+        global_batches = batch;
+    }
+
+    TaskNode* TaskNode::popBatch() {
+        base::LockGuard guard(global_lock);
+        TaskNode* batch = global_batches;
+        if (batch != nullptr) {
+            global_batches = *reinterpret_cast<TaskNode**>(batch->_storage);
+        }
+        return batch;
+    }
+
+    TaskNode* TaskNode::allocate() {
+        Cache& c = cache();
+        if (c.active == nullptr) [[unlikely]] {
+            if (c.spill != nullptr) {
+                c.active = c.spill;
+                c.spill = nullptr;
+            } else if (TaskNode* batch = popBatch()) {
+                c.active = batch;
+            } else {
+                void* p = base::default_allocator()->allocate(sizeof(TaskNode) * chunk_nodes);
+                auto nodes = static_cast<TaskNode*>(p);
+                for (usize i = 0; i < chunk_nodes; i++) {
+                    base::construct_at(&nodes[i]);
+                    nodes[i].next = i + 1 < chunk_nodes ? &nodes[i + 1] : nullptr;
+                }
+                total_nodes.fetchAdd(chunk_nodes, base::MemoryOrder::relaxed);
+                c.active = nodes;
+            }
+            c.active_count = 0;
+        }
+        TaskNode* node = c.active;
+        c.active = node->next;
+        if (c.active_count > 0) c.active_count--;
+        node->next = nullptr;
+        return node;
+    }
+
+    void TaskNode::recycle(TaskNode* node) {
+        Cache& c = cache();
+        node->next = c.active;
+        c.active = node;
+        c.active_count++;
+        if (c.active_count == batch_size) [[unlikely]] {
+            if (c.spill != nullptr) pushBatch(c.spill);
+            c.spill = c.active;
+            c.active = nullptr;
+            c.active_count = 0;
+        }
+    }
+
+}  // namespace spargel::task
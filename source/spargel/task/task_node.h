@@ -0,0 +1,88 @@
+#pragma once
+
+#include "spargel/base/meta.h"
+#include "spargel/base/object.h"
+#include "spargel/base/types.h"
+
+namespace spargel::task {
+
+    // TaskNode
+    //
+    // An intrusive, type-erased task. A node is one cache line: a function pointer, a link for
+    // the scheduler's queues, and inline storage for the callable.
+    //
+    // Nodes are recycled through per-thread free lists, so posting a task whose callable fits
+    // in `inline_size` bytes does not touch the heap. Larger callables are boxed on the heap.
+    //
+    // Note:
+    //     - Free lists rebalance through a global list in batches, so a node may be created on
+    //       one thread and run on another.
+    //     - Node memory is never returned to the system.
+    //
+    class alignas(16) TaskNode {
+    public:
+        static constexpr usize inline_size = 48;
+        static constexpr usize inline_align = 16;
+
+        template <typename F>
+        static TaskNode* create(F&& f) {
+            using G = base::RemoveCVRef<F>;
+            TaskNode* node = allocate();
+            if constexpr (fitsInline<G>()) {
+                base::construct_at(reinterpret_cast<G*>(node->_storage), base::forward<F>(f));
+                node->_invoke = &invokeInline<G>;
+            } else {
+                *reinterpret_cast<G**>(node->_storage) = new G(base::forward<F>(f));
+                node->_invoke = &invokeBoxed<G>;
+            }
+            return node;
+        }
+
+        // Run the callable, then destroy it and recycle the node.
+        void run() {
+            _invoke(this);
+            recycle(this);
+        }
+
+        // For the scheduler's intrusive queues.
+        TaskNode* next = nullptr;
+
+        // The number of nodes obtained from the system, for diagnostics.
+        static usize totalNodeCount();
+
+    private:
+        template <typename G>
+        static constexpr bool fitsInline() {
+            return sizeof(G) <= inline_size && alignof(G) <= inline_align;
+        }
+
+        template <typename G>
+        static void invokeInline(TaskNode* node) {
+            auto g = reinterpret_cast<G*>(node->_storage);
+            (*g)();
+            base::destruct_at(g);
+        }
+
+        template <typename G>
+        static void invokeBoxed(TaskNode* node) {
+            auto g = *reinterpret_cast<G**>(node->_storage);
+            (*g)();
+            delete g;
+        }
+
+        // The per-thread free lists, see task_node.cpp.
+        struct Cache;
+        static Cache& cache();
+
+        static TaskNode* allocate();
+        static void recycle(TaskNode* node);
+        static void pushBatch(TaskNode* batch);
+        static TaskNode* popBatch();
+
+        void (*_invoke)(TaskNode*) = nullptr;
+        alignas(inline_align) base::Byte _storage[inline_size];
+    };
+
+    static_assert(sizeof(TaskNode) == 64);
+
+}  // namespace spargel::task
@@ -0,0 +1,112 @@
+#include "spargel/task/task_node.h"
+
+#include "spargel/base/check.h"
+#include "spargel/base/test.h"
+
+// libc
+#include <pthread.h>
+
+namespace spargel::task {
+    namespace {
+        // Counts the live copies of a callable, and the calls.
+        struct Counted {
+            static inline int live = 0;
+            static inline int calls = 0;
+
+            Counted() { live++; }
+            Counted(Counted const&) { live++; }
+            Counted(Counted&&) { live++; }
+            ~Counted() { live--; }
+
+            void operator()() const { calls++; }
+        };
+
+        struct Big : Counted {
+            u8 padding[TaskNode::inline_size + 16] = {};
+        };
+
+        static_assert(sizeof(Counted) <= TaskNode::inline_size);
+        static_assert(sizeof(Big) > TaskNode::inline_size);
+
+        TEST(TaskNode_InlineCallable) {
+            Counted::live = 0;
+            Counted::calls = 0;
+            TaskNode* node = TaskNode::create(Counted{});
+            spargel_check(Counted::live == 1);
+            node->run();
+            spargel_check(Counted::calls == 1);
+            spargel_check(Counted::live == 0);
+        }
+
+        TEST(TaskNode_BoxedCallable) {
+            Counted::live = 0;
+            Counted::calls = 0;
+            Big big;
+            TaskNode* node = TaskNode::create(big);
+            spargel_check(Counted::live == 2);
+            node->run();
+            spargel_check(Counted::calls == 1);
+            spargel_check(Counted::live == 1);
+        }
+
+        // A node run on the thread that created it goes back to the front of its free list.
+        TEST(TaskNode_ThreadCacheReuse) {
+            int x = 0;
+            TaskNode* first = TaskNode::create([&x] { x++; });
+            first->run();
+            usize total = TaskNode::totalNodeCount();
+            for (int i = 0; i < 10000; i++) {
+                TaskNode* node = TaskNode::create([&x] { x++; });
+                spargel_check(node == first);
+                node->run();
+            }
+            spargel_check(x == 10001);
+            spargel_check(TaskNode::totalNodeCount() == total);
+        }
+
+        constexpr usize handoff_nodes = 300;
+
+        struct Handoff {
+            TaskNode* nodes[handoff_nodes];
+            int runs = 0;
+        };
+
+        void* create_nodes(void* arg) {
+            auto h = static_cast<Handoff*>(arg);
+            for (usize i = 0; i < handoff_nodes; i++) {
+                h->nodes[i] = TaskNode::create([h] { h->runs++; });
+            }
+            return nullptr;
+        }
+
+        void* run_nodes(void* arg) {
+            auto h = static_cast<Handoff*>(arg);
+            for (usize i = 0; i < handoff_nodes; i++) {
+                h->nodes[i]->run();
+            }
+            return nullptr;
+        }
+
+        void run_thread(void* (*fn)(void*), Handoff* h) {
+            pthread_t thread;
+            pthread_create(&thread, nullptr, fn, h);
+            pthread_join(thread, nullptr);
+        }
+
+        // Nodes created on one thread and run on another go through the global list in
+        // batches, where a third thread finds them instead of asking the system for more.
+        TEST(TaskNode_BatchHandoff) {
+            Handoff h;
+            run_thread(create_nodes, &h);
+            usize total = TaskNode::totalNodeCount();
+            run_thread(run_nodes, &h);
+            spargel_check(h.runs == static_cast<int>(handoff_nodes));
+
+            run_thread(create_nodes, &h);
+            spargel_check(TaskNode::totalNodeCount() == total);
+            run_thread(run_nodes, &h);
+            spargel_check(h.runs == static_cast<int>(2 * handoff_nodes));
+        }
+
+    }  // namespace
+}  // namespace spargel::task
@@ -0,0 +1,152 @@
+#pragma once
+
+#include "spargel/base/allocator.h"
+#include "spargel/base/atomic.h"
+#include "spargel/base/check.h"
+#include "spargel/base/object.h"
+#include "spargel/base/types.h"
+
+namespace spargel::task {
+
+    // WorkStealingDeque
+    //
+    // The Chase-Lev deque, with the memory orders of "Correct and Efficient Work-Stealing for
+    // Weak Memory Models" (Le et al., PPoPP 2013).
+    //
+    // The owner thread pushes and pops at the bottom (LIFO). Other threads steal from the top
+    // (FIFO). The buffer grows when full. Old buffers are kept until the deque is destroyed,
+    // since a concurrent thief may still read from them.
+    //
+    // Note:
+    //     - `T` must be trivially copyable and fit in a machine word, e.g. a pointer.
+    //
+    template <typename T>
+    class WorkStealingDeque {
+    public:
+        explicit WorkStealingDeque(usize capacity = 256) {
+            spargel_check(capacity > 0 && (capacity & (capacity - 1)) == 0);
+            _buffer.store(Buffer::create(capacity, nullptr), base::MemoryOrder::relaxed);
+        }
+        ~WorkStealingDeque() {
+            Buffer* b = _buffer.load(base::MemoryOrder::relaxed);
+            while (b != nullptr) {
+                Buffer* prev = b->prev;
+                Buffer::destroy(b);
+                b = prev;
+            }
+        }
+
+        WorkStealingDeque(WorkStealingDeque const&) = delete;
+        WorkStealingDeque& operator=(WorkStealingDeque const&) = delete;
+
+        // Owner only.
+        void push(T item) {
+            i64 b = _bottom.load(base::MemoryOrder::relaxed);
+            i64 t = _top.load(base::MemoryOrder::acquire);
+            Buffer* buf = _buffer.load(base::MemoryOrder::relaxed);
+            if (b - t > static_cast<i64>(buf->mask)) {
+                buf = grow(buf, t, b);
+            }
+            buf->put(b, item);
+            // A release store rather than the paper's release fence, which sanitizers do not
+            // model. Same cost on x86 and ARMv8.
+            _bottom.store(b + 1, base::MemoryOrder::release);
+        }
+
+        // Owner only. Return `false` if the deque is empty.
+        bool pop(T& out) {
+            i64 b = _bottom.load(base::MemoryOrder::relaxed) - 1;
+            Buffer* buf = _buffer.load(base::MemoryOrder::relaxed);
+            _bottom.store(b, base::MemoryOrder::relaxed);
+            base::atomic_fence(base::MemoryOrder::seq_cst);
+            i64 t = _top.load(base::MemoryOrder::relaxed);
+            if (t > b) {
+                // Empty.
+                _bottom.store(b + 1, base::MemoryOrder::relaxed);
+                return false;
+            }
+            out = buf->get(b);
+            if (t == b) {
+                // The last item. Race against thieves for it.
+                bool won = _top.compareExchange(t, t + 1, base::MemoryOrder::seq_cst,
+                                                base::MemoryOrder::relaxed);
+                _bottom.store(b + 1, base::MemoryOrder::relaxed);
+                return won;
+            }
+            return true;
+        }
+
+        // Any thread. Return `false` if the deque is empty or the steal lost a race.
+        bool steal(T& out) {
+            i64 t = _top.load(base::MemoryOrder::acquire);
+            base::atomic_fence(base::MemoryOrder::seq_cst);
+            i64 b = _bottom.load(base::MemoryOrder::acquire);
+            if (t >= b) return false;
+            Buffer* buf = _buffer.load(base::MemoryOrder::acquire);
+            T item = buf->get(t);
+            if (!_top.compareExchange(t, t + 1, base::MemoryOrder::seq_cst,
+                                      base::MemoryOrder::relaxed)) {
+                return false;
+            }
+            out = item;
+            return true;
+        }
+
+        // A racy estimate, for heuristics only.
+        bool isEmpty() const {
+            return _bottom.load(base::MemoryOrder::relaxed) <=
+                   _top.load(base::MemoryOrder::relaxed);
+        }
+
+    private:
+        struct Buffer {
+            usize mask;
+            Buffer* prev;
+
+            // The items follow the header.
+            base::Atomic<T>* items() { return reinterpret_cast<base::Atomic<T>*>(this + 1); }
+            base::Atomic<T> const* items() const {
+                return reinterpret_cast<base::Atomic<T> const*>(this + 1);
+            }
+
+            static Buffer* create(usize capacity, Buffer* prev) {
+                void* p = base::default_allocator()->allocate(allocSize(capacity));
+                auto buf = static_cast<Buffer*>(p);
+                buf->mask = capacity - 1;
+                buf->prev = prev;
+                for (usize i = 0; i < capacity; i++) {
+                    base::construct_at(&buf->items()[i]);
+                }
+                return buf;
+            }
+            static void destroy(Buffer* buf) {
+                base::default_allocator()->free(buf, allocSize(buf->mask + 1));
+            }
+            static usize allocSize(usize capacity) {
+                return sizeof(Buffer) + sizeof(base::Atomic<T>) * capacity;
+            }
+
+            T get(i64 i) const {
+                return items()[static_cast<usize>(i) & mask].load(base::MemoryOrder::relaxed);
+            }
+            void put(i64 i, T item) {
+                items()[static_cast<usize>(i) & mask].store(item, base::MemoryOrder::relaxed);
+            }
+        };
+
+        Buffer* grow(Buffer* old, i64 t, i64 b) {
+            Buffer* buf = Buffer::create((old->mask + 1) * 2, old);
+            for (i64 i = t; i < b; i++) {
+                buf->put(i, old->get(i));
+            }
+            _buffer.store(buf, base::MemoryOrder::release);
+            return buf;
+        }
+
+        // Keep the owner's end and the thieves' end on separate cache lines.
+        alignas(64) base::Atomic<i64> _top{0};
+        alignas(64) base::Atomic<i64> _bottom{0};
+        alignas(64) base::Atomic<Buffer*> _buffer{nullptr};
+    };
+
+}  // namespace spargel::task
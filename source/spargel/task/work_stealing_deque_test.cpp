@@ -0,0 +1,104 @@
+#include "spargel/task/work_stealing_deque.h"
+
+#include "spargel/base/atomic.h"
+#include "spargel/base/check.h"
+#include "spargel/base/test.h"
+
+// libc
+#include <pthread.h>
+
+namespace spargel::task {
+    namespace {
+        TEST(WorkStealingDeque_OwnerLifo) {
+            WorkStealingDeque<usize> deque(4);
+            usize x;
+            spargel_check(deque.isEmpty());
+            spargel_check(!deque.pop(x));
+            spargel_check(!deque.steal(x));
+
+            // Past the initial capacity, twice.
+            for (usize i = 0; i < 13; i++) {
+                deque.push(i);
+            }
+            spargel_check(!deque.isEmpty());
+            for (usize i = 13; i-- > 0;) {
+                spargel_check(deque.pop(x) && x == i);
+            }
+            spargel_check(!deque.pop(x));
+            spargel_check(deque.isEmpty());
+        }
+
+        TEST(WorkStealingDeque_StealFifo) {
+            WorkStealingDeque<usize> deque(2);
+            for (usize i = 0; i < 10; i++) {
+                deque.push(i);
+            }
+            usize x;
+            spargel_check(deque.steal(x) && x == 0);
+            spargel_check(deque.steal(x) && x == 1);
+            spargel_check(deque.pop(x) && x == 9);
+            // Grow again while the items sit in the middle of the buffer.
+            for (usize i = 10; i < 20; i++) {
+                deque.push(i);
+            }
+            for (usize i = 2; i < 9; i++) {
+                spargel_check(deque.steal(x) && x == i);
+            }
+            for (usize i = 10; i < 20; i++) {
+                spargel_check(deque.steal(x) && x == i);
+            }
+            spargel_check(!deque.steal(x));
+        }
+
+        constexpr usize race_items = 100000;
+        constexpr int thief_count = 3;
+
+        struct Race {
+            WorkStealingDeque<usize> deque{4};
+            base::Atomic<u32> taken[race_items];
+            base::Atomic<bool> done{false};
+        };
+
+        void* thief_main(void* arg) {
+            auto race = static_cast<Race*>(arg);
+            for (;;) {
+                // Read `done` first: once it is set, nothing more is pushed.
+                bool last = race->done.load(base::MemoryOrder::acquire);
+                usize x;
+                while (race->deque.steal(x)) {
+                    race->taken[x].fetchAdd(1, base::MemoryOrder::relaxed);
+                }
+                if (last && race->deque.isEmpty()) return nullptr;
+            }
+        }
+
+        // The owner pushes and pops while thieves steal. Every item is taken exactly once.
+        TEST(WorkStealingDeque_Race) {
+            auto race = new Race;
+            pthread_t thieves[thief_count];
+            for (int i = 0; i < thief_count; i++) {
+                pthread_create(&thieves[i], nullptr, thief_main, race);
+            }
+            usize x;
+            for (usize i = 0; i < race_items; i++) {
+                race->deque.push(i);
+                // Pop one item for every three pushed, so the deque both grows and empties.
+                if (i % 3 == 2 && race->deque.pop(x)) {
+                    race->taken[x].fetchAdd(1, base::MemoryOrder::relaxed);
+                }
+            }
+            while (race->deque.pop(x)) {
+                race->taken[x].fetchAdd(1, base::MemoryOrder::relaxed);
+            }
+            race->done.store(true, base::MemoryOrder::release);
+            for (int i = 0; i < thief_count; i++) {
+                pthread_join(thieves[i], nullptr);
+            }
+            for (usize i = 0; i < race_items; i++) {
+                spargel_check(race->taken[i].load() == 1);
+            }
+            delete race;
+        }
+
+    }  // namespace
+}  // namespace spargel::task
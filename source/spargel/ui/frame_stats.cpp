@@ -0,0 +1,120 @@
+#include "spargel/ui/frame_stats.h"
+
+#include "spargel/base/logging.h"
+#include "spargel/render/ui_scene.h"
+
+namespace spargel::ui {
+
+    namespace {
+        // Colors are 0xAABBGGRR.
+        constexpr u32 phase_colors[frame_phase_count] = {
+            0xFFE0A040,  // layout: blue
+            0xFF40C040,  // paint: green
+            0xFF40C0E0,  // text shaping: yellow
+            0xFFC040C0,  // glyph upload: purple
+            0xFF4040E0,  // submit: red
+        };
+        constexpr u32 background_color = 0xFF202020;
+        constexpr u32 budget_color = 0xFFFFFFFF;
+
+        constexpr float overlay_x = 8.0f;
+        constexpr float overlay_y = 8.0f;
+        constexpr float bar_width = 2.0f;
+        constexpr float pixels_per_ms = 4.0f;
+        constexpr float budget_ms = 1000.0f / 60.0f;
+        // Longer frames are cut at twice the budget.
+        constexpr float overlay_height = 2.0f * budget_ms * pixels_per_ms;
+
+        float to_ms(u64 ns) { return static_cast<float>(ns) / 1e6f; }
+    }  // namespace
+
+    char const* framePhaseName(FramePhase phase) {
+        switch (phase) {
+        case FramePhase::layout:
+            return "layout";
+        case FramePhase::paint:
+            return "paint";
+        case FramePhase::text_shaping:
+            return "text_shaping";
+        case FramePhase::glyph_upload:
+            return "glyph_upload";
+        case FramePhase::submit:
+            return "submit";
+        }
+        return "unknown";
+    }
+
+    void FrameStats::record(FrameSample const& sample) {
+        samples_[next_] = sample;
+        next_ = (next_ + 1) % history_size;
+        if (count_ < history_size) count_++;
+        frames_++;
+    }
+
+    FrameSample const& FrameStats::at(usize i) const {
+        return samples_[(next_ + history_size - count_ + i) % history_size];
+    }
+
+    FrameSample const& FrameStats::last() const { return at(count_ - 1); }
+
+    template <typename F>
+    u64 FrameStats::percentile(u32 p, F value) const {
+        if (count_ == 0) return 0;
+        u64 sorted[history_size];
+        for (usize i = 0; i < count_; i++) {
+            u64 x = value(at(i));
+            usize j = i;
+            for (; j > 0 && sorted[j - 1] > x; j--) {
+                sorted[j] = sorted[j - 1];
+            }
+            sorted[j] = x;
+        }
+        // Nearest rank.
+        usize rank = (count_ * p + 99) / 100;
+        return sorted[rank > 0 ? rank - 1 : 0];
+    }
+
+    u64 FrameStats::totalPercentile(u32 p) const {
+        return percentile(p, [](FrameSample const& s) { return s.total_ns; });
+    }
+
+    u64 FrameStats::phasePercentile(FramePhase phase, u32 p) const {
+        return percentile(p, [phase](FrameSample const& s) { return s.phaseNs(phase); });
+    }
+
+    void FrameStats::drawOverlay(render::UIScene& scene) const {
+        float width = bar_width * static_cast<float>(history_size);
+        scene.setClip(overlay_x, overlay_y, width, overlay_height);
+        scene.fillRect(overlay_x, overlay_y, width, overlay_height, background_color);
+        float bottom = overlay_y + overlay_height;
+        for (usize i = 0; i < count_; i++) {
+            FrameSample const& s = at(i);
+            float x = overlay_x + bar_width * static_cast<float>(i);
+            float y = bottom;
+            for (usize k = 0; k < frame_phase_count && y > overlay_y; k++) {
+                float h = to_ms(s.phase_ns[k]) * pixels_per_ms;
+                if (h <= 0.0f) continue;
+                if (y - h < overlay_y) h = y - overlay_y;
+                y -= h;
+                scene.fillRect(x, y, bar_width, h, phase_colors[k]);
+            }
+        }
+        float budget_y = bottom - budget_ms * pixels_per_ms;
+        scene.strokeLine(overlay_x, budget_y, overlay_x + width, budget_y, budget_color);
+    }
+
+    void FrameStats::logSummary() const {
+        if (count_ == 0) return;
+        FrameSample const& s = last();
+        spargel_log_info("frame: p50 %.2f ms, p99 %.2f ms over %zu frames; %u commands, %zu "
+                         "slots, %u glyph uploads in the last",
+                         to_ms(totalPercentile(50)), to_ms(totalPercentile(99)), count_,
+                         s.command_count, s.estimated_slots, s.glyph_uploads);
+        for (usize k = 0; k < frame_phase_count; k++) {
+            auto phase = static_cast<FramePhase>(k);
+            spargel_log_info("  %-12s p50 %.3f ms, p99 %.3f ms", framePhaseName(phase),
+                             to_ms(phasePercentile(phase, 50)), to_ms(phasePercentile(phase, 99)));
+        }
+    }
+
+}  // namespace spargel::ui
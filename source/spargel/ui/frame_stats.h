@@ -0,0 +1,79 @@
+#pragma once
+
+#include "spargel/base/types.h"
+
+namespace spargel::render {
+    class UIScene;
+}
+
+namespace spargel::ui {
+
+    // The parts of a frame, in the order they run. They do not overlap: `paint` excludes the
+    // shaping and glyph uploads that happen inside it.
+    enum class FramePhase : u8 {
+        layout,
+        paint,
+        text_shaping,
+        glyph_upload,
+        submit,
+    };
+
+    inline constexpr usize frame_phase_count = 5;
+
+    char const* framePhaseName(FramePhase phase);
+
+    struct FrameSample {
+        u64 phase_ns[frame_phase_count] = {};
+        // From the start of layout to the end of submit.
+        u64 total_ns = 0;
+        u32 command_count = 0;
+        usize estimated_slots = 0;
+        u32 glyph_uploads = 0;
+
+        u64 phaseNs(FramePhase phase) const { return phase_ns[static_cast<u8>(phase)]; }
+    };
+
+    // FrameStats
+    //
+    // The samples of the last `history_size` frames, with percentiles over them and an overlay
+    // that draws them.
+    //
+    class FrameStats {
+    public:
+        static constexpr usize history_size = 128;
+
+        void record(FrameSample const& sample);
+
+        // The number of frames recorded, at most `history_size`.
+        usize count() const { return count_; }
+        // The total number of frames recorded.
+        u64 frameCount() const { return frames_; }
+        // The newest frame, zero-filled if none has been recorded.
+        FrameSample const& last() const;
+
+        // The `p`-th percentile, `p` in [0, 100], over the recorded frames. Zero if none.
+        u64 totalPercentile(u32 p) const;
+        u64 phasePercentile(FramePhase phase, u32 p) const;
+
+        // Draw the history as a bar per frame at the top-left corner: the phases stacked
+        // bottom-up in their order, with a line at the 60 Hz budget.
+        void drawOverlay(render::UIScene& scene) const;
+
+        // Log the median and p99 of the frame and of each phase.
+        void logSummary() const;
+
+    private:
+        // Index `i`, 0 being the oldest frame.
+        FrameSample const& at(usize i) const;
+
+        template <typename F>
+        u64 percentile(u32 p, F value) const;
+
+        FrameSample samples_[history_size];
+        // The slot of the next sample.
+        usize next_ = 0;
+        usize count_ = 0;
+        u64 frames_ = 0;
+    };
+
+}  // namespace spargel::ui
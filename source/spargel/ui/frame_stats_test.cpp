@@ -0,0 +1,67 @@
+#include "spargel/ui/frame_stats.h"
+
+#include "spargel/base/check.h"
+#include "spargel/base/test.h"
+
+namespace spargel::ui {
+    namespace {
+        FrameSample sample(u64 total_ns) {
+            FrameSample s;
+            s.total_ns = total_ns;
+            s.phase_ns[static_cast<u8>(FramePhase::paint)] = total_ns / 2;
+            return s;
+        }
+
+        TEST(FrameStats_Empty) {
+            FrameStats stats;
+            spargel_check(stats.count() == 0);
+            spargel_check(stats.frameCount() == 0);
+            spargel_check(stats.totalPercentile(0) == 0);
+            spargel_check(stats.totalPercentile(50) == 0);
+            spargel_check(stats.phasePercentile(FramePhase::paint, 99) == 0);
+            spargel_check(stats.last().total_ns == 0);
+        }
+
+        TEST(FrameStats_NearestRank) {
+            FrameStats stats;
+            // 1..10, out of order.
+            u64 totals[] = {7, 3, 10, 1, 9, 2, 8, 5, 6, 4};
+            for (u64 t : totals) {
+                stats.record(sample(t));
+            }
+            spargel_check(stats.count() == 10);
+            spargel_check(stats.last().total_ns == 4);
+
+            // The smallest value with at least `p` percent of the frames at or below it.
+            spargel_check(stats.totalPercentile(0) == 1);
+            spargel_check(stats.totalPercentile(1) == 1);
+            spargel_check(stats.totalPercentile(10) == 1);
+            spargel_check(stats.totalPercentile(11) == 2);
+            spargel_check(stats.totalPercentile(50) == 5);
+            spargel_check(stats.totalPercentile(51) == 6);
+            spargel_check(stats.totalPercentile(90) == 9);
+            spargel_check(stats.totalPercentile(99) == 10);
+            spargel_check(stats.totalPercentile(100) == 10);
+
+            spargel_check(stats.phasePercentile(FramePhase::paint, 100) == 5);
+            spargel_check(stats.phasePercentile(FramePhase::layout, 50) == 0);
+        }
+
+        // Past `history_size` frames, the oldest are replaced.
+        TEST(FrameStats_Wrap) {
+            FrameStats stats;
+            constexpr usize n = FrameStats::history_size;
+            for (usize i = 1; i <= 2 * n + 5; i++) {
+                stats.record(sample(i));
+                spargel_check(stats.last().total_ns == i);
+            }
+            spargel_check(stats.count() == n);
+            spargel_check(stats.frameCount() == 2 * n + 5);
+            // The frames left are n + 6 .. 2n + 5.
+            spargel_check(stats.totalPercentile(0) == n + 6);
+            spargel_check(stats.totalPercentile(50) == n + 5 + n / 2);
+            spargel_check(stats.totalPercentile(100) == 2 * n + 5);
+        }
+
+    }  // namespace
+}  // namespace spargel::ui
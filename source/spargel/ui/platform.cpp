@@ -1,5 +1,6 @@
 #include "spargel/ui/platform.h"
 
+#include "spargel/base/sampling_profiler.h"
 #include "spargel/config.h"
 
 namespace spargel::ui {
@@ -15,6 +16,8 @@ namespace spargel::ui {
     base::unique_ptr<Platform> makePlatformDummy();
 
     base::unique_ptr<Platform> makePlatform() {
+        // Every app comes through here, so any of them can be profiled without rebuilding.
+        base::start_sampling_profiler_from_env();
 #if SPARGEL_IS_LINUX && SPARGEL_LINUX_IS_DESKTOP
         return makePlatformXcb();
 #elif SPARGEL_IS_MACOS
@@ -1,8 +1,14 @@
 #include "spargel/ui/view_host.h"
 
+#include "spargel/base/platform.h"
+#include "spargel/base/trace.h"
 #include "spargel/render/ui_renderer.h"
 #include "spargel/ui/view.h"
 
+// libc
+#include <stdlib.h>
+#include <string.h>
+
 namespace spargel::ui {
     ViewHost::ViewHost(Window* window, render::UIRenderer* renderer)
         : window_{window}, renderer_{renderer} {
@@ -11,6 +17,12 @@ namespace spargel::ui {
         window_->bindRenderer(renderer_);
         scene_.setScale(window_->scaleFactor());
         scene_.setRenderer(renderer_);
+
+        char const* stats = getenv("SPARGEL_FRAME_STATS");
+        if (stats != nullptr && strcmp(stats, "1") == 0) {
+            show_frame_stats_ = true;
+            log_frame_stats_ = true;
+        }
     }
     void ViewHost::setRootView(View* view) {
         root_view_ = view;
@@ -26,16 +38,53 @@ namespace spargel::ui {
             return;
         }
 
+        u64 frame_start = base::get_monotonic_time_ns();
         if (needs_layout_) {
             computeLayout();
         }
+        u64 layout_end = base::get_monotonic_time_ns();
 
+        renderer_->resetGlyphUploadStats();
         scene_.clear();
         // TODO: GPUContext.
         PaintContext ctx{nullptr, &scene_};
         root_view_->paint(ctx);
+        if (show_frame_stats_) {
+            frame_stats_.drawOverlay(scene_);
+        }
+        u64 paint_end = base::get_monotonic_time_ns();
+
         renderer_->render(scene_);
+        // The CPU side only; the GPU may still be working.
+        u64 submit_end = base::get_monotonic_time_ns();
         dirty_ = false;
+
+        FrameSample sample;
+        u64 shaping = scene_.shapingNs();
+        u64 glyphs = renderer_->glyphUploadNs();
+        u64 paint = paint_end - layout_end;
+        // Shaping and glyph uploads happen inside paint.
+        paint = paint > shaping + glyphs ? paint - shaping - glyphs : 0;
+        sample.phase_ns[static_cast<u8>(FramePhase::layout)] = layout_end - frame_start;
+        sample.phase_ns[static_cast<u8>(FramePhase::paint)] = paint;
+        sample.phase_ns[static_cast<u8>(FramePhase::text_shaping)] = shaping;
+        sample.phase_ns[static_cast<u8>(FramePhase::glyph_upload)] = glyphs;
+        sample.phase_ns[static_cast<u8>(FramePhase::submit)] = submit_end - paint_end;
+        sample.total_ns = submit_end - frame_start;
+        sample.command_count = static_cast<u32>(scene_.commands2_count());
+        sample.estimated_slots = scene_.estimatedSlots();
+        sample.glyph_uploads = renderer_->glyphUploadCount();
+        frame_stats_.record(sample);
+        spargel_trace_counter("frame_ns", sample.total_ns);
+        spargel_trace_counter("frame_commands", sample.command_count);
+
+        if (log_frame_stats_ && frame_stats_.frameCount() % FrameStats::history_size == 0) {
+            frame_stats_.logSummary();
+        }
+    }
+    void ViewHost::setFrameStatsOverlay(bool enabled) {
+        show_frame_stats_ = enabled;
+        setDirty();
     }
     void ViewHost::onMouseDown(MouseDownEvent const& e) {
         if (!root_view_) {
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "spargel/render/ui_scene.h"
+#include "spargel/ui/frame_stats.h"
 #include "spargel/ui/window.h"
 
 namespace spargel::render {
@@ -31,6 +32,19 @@ namespace spargel::ui {
         // Repaint the view tree.
         void scheduleRepaint();
 
+        // Frame Telemetry
+        // ---------------
+        //
+        // Every frame is timed. With `SPARGEL_FRAME_STATS=1` in the environment, the overlay is
+        // on from the start, and a summary is logged every `FrameStats::history_size` frames.
+        //
+
+        FrameStats const& frameStats() const { return frame_stats_; }
+
+        // Draw the frame times over the views. See `FrameStats::drawOverlay`.
+        void setFrameStatsOverlay(bool enabled);
+        bool frameStatsOverlay() const { return show_frame_stats_; }
+
         //
         void onRender() override;
         void onMouseDown(const MouseDownEvent& e) override;
@@ -48,5 +62,8 @@ namespace spargel::ui {
         render::UIRenderer* renderer_;
         bool dirty_ = true;
         bool needs_layout_ = true;
+        FrameStats frame_stats_;
+        bool show_frame_stats_ = false;
+        bool log_frame_stats_ = false;
     };
 }  // namespace spargel::ui
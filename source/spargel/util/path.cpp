@@ -1,6 +1,7 @@
 #include "spargel/util/path.h"
 
 #include "spargel/base/const.h"
+#include "spargel/base/string_builder.h"
 
 namespace spargel::util {
 
@@ -41,6 +42,10 @@ namespace spargel::util {
         return base::string_from_range(data, cur);
     }
 
+    base::String joinPath(base::StringView dir, base::StringView path) {
+        return base::concat(dir, PATH_SPLIT, path);
+    }
+
     ParsedPath parsePath(const base::String& path) {
         if (path.length() == 0) return {.absolute = false, .directory = false, .components = {}};
 
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "spargel/base/string.h"
+#include "spargel/base/string_view.h"
 #include "spargel/base/vector.h"
 
 namespace spargel::util {
@@ -17,6 +18,9 @@ namespace spargel::util {
 
     base::String dirname(const base::String& path);
 
+    // Join two paths with a separator, with a single allocation.
+    base::String joinPath(base::StringView dir, base::StringView path);
+
     ParsedPath parsePath(const base::String& path);
 
 }  // namespace spargel::util
@@ -98,10 +98,23 @@ void test_parsePath() {
     spargel_assert(parsed.components[1] == base::String("world"));
 }
 
+void test_joinPath() {
+    using namespace base::literals;
+
+#if SPARGEL_IS_WINDOWS
+    spargel_assert(util::joinPath("C:"_sv, "hello"_sv) == base::String("C:\\hello"));
+#else
+    spargel_assert(util::joinPath("/root"_sv, "hello"_sv) == base::String("/root/hello"));
+    spargel_assert(util::joinPath("a"_sv, "b/c"_sv) == base::String("a/b/c"));
+#endif
+}
+
 int main() {
     test_dirname();
 
     test_parsePath();
 
+    test_joinPath();
+
     return 0;
 }